@@ -56,6 +56,17 @@ typedef enum {
 #define DTLS_EVENT_CONNECT        0x01DC /**< initiated handshake */
 #define DTLS_EVENT_CONNECTED      0x01DE /**< handshake or re-negotiation
 					  * has finished */
+#define DTLS_EVENT_IDLE_TIMEOUT   0x01E0 /**< session removed after
+					  * dtls_peer_limits_t::idle_timeout */
+#define DTLS_EVENT_HANDSHAKE_TIMEOUT 0x01E2 /**< peer removed after
+					  * dtls_peer_limits_t::handshake_timeout */
+#define DTLS_EVENT_ADDRESS_CHANGED 0x01E4 /**< the records of the peer
+					  * arrive from a new address, which
+					  * is passed to the callback */
+#define DTLS_EVENT_FALSE_START    0x01E6 /**< the client may send data
+					  * before the handshake has
+					  * finished, see
+					  * dtls_set_false_start() */
 
 static inline int
 dtls_alert_create(dtls_alert_level_t level, dtls_alert_t desc)
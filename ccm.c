@@ -142,7 +142,7 @@ encrypt(rijndael_ctx *ctx, size_t L, unsigned long counter,
 	unsigned char A[DTLS_CCM_BLOCKSIZE],
 	unsigned char S[DTLS_CCM_BLOCKSIZE]) {
 
-  static unsigned long counter_tmp;
+  unsigned long counter_tmp;
 
   SET_COUNTER(A, L, counter, counter_tmp);    
   rijndael_encrypt(ctx, A, S);
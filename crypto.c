@@ -53,58 +53,99 @@ memarray_t handshake_storage;
 memarray_t security_storage;
 memarray_t handshake_storage;
 memarray_t security_storage;
+#ifdef DTLS_ECC
+dtls_crypto_job_t crypto_job_storage_data[DTLS_CRYPTO_JOB_MAX];
+memarray_t crypto_job_storage;
+#endif /* DTLS_ECC */
 
 #endif /* RIOT_VERSION */
 
 #define HMAC_UPDATE_SEED(Context,Seed,Length)		\
   if (Seed) dtls_hmac_update(Context, (Seed), (Length))
 
+#ifdef DTLS_CONSTRAINED_STACK
+/* The cipher context is too large for constrained stacks, therefore a
+ * single instance is shared. Otherwise, the caller passes a context
+ * on its own stack, so contexts on different threads never contend. */
 static struct dtls_cipher_context_t cipher_context;
 static dtls_mutex_t cipher_context_mutex = DTLS_MUTEX_INITIALIZER;
 
-static struct dtls_cipher_context_t *dtls_cipher_context_get(void)
+static struct dtls_cipher_context_t *
+dtls_cipher_context_get(struct dtls_cipher_context_t *local)
 {
+  (void)local;
   dtls_mutex_lock(&cipher_context_mutex);
   return &cipher_context;
 }
 
-static void dtls_cipher_context_release(void)
+static void dtls_cipher_context_release(struct dtls_cipher_context_t *ctx)
 {
+  (void)ctx;
   dtls_mutex_unlock(&cipher_context_mutex);
 }
+#else /* ! DTLS_CONSTRAINED_STACK */
+static inline struct dtls_cipher_context_t *
+dtls_cipher_context_get(struct dtls_cipher_context_t *local)
+{
+  return local;
+}
+
+static void dtls_cipher_context_release(struct dtls_cipher_context_t *ctx)
+{
+  /* prevent exposure of the key schedule */
+  memset(ctx, 0, sizeof(*ctx));
+}
+#endif /* ! DTLS_CONSTRAINED_STACK */
 
 #if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
 void crypto_init(void)
 {
 }
 
-static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
-  return malloc(sizeof(dtls_handshake_parameters_t));
+static dtls_handshake_parameters_t *dtls_handshake_malloc(dtls_mem_t *mem) {
+  return dtls_mem_alloc(mem, DTLS_POOL_HANDSHAKE, sizeof(dtls_handshake_parameters_t));
 }
 
 static void dtls_handshake_dealloc(dtls_handshake_parameters_t *handshake) {
-  free(handshake);
+  dtls_mem_release(handshake);
 }
 
-static dtls_security_parameters_t *dtls_security_malloc(void) {
-  return malloc(sizeof(dtls_security_parameters_t));
+static dtls_security_parameters_t *dtls_security_malloc(dtls_mem_t *mem) {
+  return dtls_mem_alloc(mem, DTLS_POOL_SECURITY, sizeof(dtls_security_parameters_t));
 }
 
 static void dtls_security_dealloc(dtls_security_parameters_t *security) {
-  free(security);
+  dtls_mem_release(security);
+}
+
+#ifdef DTLS_ECC
+static dtls_crypto_job_t *dtls_crypto_job_malloc(void) {
+  return malloc(sizeof(dtls_crypto_job_t));
+}
+
+static void dtls_crypto_job_dealloc(dtls_crypto_job_t *job) {
+  free(job);
 }
+#endif /* DTLS_ECC */
 #elif defined (WITH_CONTIKI) /* WITH_CONTIKI */
 
 #include "memb.h"
 MEMB(handshake_storage, dtls_handshake_parameters_t, DTLS_HANDSHAKE_MAX);
 MEMB(security_storage, dtls_security_parameters_t, DTLS_SECURITY_MAX);
+#ifdef DTLS_ECC
+MEMB(crypto_job_storage, dtls_crypto_job_t, DTLS_CRYPTO_JOB_MAX);
+#endif /* DTLS_ECC */
 
 void crypto_init(void) {
   memb_init(&handshake_storage);
   memb_init(&security_storage);
+#ifdef DTLS_ECC
+  memb_init(&crypto_job_storage);
+#endif /* DTLS_ECC */
 }
 
-static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
+static dtls_handshake_parameters_t *dtls_handshake_malloc(dtls_mem_t *mem) {
+  (void) mem;
   return memb_alloc(&handshake_storage);
 }
 
@@ -112,7 +153,8 @@ static void dtls_handshake_dealloc(dtls_handshake_parameters_t *handshake) {
   memb_free(&handshake_storage, handshake);
 }
 
-static dtls_security_parameters_t *dtls_security_malloc(void) {
+static dtls_security_parameters_t *dtls_security_malloc(dtls_mem_t *mem) {
+  (void) mem;
   return memb_alloc(&security_storage);
 }
 
@@ -120,14 +162,28 @@ static void dtls_security_dealloc(dtls_security_parameters_t *security) {
   memb_free(&security_storage, security);
 }
 
+#ifdef DTLS_ECC
+static dtls_crypto_job_t *dtls_crypto_job_malloc(void) {
+  return memb_alloc(&crypto_job_storage);
+}
+
+static void dtls_crypto_job_dealloc(dtls_crypto_job_t *job) {
+  memb_free(&crypto_job_storage, job);
+}
+#endif /* DTLS_ECC */
+
 #elif defined (RIOT_VERSION)
 
 void crypto_init(void) {
   memarray_init(&handshake_storage, handshake_storage_data, sizeof(dtls_handshake_parameters_t), DTLS_HANDSHAKE_MAX);
   memarray_init(&security_storage, security_storage_data, sizeof(dtls_security_parameters_t), DTLS_SECURITY_MAX);
+#ifdef DTLS_ECC
+  memarray_init(&crypto_job_storage, crypto_job_storage_data, sizeof(dtls_crypto_job_t), DTLS_CRYPTO_JOB_MAX);
+#endif /* DTLS_ECC */
 }
 
-static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
+static dtls_handshake_parameters_t *dtls_handshake_malloc(dtls_mem_t *mem) {
+  (void) mem;
   return memarray_alloc(&handshake_storage);
 }
 
@@ -135,7 +191,8 @@ static void dtls_security_dealloc(dtls_security_parameters_t *security) {
   memarray_free(&security_storage, security);
 }
 
-static dtls_security_parameters_t *dtls_security_malloc(void) {
+static dtls_security_parameters_t *dtls_security_malloc(dtls_mem_t *mem) {
+  (void) mem;
   return memarray_alloc(&security_storage);
 }
 
@@ -143,13 +200,23 @@ static void dtls_handshake_dealloc(dtls_handshake_parameters_t *handshake) {
   memarray_free(&handshake_storage, handshake);
 }
 
+#ifdef DTLS_ECC
+static dtls_crypto_job_t *dtls_crypto_job_malloc(void) {
+  return memarray_alloc(&crypto_job_storage);
+}
+
+static void dtls_crypto_job_dealloc(dtls_crypto_job_t *job) {
+  memarray_free(&crypto_job_storage, job);
+}
+#endif /* DTLS_ECC */
+
 #endif /* WITH_CONTIKI */
 
-dtls_handshake_parameters_t *dtls_handshake_new(void)
+dtls_handshake_parameters_t *dtls_handshake_new(dtls_mem_t *mem)
 {
   dtls_handshake_parameters_t *handshake;
 
-  handshake = dtls_handshake_malloc();
+  handshake = dtls_handshake_malloc(mem);
   if (!handshake) {
     dtls_crit("can not allocate a handshake struct\n");
     return NULL;
@@ -168,27 +235,75 @@ dtls_handshake_parameters_t *dtls_handshake_new(void)
 
 void dtls_handshake_free(dtls_handshake_parameters_t *handshake)
 {
+  int i;
+
   if (!handshake)
     return;
 
-  netq_delete_all(&handshake->reorder_queue);
+  for (i = 0; i < DTLS_HANDSHAKE_WINDOW; i++)
+    netq_node_free(handshake->reassembly[i]);
+  netq_delete_all(&handshake->next_epoch_records);
+  netq_delete_all(&handshake->early_data);
+#ifdef DTLS_ECC
+  netq_delete_all(&handshake->deferred_records);
+  /* A pending job is still owned by the executor and will be released
+   * by dtls_crypto_job_complete(), which does not find it anymore. */
+  if (handshake->crypto_job &&
+      handshake->crypto_job->state != DTLS_CRYPTO_JOB_PENDING) {
+    dtls_crypto_job_free(handshake->crypto_job);
+  }
+#endif /* DTLS_ECC */
   dtls_handshake_dealloc(handshake);
 }
 
-dtls_security_parameters_t *dtls_security_new(void)
+#ifdef DTLS_ECC
+dtls_crypto_job_t *dtls_crypto_job_new(dtls_crypto_job_type_t type)
 {
-  dtls_security_parameters_t *security;
+  dtls_crypto_job_t *job;
 
-  security = dtls_security_malloc();
-  if (!security) {
-    dtls_crit("can not allocate a security struct\n");
+  job = dtls_crypto_job_malloc();
+  if (!job) {
+    dtls_warn("can not allocate a crypto job\n");
     return NULL;
   }
 
+  memset(job, 0, sizeof(*job));
+  job->type = type;
+  job->state = DTLS_CRYPTO_JOB_PENDING;
+
+  return job;
+}
+
+void dtls_crypto_job_free(dtls_crypto_job_t *job)
+{
+  if (!job)
+    return;
+
+  /* prevent exposure of sensible data */
+  memset(job, 0, sizeof(*job));
+  dtls_crypto_job_dealloc(job);
+}
+#endif /* DTLS_ECC */
+
+void dtls_security_init(dtls_security_parameters_t *security)
+{
   memset(security, 0, sizeof(*security));
 
   security->cipher_index = DTLS_CIPHER_INDEX_NULL;
   security->compression = TLS_COMPRESSION_NULL;
+}
+
+dtls_security_parameters_t *dtls_security_new(dtls_mem_t *mem)
+{
+  dtls_security_parameters_t *security;
+
+  security = dtls_security_malloc(mem);
+  if (!security) {
+    dtls_crit("can not allocate a security struct\n");
+    return NULL;
+  }
+
+  dtls_security_init(security);
 
   return security;
 }
@@ -565,7 +680,12 @@ dtls_encrypt_params(const dtls_ccm_params_t *params,
                     const unsigned char *key, size_t keylen,
                     const unsigned char *aad, size_t la) {
   int ret;
-  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get();
+#ifndef DTLS_CONSTRAINED_STACK
+  struct dtls_cipher_context_t local_context;
+  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get(&local_context);
+#else /* ! DTLS_CONSTRAINED_STACK */
+  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get(NULL);
+#endif /* ! DTLS_CONSTRAINED_STACK */
   ctx->data.tag_length = params->tag_length;
   ctx->data.l = params->l;
 
@@ -581,7 +701,7 @@ dtls_encrypt_params(const dtls_ccm_params_t *params,
   ret = dtls_ccm_encrypt(&ctx->data, src, length, buf, params->nonce, aad, la);
 
 error:
-  dtls_cipher_context_release();
+  dtls_cipher_context_release(ctx);
   return ret;
 }
 
@@ -607,7 +727,12 @@ dtls_decrypt_params(const dtls_ccm_params_t *params,
                     const unsigned char *aad, size_t la)
 {
   int ret;
-  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get();
+#ifndef DTLS_CONSTRAINED_STACK
+  struct dtls_cipher_context_t local_context;
+  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get(&local_context);
+#else /* ! DTLS_CONSTRAINED_STACK */
+  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get(NULL);
+#endif /* ! DTLS_CONSTRAINED_STACK */
   ctx->data.tag_length = params->tag_length;
   ctx->data.l = params->l;
 
@@ -623,7 +748,7 @@ dtls_decrypt_params(const dtls_ccm_params_t *params,
   ret = dtls_ccm_decrypt(&ctx->data, src, length, buf, params->nonce, aad, la);
 
 error:
-  dtls_cipher_context_release();
+  dtls_cipher_context_release(ctx);
   return ret;
 }
 
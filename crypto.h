@@ -29,6 +29,8 @@
 #include "numeric.h"
 #include "hmac.h"
 #include "ccm.h"
+#include "session.h"
+#include "dtls_alloc.h"
 
 /* TLS_PSK_WITH_AES_128_CCM_8 */
 #define DTLS_MAC_KEY_LENGTH    0
@@ -51,6 +53,8 @@
 /** Length of DTLS master_secret */
 #define DTLS_MASTER_SECRET_LENGTH 48
 #define DTLS_RANDOM_LENGTH 32
+/** Maximum length of a session id, also used for the ids we assign */
+#define DTLS_SESSION_ID_LENGTH 32
 
 /** Type of index in cipher parameter table */
 typedef uint8_t dtls_cipher_index_t;
@@ -133,6 +137,62 @@ typedef struct {
 
 struct netq_t;
 
+#ifdef DTLS_ECC
+/** The expensive operations that may be handed to an executor. */
+typedef enum {
+  /** Server: create the ephemeral key and sign the ServerKeyExchange. */
+  DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE,
+  /** Client: verify the signature of the ServerKeyExchange. */
+  DTLS_CRYPTO_JOB_VERIFY_KEY_EXCHANGE,
+  /** Client: create the ephemeral key and the ECDH pre master secret. */
+  DTLS_CRYPTO_JOB_CLIENT_KEY_EXCHANGE,
+  /** Server: ECDH pre master secret, master secret and key block. */
+  DTLS_CRYPTO_JOB_KEY_BLOCK
+} dtls_crypto_job_type_t;
+
+typedef enum {
+  DTLS_CRYPTO_JOB_PENDING,	/**< submitted, not yet completed */
+  DTLS_CRYPTO_JOB_DONE		/**< result available */
+} dtls_crypto_job_state_t;
+
+/**
+ * A self-contained cryptographic operation of a handshake. All input
+ * is copied into the job when it is created and all output is written
+ * to the job, so dtls_crypto_job_run() may be called on any thread
+ * without touching the state of the DTLS context.
+ */
+typedef struct dtls_crypto_job_t {
+  dtls_crypto_job_type_t type;
+  dtls_crypto_job_state_t state; /**< only used by the context's thread */
+  session_t session;		/**< the peer this job belongs to */
+  void *app;			/**< free for use by the executor */
+  int result;			/**< \c 0 on success, less than zero on error */
+
+  /* input */
+  uint8 own_priv[DTLS_EC_KEY_SIZE];	  /**< long-term or ephemeral private key */
+  uint8 other_pub_x[DTLS_EC_KEY_SIZE];  /**< peer's long-term public key */
+  uint8 other_pub_y[DTLS_EC_KEY_SIZE];
+  uint8 other_eph_pub_x[DTLS_EC_KEY_SIZE]; /**< peer's ephemeral public key */
+  uint8 other_eph_pub_y[DTLS_EC_KEY_SIZE];
+  uint8 random[2 * DTLS_RANDOM_LENGTH]; /**< client random + server random */
+  uint8 sig_r[DTLS_EC_KEY_SIZE];	  /**< signature to verify */
+  uint8 sig_s[DTLS_EC_KEY_SIZE];
+  uint8 session_hash[DTLS_HMAC_DIGEST_SIZE]; /**< for extended master secret */
+  unsigned int extended_master_secret:1;
+  size_t key_block_length;
+
+  /* output */
+  uint8 own_eph_priv[DTLS_EC_KEY_SIZE];
+  uint8 own_eph_pub_x[DTLS_EC_KEY_SIZE];
+  uint8 own_eph_pub_y[DTLS_EC_KEY_SIZE];
+  uint32_t point_r[9];
+  uint32_t point_s[9];
+  uint8 pre_master_secret[DTLS_EC_KEY_SIZE];
+  uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
+  uint8 key_block[MAX_KEYBLOCK_LENGTH];
+} dtls_crypto_job_t;
+#endif /* DTLS_ECC */
+
 /**
  * Set of user parameters used by the handshake.
  *
@@ -159,7 +219,10 @@ typedef struct {
     /** the session's master secret */
     uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
   } tmp;
-  struct netq_t *reorder_queue;	/**< the packets to reorder */
+  /** handshake messages from hs_state.mseq_r on, to be reordered and
+   *  reassembled, at message_seq modulo DTLS_HANDSHAKE_WINDOW */
+  struct netq_t *reassembly[DTLS_HANDSHAKE_WINDOW];
+  struct netq_t *next_epoch_records; /**< records of the next epoch received before the ChangeCipherSpec */
   dtls_hs_state_t hs_state;  /**< handshake protocol status */
 
   dtls_compression_t compression;		/**< compression method */
@@ -168,6 +231,24 @@ typedef struct {
   unsigned int do_client_auth:1;
   unsigned int extended_master_secret:1;
   unsigned int renegotiation_info:1;
+  unsigned int resumed:1;	/**< abbreviated handshake of a cached session */
+  /** the session id offered by the client or assigned by the server */
+  uint8 session_id[DTLS_SESSION_ID_LENGTH];
+  uint8 session_id_length;
+  /** a NewSessionTicket is sent by the server, expected by the client */
+  unsigned int session_ticket:1;
+  /** the connection_id extension has been received */
+  unsigned int connection_id:1;
+  /** the ChangeCipherSpec has overtaken the NewSessionTicket */
+  unsigned int ccs_deferred:1;
+  /** the client sends application data before the server's Finished */
+  unsigned int false_start:1;
+  struct netq_t *early_data; /**< application data received before the Finished */
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  /** the ticket offered by the client or received from the server */
+  uint8 ticket[DTLS_SESSION_TICKET_LENGTH];
+  uint16_t ticket_length;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
   union {
 #ifdef DTLS_ECC
     dtls_handshake_parameters_ecdsa_t ecdsa;
@@ -176,6 +257,10 @@ typedef struct {
     dtls_handshake_parameters_psk_t psk;
 #endif /* DTLS_PSK */
   } keyx;
+#ifdef DTLS_ECC
+  struct dtls_crypto_job_t *crypto_job;	/**< offloaded crypto operation */
+  struct netq_t *deferred_records; /**< records received while crypto_job is pending */
+#endif /* DTLS_ECC */
 } dtls_handshake_parameters_t;
 
 /* The following macros provide access to the components of the
@@ -465,11 +550,22 @@ int dtls_ec_key_asn1_from_uint32(const uint32_t *key, size_t key_size,
 				 unsigned char *buf);
 
 
-dtls_handshake_parameters_t *dtls_handshake_new(void);
+/** Allocates handshake parameters from @p mem, see netq_node_new(). */
+dtls_handshake_parameters_t *dtls_handshake_new(dtls_mem_t *mem);
 
 void dtls_handshake_free(dtls_handshake_parameters_t *handshake);
 
-dtls_security_parameters_t *dtls_security_new(void);
+/** Initializes @p security for TLS_NULL_WITH_NULL_NULL in epoch 0. */
+void dtls_security_init(dtls_security_parameters_t *security);
+
+/** Allocates security parameters from @p mem, see netq_node_new(). */
+dtls_security_parameters_t *dtls_security_new(dtls_mem_t *mem);
+
+#ifdef DTLS_ECC
+dtls_crypto_job_t *dtls_crypto_job_new(dtls_crypto_job_type_t type);
+
+void dtls_crypto_job_free(dtls_crypto_job_t *job);
+#endif /* DTLS_ECC */
 
 void dtls_security_free(dtls_security_parameters_t *security);
 void crypto_init(void);
@@ -18,6 +18,7 @@
  *******************************************************************************/
 
 #include "tinydtls.h"
+
 #include "dtls_time.h"
 
 #include <stdio.h>
@@ -54,7 +55,10 @@
 #include "alert.h"
 #include "session.h"
 #include "dtls_prng.h"
+
+#ifdef DTLS_CONCURRENT_PEERS
 #include "dtls_mutex.h"
+#endif /* DTLS_CONCURRENT_PEERS */
 
 #ifdef WITH_SHA256
 #  include "hmac.h"
@@ -92,12 +96,13 @@ memarray_t dtlscontext_storage;
 #define dtls_get_fragment_length(H) dtls_uint24_to_int((H)->fragment_length)
 
 #ifdef DTLS_PEERS_NOHASH
-#define FIND_PEER(head,sess,out)                                \
+#define FIND_PEER(head,key,hash,out)                            \
   do {                                                          \
     dtls_peer_t * tmp;                                          \
+    (void)(hash);                                               \
     (out) = NULL;                                               \
     LL_FOREACH((head), tmp) {                                   \
-      if (dtls_session_equals(&tmp->session, (sess))) {         \
+      if (memcmp(&tmp->key, (key), sizeof(dtls_session_key_t)) == 0) { \
         (out) = tmp;                                            \
         break;                                                  \
       }                                                         \
@@ -107,18 +112,170 @@ memarray_t dtlscontext_storage;
   if ((head) != NULL && (delptr) != NULL) {	\
     LL_DELETE(head,delptr);                     \
   }
-#define ADD_PEER(head,sess,add)                 \
-  LL_PREPEND(ctx->peers, peer);
-#else /* DTLS_PEERS_NOHASH */
-#define FIND_PEER(head,sess,out)		\
-  HASH_FIND(hh,head,sess,sizeof(session_t),out)
-#define ADD_PEER(head,sess,add)                 \
-  HASH_ADD(hh,head,sess,sizeof(session_t),add)
+#define ADD_PEER(head,hash,add,res)             \
+  do {                                          \
+    (void)(hash);                               \
+    LL_PREPEND(head,add);                       \
+    (res) = 0;                                  \
+  } while (0)
+#elif defined(DTLS_PEERS_OPENHASH)
+#define FIND_PEER(head,key,hash,out)		\
+  ((out) = dtls_peer_table_find(&(head),(key),(hash)))
+#define ADD_PEER(head,hash,add,res)             \
+  ((res) = dtls_peer_table_add(&(head),(add),(hash)))
+#define DEL_PEER(head,delptr)                   \
+  dtls_peer_table_remove(&(head),(delptr))
+#else /* ! DTLS_PEERS_NOHASH && ! DTLS_PEERS_OPENHASH */
+/* Peers are indexed by their normalized session key, see
+ * dtls_session_key(). The hash value is computed by the caller. */
+#define FIND_PEER(head,key,hash,out)		\
+  HASH_FIND_BYHASHVALUE(hh,head,key,sizeof(dtls_session_key_t),hash,out)
+#define ADD_PEER(head,hash,add,res)             \
+  do {                                          \
+    HASH_ADD_BYHASHVALUE(hh,head,key,sizeof(dtls_session_key_t),hash,add); \
+    (res) = 0;                                  \
+  } while (0)
 #define DEL_PEER(head,delptr)                   \
   if ((head) != NULL && (delptr) != NULL) {	\
     HASH_DELETE(hh,head,delptr);		\
   }
-#endif /* DTLS_PEERS_NOHASH */
+#endif /* ! DTLS_PEERS_NOHASH && ! DTLS_PEERS_OPENHASH */
+
+#if DTLS_CID_LENGTH > 0
+#ifdef DTLS_PEERS_NOHASH
+#define FIND_CID_PEER(ctx,cid,out)                              \
+  do {                                                          \
+    dtls_peer_t * tmp;                                          \
+    (out) = NULL;                                               \
+    LL_FOREACH((ctx)->peers, tmp) {                             \
+      if (tmp->read_cid_length &&                               \
+          memcmp(tmp->read_cid, (cid), DTLS_CID_LENGTH) == 0) { \
+        (out) = tmp;                                            \
+        break;                                                  \
+      }                                                         \
+    }                                                           \
+  } while (0)
+#define ADD_CID_PEER(ctx,add,res) ((res) = 0)
+#define DEL_CID_PEER(ctx,delptr) ((void)(delptr))
+#else /* ! DTLS_PEERS_NOHASH */
+/* Peers with a connection id are also indexed by the id they have
+ * been given, see dtls_add_cid(). */
+#define FIND_CID_PEER(ctx,cid,out)		\
+  HASH_FIND(cid_hh,(ctx)->cid_peers,cid,DTLS_CID_LENGTH,out)
+#define ADD_CID_PEER(ctx,add,res)               \
+  do {                                          \
+    HASH_ADD(cid_hh,(ctx)->cid_peers,read_cid,DTLS_CID_LENGTH,add); \
+    (res) = 0;                                  \
+  } while (0)
+#define DEL_CID_PEER(ctx,delptr)                \
+  HASH_DELETE(cid_hh,(ctx)->cid_peers,delptr)
+#endif /* ! DTLS_PEERS_NOHASH */
+#endif /* DTLS_CID_LENGTH > 0 */
+
+#ifdef DTLS_CONCURRENT_PEERS
+/*
+ * Locking scheme for several threads working on one context:
+ *
+ * - All work on a peer is done while holding the session lock of the
+ *   peer's address. These locks are striped by a hash of the address
+ *   and recursive, as callbacks may call back into the library for
+ *   the same session. Peers are only released with their session lock
+ *   held, so a thread holding it may safely use the peer.
+ * - The peer map and the index of connection ids are protected by a
+ *   reader/writer lock that is held only for the lookup, insertion,
+ *   or removal itself.
+ * - The retransmission queue is protected by its own lock, which is
+ *   never held while acquiring a session lock.
+ * - The list of established peers and the peer counters are protected
+ *   by the LRU lock, which is never held while acquiring another lock.
+ *   The session lock of a peer to evict is only tried, as the evicting
+ *   thread already holds a session lock.
+ */
+struct dtls_context_locks_t {
+  dtls_rwlock_t peers;		/**< protects dtls_context_t::peers */
+  dtls_mutex_t sendqueue;	/**< protects dtls_context_t::sendqueue */
+  dtls_mutex_t lru;		/**< protects dtls_context_t::lru and the counters */
+  dtls_mutex_t sessions;	/**< protects dtls_context_t::sessions and the
+                                     validated addresses */
+  dtls_mutex_t session[DTLS_SESSION_LOCKS]; /**< striped session locks */
+};
+
+static dtls_mutex_t *
+dtls_session_mutex(const dtls_context_t *ctx, const session_t *session) {
+  dtls_session_key_t key;
+
+  dtls_session_key(session, &key);
+  return &ctx->locks->session[dtls_session_key_hash(&key) % DTLS_SESSION_LOCKS];
+}
+
+#define dtls_session_lock(Ctx, Session) \
+  dtls_mutex_lock(dtls_session_mutex((Ctx), (Session)))
+#define dtls_session_unlock(Ctx, Session) \
+  dtls_mutex_unlock(dtls_session_mutex((Ctx), (Session)))
+#define dtls_session_lock_hash(Ctx, Hash) \
+  dtls_mutex_lock(&(Ctx)->locks->session[(Hash) % DTLS_SESSION_LOCKS])
+#define dtls_session_unlock_hash(Ctx, Hash) \
+  dtls_mutex_unlock(&(Ctx)->locks->session[(Hash) % DTLS_SESSION_LOCKS])
+#define dtls_session_trylock_hash(Ctx, Hash) \
+  (dtls_mutex_trylock(&(Ctx)->locks->session[(Hash) % DTLS_SESSION_LOCKS]) == 0)
+#define dtls_peers_rdlock(Ctx) dtls_rwlock_rdlock(&(Ctx)->locks->peers)
+#define dtls_peers_wrlock(Ctx) dtls_rwlock_wrlock(&(Ctx)->locks->peers)
+#define dtls_peers_unlock(Ctx) dtls_rwlock_unlock(&(Ctx)->locks->peers)
+#define dtls_sendqueue_lock(Ctx) dtls_mutex_lock(&(Ctx)->locks->sendqueue)
+#define dtls_sendqueue_unlock(Ctx) dtls_mutex_unlock(&(Ctx)->locks->sendqueue)
+#define dtls_lru_lock(Ctx) dtls_mutex_lock(&(Ctx)->locks->lru)
+#define dtls_lru_unlock(Ctx) dtls_mutex_unlock(&(Ctx)->locks->lru)
+#define dtls_sessions_lock(Ctx) dtls_mutex_lock(&(Ctx)->locks->sessions)
+#define dtls_sessions_unlock(Ctx) dtls_mutex_unlock(&(Ctx)->locks->sessions)
+
+#if DTLS_CID_LENGTH > 0
+/**
+ * Adds the session lock of the hash value @p other to that of @p held,
+ * which the caller holds. Session locks are taken in the order of
+ * their stripes, the lock of @p held is released meanwhile if that
+ * comes later. Both may share a stripe, which is locked only once.
+ */
+static void
+dtls_session_lock_other(const dtls_context_t *ctx,
+                        uint32_t held, uint32_t other) {
+  const unsigned int h = held % DTLS_SESSION_LOCKS;
+  const unsigned int o = other % DTLS_SESSION_LOCKS;
+
+  if (o < h) {
+    dtls_mutex_unlock(&ctx->locks->session[h]);
+    dtls_mutex_lock(&ctx->locks->session[o]);
+    dtls_mutex_lock(&ctx->locks->session[h]);
+  } else if (o > h) {
+    dtls_mutex_lock(&ctx->locks->session[o]);
+  }
+}
+
+/** Releases the lock taken by dtls_session_lock_other(). */
+static void
+dtls_session_unlock_other(const dtls_context_t *ctx,
+                          uint32_t held, uint32_t other) {
+  if (other % DTLS_SESSION_LOCKS != held % DTLS_SESSION_LOCKS)
+    dtls_mutex_unlock(&ctx->locks->session[other % DTLS_SESSION_LOCKS]);
+}
+#endif /* DTLS_CID_LENGTH > 0 */
+#else /* ! DTLS_CONCURRENT_PEERS */
+#define dtls_session_lock(Ctx, Session)
+#define dtls_session_unlock(Ctx, Session)
+#define dtls_session_lock_hash(Ctx, Hash)
+#define dtls_session_unlock_hash(Ctx, Hash)
+#define dtls_session_trylock_hash(Ctx, Hash) 1
+#define dtls_session_lock_other(Ctx, Held, Other)
+#define dtls_session_unlock_other(Ctx, Held, Other)
+#define dtls_peers_rdlock(Ctx)
+#define dtls_peers_wrlock(Ctx)
+#define dtls_peers_unlock(Ctx)
+#define dtls_sendqueue_lock(Ctx)
+#define dtls_sendqueue_unlock(Ctx)
+#define dtls_lru_lock(Ctx)
+#define dtls_lru_unlock(Ctx)
+#define dtls_sessions_lock(Ctx)
+#define dtls_sessions_unlock(Ctx)
+#endif /* ! DTLS_CONCURRENT_PEERS */
 
 #define DTLS_RH_LENGTH sizeof(dtls_record_header_t)
 #define DTLS_HS_LENGTH sizeof(dtls_handshake_header_t)
@@ -126,7 +283,7 @@ memarray_t dtlscontext_storage;
  * ClientHello:
  *
  * session_length         := 1 byte
- * session                := 0 bytes
+ * session                := 0 or DTLS_SESSION_ID_LENGTH bytes
  * cookie_length          := 1 byte
  * cookie                 := n bytes
  * cipher_length          := 2 bytes
@@ -143,13 +300,16 @@ memarray_t dtlscontext_storage;
  * ec point format        := 6 bytes   => 26
  * sign. and hash algos   := 8 bytes
  * extended master secret := 4 bytes   => 12
+ * record size limit      := 6 bytes
+ * connection id          := 5 bytes
+ * session ticket         := 4 bytes + DTLS_SESSION_TICKET_LENGTH
  *
  * (The ClientHello uses TLS_EMPTY_RENEGOTIATION_INFO_SCSV
  *  instead of renegotiation info)
  */
 #define DTLS_CH_LENGTH sizeof(dtls_client_hello_t) /* no variable length fields! */
 #define DTLS_COOKIE_LENGTH_MAX 32
-#define DTLS_CH_LENGTH_MAX DTLS_CH_LENGTH + DTLS_COOKIE_LENGTH_MAX + 10 + (2 * DTLS_MAX_CIPHER_SUITES) + 26 + 12
+#define DTLS_CH_LENGTH_MAX DTLS_CH_LENGTH + DTLS_SESSION_ID_LENGTH + DTLS_COOKIE_LENGTH_MAX + 10 + (2 * DTLS_MAX_CIPHER_SUITES) + 26 + 12 + 6 + 5 + 4 + DTLS_SESSION_TICKET_LENGTH
 #define DTLS_HV_LENGTH sizeof(dtls_hello_verify_t)
 /*
  * ServerHello:
@@ -162,6 +322,11 @@ memarray_t dtlscontext_storage;
  * compression            := 1 byte
  */
 #define DTLS_SH_LENGTH (2 + DTLS_RANDOM_LENGTH + 1 + 2 + 1)
+#if DTLS_RECORD_SIZE_LIMIT > 0
+/* The record_size_limit we announce, RFC 8449 permits 64 to 2^14
+ * for DTLS 1.2. */
+#define DTLS_OWN_RECORD_SIZE_LIMIT min(max(DTLS_RECORD_SIZE_LIMIT, 64), 16384)
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
 #define DTLS_SKEXEC_LENGTH (1 + 2 + 1 + 1 + DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE + 1 + 1 + 2 + 70)
 #define DTLS_SKEXECPSK_LENGTH_MIN 2
 #define DTLS_SKEXECPSK_LENGTH_MAX 2 + DTLS_PSK_MAX_CLIENT_IDENTITY_LEN
@@ -325,6 +490,66 @@ free_context(dtls_context_t *context) {
 
 #endif /* WITH_POSIX */
 
+#ifdef DTLS_CONCURRENT_PEERS
+static void
+free_context_locks(dtls_context_t *context) {
+  int i;
+
+  if (!context->locks)
+    return;
+
+  dtls_rwlock_destroy(&context->locks->peers);
+  dtls_mutex_destroy(&context->locks->sendqueue);
+  dtls_mutex_destroy(&context->locks->lru);
+  dtls_mutex_destroy(&context->locks->sessions);
+  for (i = 0; i < DTLS_SESSION_LOCKS; i++) {
+    dtls_mutex_destroy(&context->locks->session[i]);
+  }
+  free(context->locks);
+  context->locks = NULL;
+}
+
+static int
+init_context_locks(dtls_context_t *context) {
+  struct dtls_context_locks_t *locks;
+  int i;
+
+  locks = (struct dtls_context_locks_t *)malloc(sizeof(*locks));
+  if (!locks)
+    return -1;
+
+  if (dtls_rwlock_init(&locks->peers) != 0)
+    goto error;
+  if (dtls_mutex_init(&locks->sendqueue) != 0)
+    goto error_peers;
+  if (dtls_mutex_init(&locks->lru) != 0)
+    goto error_sendqueue;
+  if (dtls_mutex_init(&locks->sessions) != 0)
+    goto error_lru;
+  for (i = 0; i < DTLS_SESSION_LOCKS; i++) {
+    if (dtls_mutex_init_recursive(&locks->session[i]) != 0)
+      goto error_session;
+  }
+
+  context->locks = locks;
+  return 0;
+
+ error_session:
+  while (i--)
+    dtls_mutex_destroy(&locks->session[i]);
+  dtls_mutex_destroy(&locks->sessions);
+ error_lru:
+  dtls_mutex_destroy(&locks->lru);
+ error_sendqueue:
+  dtls_mutex_destroy(&locks->sendqueue);
+ error_peers:
+  dtls_rwlock_destroy(&locks->peers);
+ error:
+  free(locks);
+  return -1;
+}
+#endif /* DTLS_CONCURRENT_PEERS */
+
 void
 dtls_init(void) {
   dtls_clock_init();
@@ -347,6 +572,11 @@ memarray_init(&dtlscontext_storage, dtlscontext_storage_data,
    ? (Context)->h->which((Context), __VA_ARGS__)			\
    : -1)
 
+/* Returned by handshake functions that have handed a crypto job to
+ * the crypto_submit() callback. The handshake message is handled
+ * again when dtls_crypto_job_complete() is called. */
+#define DTLS_CRYPTO_PENDING 1
+
 static int
 dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
 		dtls_security_parameters_t *security , session_t *session,
@@ -383,50 +613,434 @@ dtls_send(dtls_context_t *ctx, dtls_peer_t *peer, unsigned char type,
  */
 static void dtls_stop_retransmission(dtls_context_t *context, dtls_peer_t *peer);
 
-dtls_peer_t *
-dtls_get_peer(const dtls_context_t *ctx, const session_t *session) {
+/**
+ * Stops the retransmission of the flight of @p peer when the peer's
+ * next flight arrives, and updates the round-trip time estimates.
+ */
+static void dtls_flight_acked(dtls_context_t *ctx, dtls_peer_t *peer);
+
+static void dtls_flight_resend(dtls_context_t *ctx, dtls_peer_t *peer);
+static void dtls_flight_hold(dtls_context_t *ctx, dtls_peer_t *peer);
+
+#define DTLS_MS_TO_TICKS(Ms) ((dtls_tick_t)(Ms) * DTLS_TICKS_PER_SECOND / 1000)
+#define DTLS_TICKS_TO_MS(T) ((unsigned int)((T) * 1000 / DTLS_TICKS_PER_SECOND))
+
+/** Returns the retransmission timeout for an estimate, see
+ *  dtls_set_rto_config(). */
+static dtls_tick_t
+dtls_rto(const dtls_context_t *ctx, dtls_tick_t srtt, dtls_tick_t rttvar) {
+  dtls_tick_t rto;
+
+  if (!srtt)
+    return DTLS_MS_TO_TICKS(ctx->rto.initial);
+
+  rto = srtt + max(4 * rttvar, 1);
+  rto = max(rto, DTLS_MS_TO_TICKS(ctx->rto.min));
+  return min(rto, DTLS_MS_TO_TICKS(ctx->rto.max));
+}
+
+/**
+ * Returns the retransmission timeout of a new flight of @p peer. The
+ * caller must hold the sendqueue lock.
+ */
+static dtls_tick_t
+dtls_peer_rto(const dtls_context_t *ctx, const dtls_peer_t *peer) {
+  if (peer->srtt)
+    return dtls_rto(ctx, peer->srtt, peer->rttvar);
+  return dtls_rto(ctx, ctx->srtt, ctx->rttvar);
+}
+
+/** Adds the round-trip time sample @p r to an estimate as in RFC 6298. */
+static void
+dtls_rtt_update(dtls_tick_t *srtt, dtls_tick_t *rttvar, dtls_tick_t r) {
+  if (!*srtt) {
+    *srtt = r;
+    *rttvar = r / 2;
+  } else {
+    dtls_tick_t err = *srtt > r ? *srtt - r : r - *srtt;
+
+    *rttvar = (3 * *rttvar + err) / 4;
+    /* stays non-zero, as r is at least one tick */
+    *srtt = (7 * *srtt + r) / 8;
+  }
+}
+
+/**
+ * Returns @p timeout extended by a random amount of up to the jitter
+ * configured for @p ctx. The caller must hold the sendqueue lock.
+ */
+static dtls_tick_t
+dtls_jitter(dtls_context_t *ctx, dtls_tick_t timeout) {
+  uint32_t x = ctx->jitter_state;
+  uint64_t range = (uint64_t)timeout * ctx->rto.jitter / 100;
+
+  /* xorshift32, good enough to spread the deadlines */
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  ctx->jitter_state = x;
+  return timeout + (dtls_tick_t)(x % (range + 1));
+}
+
+/**
+ * Returns @p budget with @p elapsed ticks worth of @p rate added, up
+ * to one second's worth.
+ */
+static int64_t
+dtls_pacing_refill(int64_t budget, unsigned int rate, int64_t elapsed) {
+  /* after this time, the budget is full anyway */
+  int64_t limit = DTLS_TICKS_PER_SECOND + (budget < 0 ? -budget / rate + 1 : 0);
+
+  return min(budget + min(elapsed, limit) * rate,
+             (int64_t)rate * DTLS_TICKS_PER_SECOND);
+}
+
+/**
+ * Adds the budget accumulated since the last update and returns
+ * non-zero if there is budget left for a retransmission at @p now.
+ * The caller must hold the sendqueue lock.
+ */
+static int
+dtls_pacing_allows(dtls_context_t *ctx, dtls_tick_t now) {
+  const dtls_pacing_t *pacing = &ctx->pacing;
+  int64_t elapsed = 0;
+
+  /* another thread may have updated the budget with a later time */
+  if (!DTLS_IS_BEFORE_TIME(now, ctx->pacing_time)) {
+    elapsed = (int64_t)(now - ctx->pacing_time);
+    ctx->pacing_time = now;
+  }
+  if (pacing->bytes_per_second)
+    ctx->pacing_bytes = dtls_pacing_refill(ctx->pacing_bytes,
+                                           pacing->bytes_per_second, elapsed);
+  if (pacing->datagrams_per_second)
+    ctx->pacing_datagrams = dtls_pacing_refill(ctx->pacing_datagrams,
+                                               pacing->datagrams_per_second,
+                                               elapsed);
+  return (!pacing->bytes_per_second || ctx->pacing_bytes > 0) &&
+    (!pacing->datagrams_per_second || ctx->pacing_datagrams > 0);
+}
+
+/**
+ * Returns the time after @p now when the retransmission budget of
+ * @p ctx is positive again. The caller must hold the sendqueue lock.
+ */
+static dtls_tick_t
+dtls_pacing_resume(const dtls_context_t *ctx, dtls_tick_t now) {
+  int64_t wait = 0;
+
+  if (ctx->pacing.bytes_per_second && ctx->pacing_bytes <= 0)
+    wait = -ctx->pacing_bytes / ctx->pacing.bytes_per_second + 1;
+  if (ctx->pacing.datagrams_per_second && ctx->pacing_datagrams <= 0)
+    wait = max(wait, -ctx->pacing_datagrams / ctx->pacing.datagrams_per_second + 1);
+  return now + (dtls_tick_t)wait;
+}
+
+/*
+ * Each message of a flight is stored with its content type, epoch and
+ * length, followed by the unencrypted message, so that a
+ * retransmission only has to build the records.
+ */
+#define DTLS_FLIGHT_MSG_HEADER 5
+
+/**
+ * Appends a message to the flight of @p peer and restarts the
+ * retransmission timer. A new flight is started if there is none.
+ * This function returns @c 0 on success, or less than zero if no
+ * memory is available or an alert is pending.
+ */
+static int
+dtls_flight_add(dtls_context_t *ctx, dtls_peer_t *peer, uint16_t epoch,
+                uint8_t type, uint8 *buf_array[], size_t buf_len_array[],
+                size_t buf_array_len, size_t length) {
+  netq_t *flight, *node, *finished = NULL;
+  dtls_tick_t now;
+  uint8 *p;
+  size_t i;
+  int res = 0;
+
+  dtls_sendqueue_lock(ctx);
+  flight = peer->retransmit;
+  if (flight && flight->job == FINISHED) {
+    /* a new handshake replaces the last flight of the previous one */
+    netq_wheel_remove(&ctx->sendqueue, flight);
+    finished = flight;
+    flight = peer->retransmit = NULL;
+  }
+  if (flight && flight->job != RESEND) {
+    res = -1;
+    goto out;
+  }
+
+  for (node = flight; node && node->flight_next; node = node->flight_next)
+    ;
+  if (!node || node->length + DTLS_FLIGHT_MSG_HEADER + length > DTLS_MAX_BUF) {
+    netq_t *n = netq_node_new(ctx->mem, max(DTLS_FLIGHT_MSG_HEADER + length,
+                                            DTLS_MAX_BUF));
+
+    if (!n) {
+      res = -1;
+      goto out;
+    }
+    if (node) {
+      node->flight_next = n;
+    } else {
+      flight = peer->retransmit = n;
+      n->peer = peer;
+#ifdef DTLS_CONCURRENT_PEERS
+      n->session = peer->session;
+#endif /* DTLS_CONCURRENT_PEERS */
+      n->job = RESEND;
+      n->timeout = dtls_jitter(ctx, dtls_peer_rto(ctx, peer));
+    }
+    node = n;
+  }
+
+  p = node->data + node->length;
+  dtls_int_to_uint8(p, type);
+  dtls_int_to_uint16(p + 1, epoch);
+  dtls_int_to_uint16(p + 3, length);
+  p += DTLS_FLIGHT_MSG_HEADER;
+  for (i = 0; i < buf_array_len; i++) {
+    memcpy(p, buf_array[i], buf_len_array[i]);
+    p += buf_len_array[i];
+  }
+  node->length += DTLS_FLIGHT_MSG_HEADER + length;
+
+  dtls_ticks(&now);
+  flight->sent = now;
+  flight->t = now + flight->timeout;
+  flight->retransmit_cnt = 0;
+  netq_wheel_remove(&ctx->sendqueue, flight);
+  netq_wheel_insert(&ctx->sendqueue, flight);
+ out:
+  dtls_sendqueue_unlock(ctx);
+  netq_flight_free(finished);
+  return res;
+}
+
+static dtls_peer_t *
+dtls_find_peer(const dtls_context_t *ctx,
+               const dtls_session_key_t *key, uint32_t hash) {
   dtls_peer_t *p;
-  FIND_PEER(ctx->peers, session, p);
+  dtls_peers_rdlock(ctx);
+  FIND_PEER(ctx->peers, key, hash, p);
+  dtls_peers_unlock(ctx);
   return p;
 }
 
+dtls_peer_t *
+dtls_get_peer(const dtls_context_t *ctx, const session_t *session) {
+  dtls_session_key_t key;
+
+  dtls_session_key(session, &key);
+  return dtls_find_peer(ctx, &key, dtls_session_key_hash(&key));
+}
+
 /**
  * Adds @p peer to list of peers in @p ctx. This function returns @c 0
  * on success, or a negative value on error (e.g. due to insufficient
- * storage).
+ * storage or when another peer with the same session exists).
  */
 static int
 dtls_add_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
-  ADD_PEER(ctx->peers, session, peer);
+  uint32_t hash = dtls_session_key_hash(&peer->key);
+  int res;
+#ifdef DTLS_CONCURRENT_PEERS
+  dtls_peer_t *p;
+
+  dtls_peers_wrlock(ctx);
+  FIND_PEER(ctx->peers, &peer->key, hash, p);
+  if (p) {
+    dtls_peers_unlock(ctx);
+    return -1;
+  }
+#endif /* DTLS_CONCURRENT_PEERS */
+  ADD_PEER(ctx->peers, hash, peer, res);
+  dtls_peers_unlock(ctx);
+
+  if (res == 0) {
+    dtls_lru_lock(ctx);
+    ctx->num_peers++;
+    dtls_ticks(&peer->last_seen);
+    peer->established = 0;
+    DL_APPEND2(ctx->handshakes, peer, lru_prev, lru_next);
+    dtls_lru_unlock(ctx);
+  }
+  return res;
+}
+
+/**
+ * Removes @p peer from the list of peers in @p ctx. Nothing is done
+ * if the peer has already been removed.
+ */
+static void
+dtls_del_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
+  int listed;
+
+  dtls_lru_lock(ctx);
+  listed = peer->lru_prev != NULL;
+  if (listed) {
+    if (peer->established) {
+      DL_DELETE2(ctx->lru, peer, lru_prev, lru_next);
+      ctx->num_established--;
+    } else {
+      DL_DELETE2(ctx->handshakes, peer, lru_prev, lru_next);
+    }
+    peer->lru_prev = NULL;
+    ctx->num_peers--;
+  }
+  dtls_lru_unlock(ctx);
+
+  if (listed) {
+    dtls_peers_wrlock(ctx);
+    DEL_PEER(ctx->peers, peer);
+#if DTLS_CID_LENGTH > 0
+    if (peer->read_cid_length)
+      DEL_CID_PEER(ctx, peer);
+#endif /* DTLS_CID_LENGTH > 0 */
+    dtls_peers_unlock(ctx);
+  }
+}
+
+/**
+ * Marks @p peer as most recently used after an authenticated record.
+ * A peer is moved to the list of established peers when its first
+ * handshake is completed.
+ */
+static void
+dtls_touch_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_lru_lock(ctx);
+  if (!peer->lru_prev) {
+    /* already removed from the context */
+    dtls_lru_unlock(ctx);
+    return;
+  } else if (peer->established) {
+    if (peer->lru_next) {
+      DL_DELETE2(ctx->lru, peer, lru_prev, lru_next);
+      DL_APPEND2(ctx->lru, peer, lru_prev, lru_next);
+    }
+  } else if (peer->state == DTLS_STATE_CONNECTED) {
+    DL_DELETE2(ctx->handshakes, peer, lru_prev, lru_next);
+    DL_APPEND2(ctx->lru, peer, lru_prev, lru_next);
+    peer->established = 1;
+    ctx->num_established++;
+  } else {
+    /* the handshake deadline is not extended */
+    dtls_lru_unlock(ctx);
+    return;
+  }
+  dtls_ticks(&peer->last_seen);
+  dtls_lru_unlock(ctx);
+}
+
+#if DTLS_CID_LENGTH > 0
+/**
+ * Gives @p peer a connection id that no other peer of @p ctx has been
+ * given. This function returns @c 0 on success, or a negative value
+ * if no free id has been found.
+ */
+static int
+dtls_add_cid(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_peer_t *p;
+  int tries, res = -1;
+
+  memcpy(peer->read_cid, ctx->cid_prefix, ctx->cid_prefix_length);
+  for (tries = 0; tries < 3 && res < 0; tries++) {
+    dtls_prng(peer->read_cid + ctx->cid_prefix_length,
+              DTLS_CID_LENGTH - ctx->cid_prefix_length);
+
+    dtls_peers_wrlock(ctx);
+    FIND_CID_PEER(ctx, peer->read_cid, p);
+    if (!p) {
+      peer->read_cid_length = DTLS_CID_LENGTH;
+      ADD_CID_PEER(ctx, peer, res);
+    }
+    dtls_peers_unlock(ctx);
+  }
+  return res;
+}
+
+/**
+ * Moves @p peer to the address @p session, whose session key @p key
+ * has the hash value @p hash. This function returns @c 0 on success,
+ * or a negative value if another peer has that address.
+ */
+static int
+dtls_move_peer(dtls_context_t *ctx, dtls_peer_t *peer,
+               const session_t *session,
+               const dtls_session_key_t *key, uint32_t hash) {
+  dtls_session_key_t old_key;
+  dtls_peer_t *p;
+  int res;
+
+  dtls_peers_wrlock(ctx);
+  FIND_PEER(ctx->peers, key, hash, p);
+  if (p) {
+    dtls_peers_unlock(ctx);
+    return -1;
+  }
+  DEL_PEER(ctx->peers, peer);
+  /* the LRU lists are walked by key, see dtls_expire_list() */
+  dtls_lru_lock(ctx);
+  old_key = peer->key;
+  peer->key = *key;
+  dtls_lru_unlock(ctx);
+  ADD_PEER(ctx->peers, hash, peer, res);
+  if (res < 0) {
+    dtls_lru_lock(ctx);
+    peer->key = old_key;
+    dtls_lru_unlock(ctx);
+    ADD_PEER(ctx->peers, dtls_session_key_hash(&old_key), peer, res);
+    dtls_peers_unlock(ctx);
+    return -1;
+  }
+  dtls_peers_unlock(ctx);
+
+  /* the address is used for retransmissions, see dtls_check_retransmit() */
+  dtls_sendqueue_lock(ctx);
+  peer->session = *session;
+#ifdef DTLS_CONCURRENT_PEERS
+  /* a queued flight is taken with the session lock of its copy */
+  if (peer->retransmit)
+    peer->retransmit->session = *session;
+#endif /* DTLS_CONCURRENT_PEERS */
+  dtls_sendqueue_unlock(ctx);
   return 0;
 }
+#endif /* DTLS_CID_LENGTH > 0 */
 
 int
 dtls_writev(struct dtls_context_t *ctx,
 	    session_t *dst, uint8 *buf_array[],
 	    size_t buf_len_array[], size_t buf_array_len) {
 
-  dtls_peer_t *peer = dtls_get_peer(ctx, dst);
+  dtls_peer_t *peer;
+  int res;
+
+  dtls_session_lock(ctx, dst);
+  peer = dtls_get_peer(ctx, dst);
 
   /* Check if peer connection already exists */
   if (!peer) { /* no ==> create one */
-    int res;
-
     /* dtls_connect() returns a value greater than zero if a new
      * connection attempt is made, 0 for session reuse. */
     res = dtls_connect(ctx, dst);
-
-    return (res >= 0) ? 0 : res;
+    if (res > 0)
+      res = 0;
   } else { /* a session exists, check if it is in state connected */
 
-    if (peer->state != DTLS_STATE_CONNECTED) {
-      return 0;
+    if (peer->state != DTLS_STATE_CONNECTED &&
+        !(peer->handshake_params && peer->handshake_params->false_start)) {
+      res = 0;
     } else {
-      return dtls_send_multi(ctx, peer, dtls_security_params(peer),
-                             &peer->session, DTLS_CT_APPLICATION_DATA,
-                             buf_array, buf_len_array, buf_array_len);
+      res = dtls_send_multi(ctx, peer, dtls_security_params(peer),
+                            &peer->session, DTLS_CT_APPLICATION_DATA,
+                            buf_array, buf_len_array, buf_array_len);
     }
   }
+  dtls_session_unlock(ctx, dst);
+  return res;
 }
 
 int
@@ -541,6 +1155,9 @@ static char const content_types[] = {
   DTLS_CT_ALERT,
   DTLS_CT_HANDSHAKE,
   DTLS_CT_APPLICATION_DATA,
+#if DTLS_CID_LENGTH > 0
+  DTLS_CT_TLS12_CID,
+#endif /* DTLS_CID_LENGTH > 0 */
   0 				/* end marker */
 };
 
@@ -564,6 +1181,21 @@ known_content_type(const uint8_t *msg) {
 }
 #endif /* DTLS_CHECK_CONTENTTYPE */
 
+/**
+ * Returns the length of the header of the record \p msg. The header
+ * of a tls12_cid record ends with the connection id we have given the
+ * peer, see RFC 9146.
+ */
+static inline size_t
+dtls_record_header_length(const uint8 *msg) {
+#if DTLS_CID_LENGTH > 0
+  if (msg[0] == DTLS_CT_TLS12_CID)
+    return DTLS_RH_LENGTH + DTLS_CID_LENGTH;
+#endif /* DTLS_CID_LENGTH > 0 */
+  (void)msg;
+  return DTLS_RH_LENGTH;
+}
+
 /**
  * Checks if \p msg points to a valid DTLS record. If
  *
@@ -592,7 +1224,12 @@ is_record(uint8 *msg, size_t msglen) {
     } else {
       return 0;
     }
-    rlen = DTLS_RH_LENGTH + dtls_uint16_to_int(DTLS_RECORD_HEADER(msg)->length);
+    rlen = dtls_record_header_length(msg);
+    if (msglen < rlen) {
+      return 0;
+    }
+    /* the length is the last field of the header */
+    rlen += dtls_uint16_to_int(msg + rlen - sizeof(uint16));
 
     /* we do not accept wrong length field in record header */
     if (rlen > msglen) {
@@ -928,6 +1565,8 @@ dtls_handshake_type_to_name(int type) {
     return "server_hello";
   case DTLS_HT_HELLO_VERIFY_REQUEST:
     return "hello_verify_request";
+  case DTLS_HT_NEW_SESSION_TICKET:
+    return "new_session_ticket";
   case DTLS_HT_CERTIFICATE:
     return "certificate";
   case DTLS_HT_SERVER_KEY_EXCHANGE:
@@ -958,6 +1597,8 @@ dtls_message_type_to_name(int type) {
     return "handshake";
   case DTLS_CT_APPLICATION_DATA:
     return "application_data";
+  case DTLS_CT_TLS12_CID:
+    return "tls12_cid";
   default:
     return NULL;
   }
@@ -965,51 +1606,448 @@ dtls_message_type_to_name(int type) {
 
 
 /**
- * Calculate the pre master secret and after that calculate the master-secret.
+ * Derives the master secret and the key block from the pre master
+ * secret. If @p session_hash is not NULL, the extended master secret
+ * (RFC 7627) is calculated. @p key_block may point to the same storage
+ * as @p pre_master_secret.
  */
-static int
-calculate_key_block(dtls_context_t *ctx,
-		    dtls_handshake_parameters_t *handshake,
-		    dtls_peer_t *peer,
-		    session_t *session,
-		    dtls_peer_type role) {
-  (void) ctx;
-  (void) session;
-  unsigned char *pre_master_secret;
-  int pre_master_len = 0;
-  dtls_security_parameters_t *security = dtls_security_params_next(peer);
-  uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
-  (void)role; /* The macro dtls_kb_size() does not use role. */
-
-  if (!security) {
-    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+static void
+dtls_derive_key_block(const unsigned char *pre_master_secret,
+		      size_t pre_master_len,
+		      const unsigned char *session_hash,
+		      const unsigned char *client_random,
+		      const unsigned char *server_random,
+		      unsigned char *master_secret,
+		      unsigned char *key_block, size_t key_block_length) {
+  if (session_hash) {
+    dtls_prf(pre_master_secret, pre_master_len,
+	     PRF_LABEL(extended_master), PRF_LABEL_SIZE(extended_master),
+	     session_hash, DTLS_HMAC_DIGEST_SIZE,
+	     NULL, 0,
+	     master_secret,
+	     DTLS_MASTER_SECRET_LENGTH);
+  }
+  else {
+    dtls_prf(pre_master_secret, pre_master_len,
+	     PRF_LABEL(master), PRF_LABEL_SIZE(master),
+	     client_random, DTLS_RANDOM_LENGTH,
+	     server_random, DTLS_RANDOM_LENGTH,
+	     master_secret,
+	     DTLS_MASTER_SECRET_LENGTH);
   }
 
-  pre_master_secret = security->key_block;
-  switch (get_key_exchange_algorithm(handshake->cipher_index)) {
-  case DTLS_KEY_EXCHANGE_PSK:
-#ifdef DTLS_PSK
-    {
-      unsigned char psk[DTLS_PSK_MAX_KEY_LEN];
-      int len;
+  /* create key_block from master_secret
+   * key_block = PRF(master_secret,
+                    "key expansion" + tmp.random.server + tmp.random.client) */
 
-      len = CALL(ctx, get_psk_info, session, DTLS_PSK_KEY,
-             handshake->keyx.psk.identity,
-             handshake->keyx.psk.id_length,
-             psk, DTLS_PSK_MAX_KEY_LEN);
-      if (len < 0) {
-        dtls_crit("no psk key for session available\n");
-        return len;
-      }
-    /* Temporarily use the key_block storage space for the pre master secret. */
-      pre_master_len = dtls_psk_pre_master_secret(psk, len,
-                        pre_master_secret,
-                        MAX_KEYBLOCK_LENGTH);
+  dtls_prf(master_secret,
+	   DTLS_MASTER_SECRET_LENGTH,
+	   PRF_LABEL(key), PRF_LABEL_SIZE(key),
+	   server_random, DTLS_RANDOM_LENGTH,
+	   client_random, DTLS_RANDOM_LENGTH,
+	   key_block,
+	   key_block_length);
+}
 
-      dtls_debug_hexdump("psk", psk, len);
+/*
+ * The session cache of a context. A server looks up its sessions by
+ * id, a client by the address of the server, and optionally also by
+ * id. Expired entries are released when they are found.
+ */
+#if DTLS_SESSION_CACHE_SIZE > 0
+static dtls_session_cache_entry_t *
+dtls_session_cache_find(dtls_context_t *ctx, dtls_peer_type role,
+			const session_t *remote,
+			const uint8 *id, size_t id_length) {
+  dtls_session_cache_entry_t *entry;
+  dtls_tick_t now;
 
-      memset(psk, 0, DTLS_PSK_MAX_KEY_LEN);
-      if (pre_master_len < 0) {
+  dtls_ticks(&now);
+  for (entry = ctx->sessions;
+       entry < ctx->sessions + DTLS_SESSION_CACHE_SIZE; entry++) {
+    if (!entry->id_length || entry->role != role)
+      continue;
+    if (now - entry->created >=
+        (dtls_tick_t)ctx->session_lifetime * DTLS_TICKS_PER_SECOND) {
+      memset(entry, 0, sizeof(dtls_session_cache_entry_t));
+      continue;
+    }
+    if ((!remote || dtls_session_equals(&entry->remote, remote)) &&
+        (!id || (entry->id_length == id_length &&
+                 memcmp(entry->id, id, id_length) == 0)))
+      return entry;
+  }
+  return NULL;
+}
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+
+/**
+ * Copies the session of @p ctx with the given @p remote and @p id
+ * to @p result. Either may be @c NULL to match any.
+ *
+ * @return @c 0 if the session has been found, less than zero
+ *   otherwise.
+ */
+static int
+dtls_session_cache_get(dtls_context_t *ctx, dtls_peer_type role,
+		       const session_t *remote,
+		       const uint8 *id, size_t id_length,
+		       dtls_session_cache_entry_t *result) {
+  int res = -1;
+#if DTLS_SESSION_CACHE_SIZE > 0
+  dtls_session_cache_entry_t *entry;
+
+  dtls_sessions_lock(ctx);
+  entry = dtls_session_cache_find(ctx, role, remote, id, id_length);
+  if (entry) {
+    memcpy(result, entry, sizeof(dtls_session_cache_entry_t));
+    res = 0;
+  }
+  dtls_sessions_unlock(ctx);
+#else /* DTLS_SESSION_CACHE_SIZE > 0 */
+  (void)ctx;
+  (void)role;
+  (void)remote;
+  (void)id;
+  (void)id_length;
+  (void)result;
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+  return res;
+}
+
+/**
+ * Adds the session of @p peer, whose handshake is just completing, to
+ * the cache of @p ctx. The oldest session is replaced if the cache is
+ * full, a client replaces the previous session of the same server.
+ */
+static void
+dtls_session_cache_put(dtls_context_t *ctx, const dtls_peer_t *peer) {
+#if DTLS_SESSION_CACHE_SIZE > 0
+  const dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_entry_t *entry, *slot = NULL;
+
+  if (!ctx->session_lifetime)
+    return;
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  if (!handshake->session_id_length && !handshake->ticket_length)
+    return;
+#else /* DTLS_SESSION_TICKET_LENGTH > 0 */
+  if (!handshake->session_id_length)
+    return;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+  dtls_sessions_lock(ctx);
+  for (entry = ctx->sessions;
+       entry < ctx->sessions + DTLS_SESSION_CACHE_SIZE; entry++) {
+    if (peer->role == DTLS_CLIENT && entry->id_length &&
+        entry->role == DTLS_CLIENT &&
+        dtls_session_equals(&entry->remote, &peer->session)) {
+      slot = entry;
+      break;
+    }
+    if (!slot || (slot->id_length && (!entry->id_length ||
+        DTLS_IS_BEFORE_TIME(entry->created, slot->created))))
+      slot = entry;
+  }
+
+  memcpy(&slot->remote, &peer->session, sizeof(session_t));
+  dtls_ticks(&slot->created);
+  slot->role = peer->role;
+  slot->id_length = handshake->session_id_length;
+  memcpy(slot->id, handshake->session_id, handshake->session_id_length);
+  memcpy(slot->master_secret, handshake->tmp.master_secret,
+         DTLS_MASTER_SECRET_LENGTH);
+  slot->cipher_index = handshake->cipher_index;
+  slot->extended_master_secret = handshake->extended_master_secret;
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  slot->ticket_length = handshake->ticket_length;
+  memcpy(slot->ticket, handshake->ticket, handshake->ticket_length);
+  if (!slot->id_length) {
+    /* RFC 5077, 3.4: the client chooses the id of a ticket, the
+     * server sends it back when it resumes the session */
+    slot->id_length = DTLS_SESSION_ID_LENGTH;
+    dtls_prng(slot->id, DTLS_SESSION_ID_LENGTH);
+  }
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+  dtls_sessions_unlock(ctx);
+#else /* DTLS_SESSION_CACHE_SIZE > 0 */
+  (void)ctx;
+  (void)peer;
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+}
+
+/**
+ * Removes the sessions of @p peer from the cache of @p ctx, as they
+ * must not be resumed after a fatal alert.
+ */
+static void
+dtls_session_cache_remove(dtls_context_t *ctx, const dtls_peer_t *peer) {
+#if DTLS_SESSION_CACHE_SIZE > 0
+  const dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_entry_t *entry;
+
+  dtls_sessions_lock(ctx);
+  while ((entry = dtls_session_cache_find(ctx, peer->role, &peer->session,
+                                          NULL, 0)) ||
+         (handshake && handshake->session_id_length &&
+          (entry = dtls_session_cache_find(ctx, peer->role, NULL,
+                                           handshake->session_id,
+                                           handshake->session_id_length)))) {
+    memset(entry, 0, sizeof(dtls_session_cache_entry_t));
+  }
+  dtls_sessions_unlock(ctx);
+#else /* DTLS_SESSION_CACHE_SIZE > 0 */
+  (void)ctx;
+  (void)peer;
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+}
+
+#if DTLS_SESSION_TICKET_LENGTH > 0
+/*
+ * A session ticket (RFC 5077) consists of the name of the key, a
+ * random nonce, and the cipher suite, the extended master secret flag
+ * and the master secret of the session, encrypted and authenticated
+ * together with the key name with AES-128-CCM.
+ */
+#define DTLS_TICKET_NONCE_LENGTH 12 /* L = 3 */
+#define DTLS_TICKET_MAC_LENGTH 16
+#define DTLS_TICKET_STATE_LENGTH \
+  (sizeof(uint16) + sizeof(uint8) + DTLS_MASTER_SECRET_LENGTH)
+#define DTLS_TICKET_LENGTH                                          \
+  (DTLS_TICKET_KEY_NAME_LENGTH + DTLS_TICKET_NONCE_LENGTH +         \
+   DTLS_TICKET_STATE_LENGTH + DTLS_TICKET_MAC_LENGTH)
+
+/**
+ * Replaces the generated ticket key of @p ctx after the session
+ * lifetime. The previous key is accepted for another lifetime, so a
+ * ticket is valid for one to two lifetimes. Must be called with the
+ * sessions lock held.
+ */
+static void
+dtls_ticket_keys_update(dtls_context_t *ctx) {
+  const dtls_tick_t lifetime =
+    (dtls_tick_t)ctx->session_lifetime * DTLS_TICKS_PER_SECOND;
+  dtls_tick_t now, age;
+
+  if (ctx->ticket_keys_external)
+    return;
+
+  dtls_ticks(&now);
+  age = now - ctx->ticket_key_created;
+  if (ctx->num_ticket_keys && age < lifetime)
+    return;
+
+  if (ctx->num_ticket_keys && age < 2 * lifetime) {
+    ctx->ticket_keys[1] = ctx->ticket_keys[0];
+    ctx->num_ticket_keys = 2;
+    ctx->ticket_key_created += lifetime;
+  } else {
+    ctx->num_ticket_keys = 1;
+    ctx->ticket_key_created = now;
+  }
+  dtls_prng((unsigned char *)&ctx->ticket_keys[0], sizeof(dtls_ticket_key_t));
+}
+
+/**
+ * Creates a ticket for the session negotiated with @p handshake in
+ * @p buf, which must provide DTLS_TICKET_LENGTH bytes.
+ *
+ * @return The length of the ticket, or less than zero on error.
+ */
+static int
+dtls_ticket_seal(dtls_context_t *ctx,
+		 const dtls_handshake_parameters_t *handshake, uint8 *buf) {
+  uint8 state[DTLS_TICKET_STATE_LENGTH];
+  dtls_ccm_params_t params = { NULL, DTLS_TICKET_MAC_LENGTH, 3 };
+  dtls_ticket_key_t key;
+  uint8 *p = state;
+  int res;
+
+  dtls_sessions_lock(ctx);
+  dtls_ticket_keys_update(ctx);
+  key = ctx->ticket_keys[0];
+  dtls_sessions_unlock(ctx);
+
+  dtls_int_to_uint16(p, get_cipher_suite(handshake->cipher_index));
+  p += sizeof(uint16);
+  dtls_int_to_uint8(p, handshake->extended_master_secret);
+  p += sizeof(uint8);
+  memcpy(p, handshake->tmp.master_secret, DTLS_MASTER_SECRET_LENGTH);
+
+  p = buf;
+  memcpy(p, key.name, DTLS_TICKET_KEY_NAME_LENGTH);
+  p += DTLS_TICKET_KEY_NAME_LENGTH;
+  dtls_prng(p, DTLS_TICKET_NONCE_LENGTH);
+  params.nonce = p;
+  p += DTLS_TICKET_NONCE_LENGTH;
+
+  res = dtls_encrypt_params(&params, state, sizeof(state), p,
+                            key.key, DTLS_TICKET_KEY_LENGTH,
+                            buf, DTLS_TICKET_KEY_NAME_LENGTH);
+  memset(state, 0, sizeof(state));
+  memset(&key, 0, sizeof(key));
+  if (res < 0)
+    return res;
+  return (p - buf) + res;
+}
+
+/**
+ * Decrypts the session in @p ticket, that a client has sent to
+ * resume it. The cipher index of @p session refers to the cipher
+ * suites of @p handshake.
+ *
+ * @return The index of the ticket key, or less than zero if the ticket
+ *   is not valid.
+ */
+static int
+dtls_ticket_open(dtls_context_t *ctx,
+		 const dtls_handshake_parameters_t *handshake,
+		 const uint8 *ticket, size_t length,
+		 dtls_session_cache_entry_t *session) {
+  uint8 state[DTLS_TICKET_STATE_LENGTH + DTLS_TICKET_MAC_LENGTH];
+  dtls_ccm_params_t params = { NULL, DTLS_TICKET_MAC_LENGTH, 3 };
+  dtls_ticket_key_t key;
+  const uint8 *p = state;
+  int i, found, res;
+
+  if (length != DTLS_TICKET_LENGTH)
+    return -1;
+
+  dtls_sessions_lock(ctx);
+  dtls_ticket_keys_update(ctx);
+  for (i = 0; i < ctx->num_ticket_keys; i++) {
+    if (memcmp(ctx->ticket_keys[i].name, ticket,
+               DTLS_TICKET_KEY_NAME_LENGTH) == 0)
+      break;
+  }
+  found = i < ctx->num_ticket_keys;
+  if (found)
+    key = ctx->ticket_keys[i];
+  dtls_sessions_unlock(ctx);
+
+  if (!found) {
+    dtls_info("unknown session ticket key\n");
+    return -1;
+  }
+
+  params.nonce = ticket + DTLS_TICKET_KEY_NAME_LENGTH;
+  res = dtls_decrypt_params(&params,
+                            params.nonce + DTLS_TICKET_NONCE_LENGTH,
+                            sizeof(state), state,
+                            key.key, DTLS_TICKET_KEY_LENGTH,
+                            ticket, DTLS_TICKET_KEY_NAME_LENGTH);
+  memset(&key, 0, sizeof(key));
+  if (res != DTLS_TICKET_STATE_LENGTH) {
+    dtls_warn("cannot decrypt session ticket\n");
+    memset(state, 0, sizeof(state));
+    return -1;
+  }
+
+  memset(session, 0, sizeof(dtls_session_cache_entry_t));
+  session->role = DTLS_SERVER;
+  session->cipher_index =
+    get_cipher_index(handshake->user_parameters.cipher_suites,
+                     dtls_uint16_to_int(p));
+  p += sizeof(uint16);
+  session->extended_master_secret = dtls_uint8_to_int(p) != 0;
+  p += sizeof(uint8);
+  memcpy(session->master_secret, p, DTLS_MASTER_SECRET_LENGTH);
+  memset(state, 0, sizeof(state));
+  return i;
+}
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+#ifdef DTLS_ECC
+/**
+ * Returns the job of @p type of @p handshake if it has been completed,
+ * NULL otherwise.
+ */
+static dtls_crypto_job_t *
+dtls_crypto_job_peek(const dtls_handshake_parameters_t *handshake,
+		     dtls_crypto_job_type_t type) {
+  dtls_crypto_job_t *job = handshake ? handshake->crypto_job : NULL;
+
+  if (job && job->type == type && job->state == DTLS_CRYPTO_JOB_DONE)
+    return job;
+  return NULL;
+}
+
+/**
+ * Like dtls_crypto_job_peek(), but detaches the job from @p handshake.
+ * The caller must release the job with dtls_crypto_job_free().
+ */
+static dtls_crypto_job_t *
+dtls_crypto_job_take(dtls_handshake_parameters_t *handshake,
+		     dtls_crypto_job_type_t type) {
+  dtls_crypto_job_t *job = dtls_crypto_job_peek(handshake, type);
+
+  if (job)
+    handshake->crypto_job = NULL;
+  return job;
+}
+#endif /* DTLS_ECC */
+
+/**
+ * Calculate the pre master secret and after that calculate the master-secret.
+ */
+static int
+calculate_key_block(dtls_context_t *ctx,
+		    dtls_handshake_parameters_t *handshake,
+		    dtls_peer_t *peer,
+		    session_t *session,
+		    dtls_peer_type role) {
+  (void) ctx;
+  (void) session;
+  unsigned char *pre_master_secret;
+  int pre_master_len = 0;
+  dtls_security_parameters_t *security = dtls_security_params_next(peer);
+  uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
+  unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
+#ifdef DTLS_ECC
+  dtls_crypto_job_t *job;
+#endif /* DTLS_ECC */
+  (void)role; /* The macro dtls_kb_size() does not use role. */
+
+  if (!security) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+#ifdef DTLS_ECC
+  job = dtls_crypto_job_take(handshake, DTLS_CRYPTO_JOB_KEY_BLOCK);
+  if (job) {
+    /* already derived by the crypto executor */
+    memcpy(master_secret, job->master_secret, DTLS_MASTER_SECRET_LENGTH);
+    memcpy(security->key_block, job->key_block, dtls_kb_size(security, role));
+    dtls_crypto_job_free(job);
+    goto finish;
+  }
+#endif /* DTLS_ECC */
+
+  pre_master_secret = security->key_block;
+  switch (get_key_exchange_algorithm(handshake->cipher_index)) {
+  case DTLS_KEY_EXCHANGE_PSK:
+#ifdef DTLS_PSK
+    {
+      unsigned char psk[DTLS_PSK_MAX_KEY_LEN];
+      int len;
+
+      len = CALL(ctx, get_psk_info, session, DTLS_PSK_KEY,
+             handshake->keyx.psk.identity,
+             handshake->keyx.psk.id_length,
+             psk, DTLS_PSK_MAX_KEY_LEN);
+      if (len < 0) {
+        dtls_crit("no psk key for session available\n");
+        return len;
+      }
+    /* Temporarily use the key_block storage space for the pre master secret. */
+      pre_master_len = dtls_psk_pre_master_secret(psk, len,
+                        pre_master_secret,
+                        MAX_KEYBLOCK_LENGTH);
+
+      dtls_debug_hexdump("psk", psk, len);
+
+      memset(psk, 0, DTLS_PSK_MAX_KEY_LEN);
+      if (pre_master_len < 0) {
         dtls_crit("the psk was too long, for the pre master secret\n");
         return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
       }
@@ -1022,13 +2060,20 @@ calculate_key_block(dtls_context_t *ctx,
   case DTLS_KEY_EXCHANGE_ECDHE_ECDSA:
 #ifdef DTLS_ECC
     {
-      pre_master_len = dtls_ecdh_pre_master_secret(
-                         handshake->keyx.ecdsa.own_eph_priv,
-                         handshake->keyx.ecdsa.other_eph_pub_x,
-                         handshake->keyx.ecdsa.other_eph_pub_y,
-                         sizeof(handshake->keyx.ecdsa.own_eph_priv),
-                         pre_master_secret,
-                         MAX_KEYBLOCK_LENGTH);
+      job = dtls_crypto_job_take(handshake, DTLS_CRYPTO_JOB_CLIENT_KEY_EXCHANGE);
+      if (job) {
+        pre_master_len = job->result < 0 ? job->result : DTLS_EC_KEY_SIZE;
+        memcpy(pre_master_secret, job->pre_master_secret, DTLS_EC_KEY_SIZE);
+        dtls_crypto_job_free(job);
+      } else {
+        pre_master_len = dtls_ecdh_pre_master_secret(
+                           handshake->keyx.ecdsa.own_eph_priv,
+                           handshake->keyx.ecdsa.other_eph_pub_x,
+                           handshake->keyx.ecdsa.other_eph_pub_y,
+                           sizeof(handshake->keyx.ecdsa.own_eph_priv),
+                           pre_master_secret,
+                           MAX_KEYBLOCK_LENGTH);
+      }
       if (pre_master_len < 0) {
         dtls_crit("the curve was too long, for the pre master secret\n");
         return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
@@ -1054,50 +2099,94 @@ calculate_key_block(dtls_context_t *ctx,
   dtls_debug_dump("pre_master_secret", pre_master_secret, pre_master_len);
 
   if (handshake->extended_master_secret) {
-    unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
-
     dtls_hash_finalize(sha256hash, &peer->handshake_params->hs_state.ext_hash);
+  }
 
-    dtls_prf(pre_master_secret, pre_master_len,
-  	     PRF_LABEL(extended_master), PRF_LABEL_SIZE(extended_master),
-	     sha256hash, sizeof(sha256hash),
-	     NULL, 0,
-	     master_secret,
-	     DTLS_MASTER_SECRET_LENGTH);
+  dtls_derive_key_block(pre_master_secret, pre_master_len,
+			handshake->extended_master_secret ? sha256hash : NULL,
+			handshake->tmp.random.client,
+			handshake->tmp.random.server,
+			master_secret,
+			security->key_block,
+			dtls_kb_size(security, role));
+
+#ifdef DTLS_ECC
+ finish:
+#endif /* DTLS_ECC */
+  dtls_debug_dump(handshake->extended_master_secret ? "extended_master_secret"
+                  : "master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+
+  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
+  dtls_debug_keyblock(security);
+
+  security->cipher_index = handshake->cipher_index;
+  security->compression = handshake->compression;
+  security->rseq = 0;
 
-    dtls_debug_dump("extended_master_secret", master_secret,
-                    DTLS_MASTER_SECRET_LENGTH);
+  return 0;
+}
+
+/**
+ * Looks up the session the server @p peer resumes with the id in its
+ * ServerHello, and copies it to @p session if it can be resumed with
+ * the negotiated parameters.
+ *
+ * @return @c 0 on success, or a fatal alert otherwise.
+ */
+static int
+dtls_session_resumable(dtls_context_t *ctx, dtls_peer_t *peer,
+		       dtls_session_cache_entry_t *session) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+
+  /* a client only resumes the session of the same server */
+  if (dtls_session_cache_get(ctx, DTLS_CLIENT, &peer->session,
+                             handshake->session_id,
+                             handshake->session_id_length, session) < 0) {
+    dtls_info("session to resume not found\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
   }
-  else {
-    dtls_prf(pre_master_secret, pre_master_len,
-         PRF_LABEL(master), PRF_LABEL_SIZE(master),
-         handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
-         handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
-         master_secret,
-         DTLS_MASTER_SECRET_LENGTH);
 
-    dtls_debug_dump("master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+  /* RFC 7627, section 5.3: the extended master secret must be used
+   * as in the full handshake */
+  if (session->cipher_index != handshake->cipher_index ||
+      session->extended_master_secret != handshake->extended_master_secret) {
+    dtls_warn("parameters differ from the session to resume\n");
+    memset(session, 0, sizeof(dtls_session_cache_entry_t));
+    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
   }
+  return 0;
+}
 
-  /* create key_block from master_secret
-   * key_block = PRF(master_secret,
-                    "key expansion" + tmp.random.server + tmp.random.client) */
+/**
+ * Derives the key block of an abbreviated handshake from the master
+ * secret of @p session. This replaces the random values in the
+ * handshake parameters of @p peer, the ServerHello must have been
+ * created before.
+ */
+static int
+dtls_session_resume(dtls_peer_t *peer, const dtls_session_cache_entry_t *session) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_security_parameters_t *security = dtls_security_params_next(peer);
 
-  dtls_prf(master_secret,
-	   DTLS_MASTER_SECRET_LENGTH,
+  if (!security) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  dtls_prf(session->master_secret, DTLS_MASTER_SECRET_LENGTH,
 	   PRF_LABEL(key), PRF_LABEL_SIZE(key),
 	   handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
 	   handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
 	   security->key_block,
-	   dtls_kb_size(security, role));
+	   dtls_kb_size(security, peer->role));
 
-  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
+  memcpy(handshake->tmp.master_secret, session->master_secret,
+         DTLS_MASTER_SECRET_LENGTH);
   dtls_debug_keyblock(security);
 
   security->cipher_index = handshake->cipher_index;
   security->compression = handshake->compression;
   security->rseq = 0;
-
+  handshake->resumed = 1;
   return 0;
 }
 
@@ -1218,6 +2307,12 @@ dtls_check_tls_extension(dtls_peer_t *peer,
   dtls_handshake_parameters_t *config = peer->handshake_params;
   const int ecdsa = is_key_exchange_ecdhe_ecdsa(config->cipher_index);
 
+  /* the limit of a previous handshake does not apply anymore */
+  peer->record_size_limit = 0;
+#if DTLS_MAX_CID_LENGTH > 0
+  peer->write_cid_length = 0;
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+
   if (data_length < sizeof(uint16)) {
     /* no tls extensions specified */
     if (ecdsa) {
@@ -1292,6 +2387,42 @@ dtls_check_tls_extension(dtls_peer_t *peer,
       case TLS_EXT_EXTENDED_MASTER_SECRET:
           config->extended_master_secret = 1;
         break;
+#if DTLS_RECORD_SIZE_LIMIT > 0
+      case TLS_EXT_RECORD_SIZE_LIMIT:
+        /* RFC 8449, values below 64 are not permitted */
+        if (j != sizeof(uint16) || dtls_uint16_to_int(data) < 64) {
+          dtls_warn("invalid record size limit extension\n");
+          goto error;
+        }
+        peer->record_size_limit = dtls_uint16_to_int(data);
+        break;
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+#if DTLS_MAX_CID_LENGTH > 0
+      case TLS_EXT_CONNECTION_ID:
+        /* RFC 9146, the connection id the peer wants to receive */
+        if (j < sizeof(uint8) || j != sizeof(uint8) + dtls_uint8_to_int(data)) {
+          dtls_warn("invalid connection id extension\n");
+          goto error;
+        }
+        if (j - sizeof(uint8) > DTLS_MAX_CID_LENGTH) {
+          dtls_warn("connection id of %u bytes not supported\n",
+                    j - (unsigned int)sizeof(uint8));
+          /* the server must not send records without it */
+          if (!is_client_hello)
+            goto error;
+          break;
+        }
+        config->connection_id = 1;
+        peer->write_cid_length = j - sizeof(uint8);
+        memcpy(peer->write_cid, data + sizeof(uint8), peer->write_cid_length);
+        break;
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+#if DTLS_SESSION_TICKET_LENGTH > 0
+      case TLS_EXT_SESSION_TICKET:
+        /* the client supports tickets, or the server sends one */
+        config->session_ticket = 1;
+        break;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
       case TLS_EXT_SIG_HASH_ALGO:
         if (verify_ext_sig_hash_algo(data, j))
           goto error;
@@ -1344,6 +2475,36 @@ error:
   return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
 }
 
+#if DTLS_SESSION_TICKET_LENGTH > 0
+/**
+ * Returns the data of the extension @p type in the list of TLS
+ * extensions @p data, and sets @p length to its length. The list must
+ * have been checked with dtls_check_tls_extension().
+ *
+ * @return The extension data, or @c NULL if the list does not contain
+ *   the extension.
+ */
+static const uint8 *
+dtls_get_tls_extension(const uint8 *data, size_t data_length,
+                       uint16_t type, size_t *length) {
+  if (data_length < sizeof(uint16))
+    return NULL;
+  data += sizeof(uint16);
+  data_length -= sizeof(uint16);
+
+  while (data_length >= sizeof(uint16) * 2) {
+    *length = dtls_uint16_to_int(data + sizeof(uint16));
+    if (data_length < sizeof(uint16) * 2 + *length)
+      break;
+    if (dtls_uint16_to_int(data) == type)
+      return data + sizeof(uint16) * 2;
+    data += sizeof(uint16) * 2 + *length;
+    data_length -= sizeof(uint16) * 2 + *length;
+  }
+  return NULL;
+}
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
 /**
  * Parses the ClientHello from the client and updates the internal handshake
  * parameters with the new data for the given \p peer. When the ClientHello
@@ -1354,16 +2515,23 @@ error:
  * \param peer  The remote peer whose security parameters are about to change.
  * \param data  The handshake message with a ClientHello.
  * \param data_length The actual size of \p data.
+ * \param session Set to the session to resume, if the \c resumed flag
+ *              of the handshake parameters is set.
  * \return \c -Something if an error occurred, \c 0 on success.
  */
 static int
 dtls_update_parameters(dtls_context_t *ctx,
 		       dtls_peer_t *peer,
-		       uint8 *data, size_t data_length) {
+		       uint8 *data, size_t data_length,
+		       dtls_session_cache_entry_t *session) {
   int i;
   unsigned int j;
   int ok;
   dtls_handshake_parameters_t *config = peer->handshake_params;
+  const uint8 *cipher_suites;
+  int cipher_suites_length;
+  int resume = 0;
+  int ticket_key = -1;
 
   assert(config);
   assert(data_length > DTLS_HS_LENGTH + DTLS_CH_LENGTH);
@@ -1377,10 +2545,22 @@ dtls_update_parameters(dtls_context_t *ctx,
   data += DTLS_RANDOM_LENGTH;
   data_length -= DTLS_RANDOM_LENGTH;
 
+  /* session_id of a session to resume */
+  i = dtls_uint8_to_int(data);
+  if (i > DTLS_SESSION_ID_LENGTH || data_length < sizeof(uint8) + i) {
+    dtls_debug("invalid session id\n");
+    goto error;
+  }
+  config->session_id_length = i;
+  memcpy(config->session_id, data + sizeof(uint8), i);
+  data += sizeof(uint8) + i;
+  data_length -= sizeof(uint8) + i;
+  if (i && dtls_session_cache_get(ctx, DTLS_SERVER, NULL,
+                                  config->session_id, i, session) == 0) {
+    resume = 1;
+  }
+
   /* Caution: SKIP_VAR_FIELD may jump to error: */
-  /* skip session_id */
-  SKIP_VAR_FIELD(data, data_length, uint8, DTLS_ALERT_HANDSHAKE_FAILURE,
-                 "update_parameters, session_id");
   /* skip cookie */
   SKIP_VAR_FIELD(data, data_length, uint8, DTLS_ALERT_HANDSHAKE_FAILURE,
                  "update_parameters, cookie");
@@ -1409,6 +2589,8 @@ dtls_update_parameters(dtls_context_t *ctx,
 
   data += sizeof(uint16);
   data_length -= sizeof(uint16) + i;
+  cipher_suites = data;
+  cipher_suites_length = i;
 
   config->user_parameters = default_user_parameters;
   if (ctx->h->get_user_parameters != NULL) {
@@ -1477,7 +2659,53 @@ dtls_update_parameters(dtls_context_t *ctx,
     goto error;
   }
 
-  return dtls_check_tls_extension(peer, data, data_length, 1);
+  i = dtls_check_tls_extension(peer, data, data_length, 1);
+  if (i < 0)
+    return i;
+
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  if (!ctx->session_lifetime)
+    config->session_ticket = 0;
+
+  /* RFC 5077, 3.4: a ticket is sent with an id, that the server sends
+   * back to indicate the resumption */
+  if (!resume && config->session_ticket && config->session_id_length) {
+    const uint8 *ticket;
+    size_t ticket_length;
+
+    ticket = dtls_get_tls_extension(data, data_length,
+                                    TLS_EXT_SESSION_TICKET, &ticket_length);
+    if (ticket && ticket_length) {
+      ticket_key = dtls_ticket_open(ctx, config, ticket, ticket_length,
+                                    session);
+      resume = ticket_key >= 0;
+    }
+  }
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+  if (resume) {
+    /* the session is resumed with its cipher suite, if offered, and
+     * with the extended master secret as in the full handshake
+     * (RFC 7627, section 5.3) */
+    const dtls_cipher_t suite = get_cipher_suite(session->cipher_index);
+
+    for (i = 0; i < cipher_suites_length; i += sizeof(uint16)) {
+      if (dtls_uint16_to_int(cipher_suites + i) == suite)
+        break;
+    }
+    if (i < cipher_suites_length &&
+        known_cipher(ctx, session->cipher_index, 0) &&
+        session->extended_master_secret == config->extended_master_secret) {
+      config->cipher_index = session->cipher_index;
+      config->resumed = 1;
+      /* a new ticket replaces only those of a previous key */
+      config->session_ticket = config->session_ticket && ticket_key > 0;
+    } else {
+      dtls_info("cannot resume session, continue with a full handshake\n");
+      memset(session, 0, sizeof(dtls_session_cache_entry_t));
+    }
+  }
+  return 0;
 error:
   return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
 }
@@ -1579,6 +2807,371 @@ clear_hs_hash(dtls_peer_t *peer) {
   dtls_hash_init(&peer->handshake_params->hs_state.hs_hash);
 }
 
+/*
+ * A handshake message in the reassembly buffer is kept in the node
+ * data as if it had been received in a single fragment, followed by a
+ * bitmap of the bytes of its body that have been received. The length
+ * of the node is that of the message.
+ */
+#define REASSEMBLY_BITMAP_SIZE(Length) (((Length) + 7) / 8)
+
+/** Returns the buffered handshake message @p mseq of @p peer, if any. */
+static netq_t *
+dtls_reassembly_get(dtls_peer_t *peer, uint16_t mseq) {
+  netq_t *n = peer->handshake_params->reassembly[mseq % DTLS_HANDSHAKE_WINDOW];
+
+  if (n && dtls_uint16_to_int(DTLS_HANDSHAKE_HEADER(n->data)->message_seq) == mseq)
+    return n;
+  return NULL;
+}
+
+/** Checks if all bytes of the buffered handshake message @p n have
+ *  been received. */
+static int
+dtls_reassembly_complete(const netq_t *n) {
+  size_t length = n->length - DTLS_HS_LENGTH;
+  const uint8 *bitmap = n->data + n->length;
+  size_t i;
+
+  for (i = 0; i < length / 8; i++) {
+    if (bitmap[i] != 0xff)
+      return 0;
+  }
+  return (length & 7) == 0 || bitmap[i] == (1 << (length & 7)) - 1;
+}
+
+/**
+ * Adds the handshake message fragment @p data to the reassembly
+ * buffer of @p peer. Fragments of a message that is already complete
+ * are ignored.
+ *
+ * @return @c 0 if the fragment has been added, less than zero if it
+ *   cannot be buffered.
+ */
+static int
+dtls_reassembly_add(dtls_peer_t *peer, uint8 *data, size_t data_length) {
+  dtls_handshake_header_t *hs_header = DTLS_HANDSHAKE_HEADER(data);
+  uint16_t mseq = dtls_uint16_to_int(hs_header->message_seq);
+  size_t length = dtls_uint24_to_int(hs_header->length);
+  size_t offset = dtls_uint24_to_int(hs_header->fragment_offset);
+  size_t i, end = offset + data_length - DTLS_HS_LENGTH;
+  netq_t **slot = &peer->handshake_params->reassembly[mseq % DTLS_HANDSHAKE_WINDOW];
+  netq_t *n = dtls_reassembly_get(peer, mseq);
+  uint8 *bitmap;
+
+  if (n && (n->data[0] != hs_header->msg_type ||
+            n->length != DTLS_HS_LENGTH + length)) {
+    dtls_warn("fragment does not match the buffered message %u\n", mseq);
+    return -1;
+  }
+
+  if (!n) {
+    if (DTLS_HS_LENGTH + length + REASSEMBLY_BITMAP_SIZE(length) > DTLS_MAX_BUF) {
+      dtls_warn("handshake message %u is too big to buffer\n", mseq);
+      return -1;
+    }
+    n = netq_node_new(dtls_mem_owner(peer), DTLS_HS_LENGTH + length +
+                      REASSEMBLY_BITMAP_SIZE(length));
+    if (!n) {
+      dtls_warn("no space in reassembly buffer\n");
+      return -1;
+    }
+    n->peer = peer;
+    n->length = DTLS_HS_LENGTH + length;
+    memcpy(n->data, data, DTLS_HS_LENGTH);
+    hs_header = DTLS_HANDSHAKE_HEADER(n->data);
+    dtls_int_to_uint24(hs_header->fragment_offset, 0);
+    dtls_int_to_uint24(hs_header->fragment_length, length);
+    memset(n->data + n->length, 0, REASSEMBLY_BITMAP_SIZE(length));
+
+    /* replaces a message that has been left behind */
+    netq_node_free(*slot);
+    *slot = n;
+  } else if (dtls_reassembly_complete(n)) {
+    return 0;
+  }
+
+  memcpy(n->data + DTLS_HS_LENGTH + offset, data + DTLS_HS_LENGTH, end - offset);
+  bitmap = n->data + n->length;
+  for (i = offset; i < end; i++)
+    bitmap[i / 8] |= 1 << (i & 7);
+  return 0;
+}
+
+#ifdef DTLS_ECC
+/** Length of the ServerECDHParams for secp256r1 (RFC 4492, 5.4). */
+#define DTLS_EC_KEY_PARAMS_LENGTH (1 + 2 + 1 + 1 + 2 * DTLS_EC_KEY_SIZE)
+
+/**
+ * Writes the ServerECDHParams for the uncompressed public key
+ * @p pub_x, @p pub_y to @p buf which must provide space for
+ * DTLS_EC_KEY_PARAMS_LENGTH bytes.
+ */
+static void
+dtls_ec_key_params(uint8 *buf, const uint8 *pub_x, const uint8 *pub_y) {
+  dtls_int_to_uint8(buf, TLS_EC_CURVE_TYPE_NAMED_CURVE);
+  buf += sizeof(uint8);
+  dtls_int_to_uint16(buf, TLS_EXT_ELLIPTIC_CURVES_SECP256R1);
+  buf += sizeof(uint16);
+  dtls_int_to_uint8(buf, 1 + 2 * DTLS_EC_KEY_SIZE);
+  buf += sizeof(uint8);
+  dtls_int_to_uint8(buf, 4);
+  buf += sizeof(uint8);
+  memcpy(buf, pub_x, DTLS_EC_KEY_SIZE);
+  buf += DTLS_EC_KEY_SIZE;
+  memcpy(buf, pub_y, DTLS_EC_KEY_SIZE);
+}
+
+void
+dtls_crypto_job_run(dtls_crypto_job_t *job) {
+  uint8 key_params[DTLS_EC_KEY_PARAMS_LENGTH];
+  const uint8 *client_random = job->random;
+  const uint8 *server_random = job->random + DTLS_RANDOM_LENGTH;
+  int res;
+
+  switch (job->type) {
+  case DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE:
+    dtls_ecdsa_generate_key(job->own_eph_priv,
+			    job->own_eph_pub_x, job->own_eph_pub_y,
+			    DTLS_EC_KEY_SIZE);
+    dtls_ec_key_params(key_params, job->own_eph_pub_x, job->own_eph_pub_y);
+    dtls_ecdsa_create_sig(job->own_priv, DTLS_EC_KEY_SIZE,
+			  client_random, DTLS_RANDOM_LENGTH,
+			  server_random, DTLS_RANDOM_LENGTH,
+			  key_params, sizeof(key_params),
+			  job->point_r, job->point_s);
+    job->result = 0;
+    break;
+  case DTLS_CRYPTO_JOB_VERIFY_KEY_EXCHANGE:
+    dtls_ec_key_params(key_params, job->other_eph_pub_x, job->other_eph_pub_y);
+    job->result = dtls_ecdsa_verify_sig(job->other_pub_x, job->other_pub_y,
+					DTLS_EC_KEY_SIZE,
+					client_random, DTLS_RANDOM_LENGTH,
+					server_random, DTLS_RANDOM_LENGTH,
+					key_params, sizeof(key_params),
+					job->sig_r, job->sig_s);
+    break;
+  case DTLS_CRYPTO_JOB_CLIENT_KEY_EXCHANGE:
+    dtls_ecdsa_generate_key(job->own_eph_priv,
+			    job->own_eph_pub_x, job->own_eph_pub_y,
+			    DTLS_EC_KEY_SIZE);
+    res = dtls_ecdh_pre_master_secret(job->own_eph_priv,
+				      job->other_eph_pub_x, job->other_eph_pub_y,
+				      DTLS_EC_KEY_SIZE,
+				      job->pre_master_secret,
+				      sizeof(job->pre_master_secret));
+    job->result = res < 0 ? res : 0;
+    break;
+  case DTLS_CRYPTO_JOB_KEY_BLOCK:
+    res = dtls_ecdh_pre_master_secret(job->own_priv,
+				      job->other_eph_pub_x, job->other_eph_pub_y,
+				      DTLS_EC_KEY_SIZE,
+				      job->pre_master_secret,
+				      sizeof(job->pre_master_secret));
+    if (res < 0) {
+      job->result = res;
+      break;
+    }
+    dtls_derive_key_block(job->pre_master_secret, res,
+			  job->extended_master_secret ? job->session_hash : NULL,
+			  client_random, server_random,
+			  job->master_secret,
+			  job->key_block, sizeof(job->key_block));
+    job->result = 0;
+    break;
+  default:
+    job->result = -1;
+  }
+}
+
+/**
+ * Attaches @p job to the handshake of @p peer and hands it to the
+ * crypto_submit() callback. If the callback does not accept the job,
+ * it is executed immediately.
+ *
+ * @return DTLS_CRYPTO_PENDING if the job was submitted, \c 0 if the
+ *         result is already available.
+ */
+static int
+dtls_crypto_job_start(dtls_context_t *ctx, dtls_peer_t *peer,
+		      dtls_crypto_job_t *job) {
+  assert(!peer->handshake_params->crypto_job);
+
+  memcpy(&job->session, &peer->session, sizeof(session_t));
+  peer->handshake_params->crypto_job = job;
+
+  if (CALL(ctx, crypto_submit, job) == 0) {
+    dtls_debug("submitted crypto job %d\n", job->type);
+    return DTLS_CRYPTO_PENDING;
+  }
+
+  dtls_crypto_job_run(job);
+  job->state = DTLS_CRYPTO_JOB_DONE;
+  return 0;
+}
+
+/**
+ * Creates a new job of @p type for @p peer, if a crypto executor is
+ * registered and no other job is attached to the handshake. Returns
+ * NULL if the operation is to be done synchronously.
+ */
+static dtls_crypto_job_t *
+dtls_crypto_job_create(dtls_context_t *ctx, dtls_peer_t *peer,
+		       dtls_crypto_job_type_t type) {
+  if (!ctx->h || !ctx->h->crypto_submit || peer->handshake_params->crypto_job)
+    return NULL;
+
+  return dtls_crypto_job_new(type);
+}
+
+static int
+dtls_offload_server_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  const dtls_ecdsa_key_t *ecdsa_key;
+  dtls_crypto_job_t *job;
+
+  if (!is_key_exchange_ecdhe_ecdsa(handshake->cipher_index))
+    return 0;
+
+  /* errors are reported by the synchronous code path */
+  if (CALL(ctx, get_ecdsa_key, &peer->session, &ecdsa_key) < 0)
+    return 0;
+
+  job = dtls_crypto_job_create(ctx, peer, DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE);
+  if (!job)
+    return 0;
+
+  memcpy(job->own_priv, ecdsa_key->priv_key, DTLS_EC_KEY_SIZE);
+  memcpy(job->random, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
+  memcpy(job->random + DTLS_RANDOM_LENGTH, handshake->tmp.random.server,
+	 DTLS_RANDOM_LENGTH);
+
+  return dtls_crypto_job_start(ctx, peer, job);
+}
+
+static int
+dtls_offload_verify_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer,
+				 const unsigned char *result_r,
+				 const unsigned char *result_s) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_crypto_job_t *job;
+
+  job = dtls_crypto_job_create(ctx, peer, DTLS_CRYPTO_JOB_VERIFY_KEY_EXCHANGE);
+  if (!job)
+    return 0;
+
+  memcpy(job->other_pub_x, handshake->keyx.ecdsa.other_pub_x, DTLS_EC_KEY_SIZE);
+  memcpy(job->other_pub_y, handshake->keyx.ecdsa.other_pub_y, DTLS_EC_KEY_SIZE);
+  memcpy(job->other_eph_pub_x, handshake->keyx.ecdsa.other_eph_pub_x,
+	 DTLS_EC_KEY_SIZE);
+  memcpy(job->other_eph_pub_y, handshake->keyx.ecdsa.other_eph_pub_y,
+	 DTLS_EC_KEY_SIZE);
+  memcpy(job->random, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
+  memcpy(job->random + DTLS_RANDOM_LENGTH, handshake->tmp.random.server,
+	 DTLS_RANDOM_LENGTH);
+  memcpy(job->sig_r, result_r, DTLS_EC_KEY_SIZE);
+  memcpy(job->sig_s, result_s, DTLS_EC_KEY_SIZE);
+
+  return dtls_crypto_job_start(ctx, peer, job);
+}
+
+static int
+dtls_offload_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_crypto_job_t *job;
+
+  if (!is_key_exchange_ecdhe_ecdsa(handshake->cipher_index))
+    return 0;
+
+  job = dtls_crypto_job_create(ctx, peer, DTLS_CRYPTO_JOB_CLIENT_KEY_EXCHANGE);
+  if (!job)
+    return 0;
+
+  memcpy(job->other_eph_pub_x, handshake->keyx.ecdsa.other_eph_pub_x,
+	 DTLS_EC_KEY_SIZE);
+  memcpy(job->other_eph_pub_y, handshake->keyx.ecdsa.other_eph_pub_y,
+	 DTLS_EC_KEY_SIZE);
+
+  return dtls_crypto_job_start(ctx, peer, job);
+}
+
+/**
+ * Offloads ECDH and key derivation of the server once the
+ * ClientKeyExchange @p data has been parsed. The session hash for
+ * the extended master secret includes @p data.
+ */
+static int
+dtls_offload_key_block(dtls_context_t *ctx, dtls_peer_t *peer,
+		       uint8 *data, size_t data_length) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_crypto_job_t *job;
+  dtls_hash_ctx hs_hash;
+
+  if (!is_key_exchange_ecdhe_ecdsa(handshake->cipher_index))
+    return 0;
+
+  job = dtls_crypto_job_create(ctx, peer, DTLS_CRYPTO_JOB_KEY_BLOCK);
+  if (!job)
+    return 0;
+
+  memcpy(job->own_priv, handshake->keyx.ecdsa.own_eph_priv, DTLS_EC_KEY_SIZE);
+  memcpy(job->other_eph_pub_x, handshake->keyx.ecdsa.other_eph_pub_x,
+	 DTLS_EC_KEY_SIZE);
+  memcpy(job->other_eph_pub_y, handshake->keyx.ecdsa.other_eph_pub_y,
+	 DTLS_EC_KEY_SIZE);
+  memcpy(job->random, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
+  memcpy(job->random + DTLS_RANDOM_LENGTH, handshake->tmp.random.server,
+	 DTLS_RANDOM_LENGTH);
+  if (handshake->extended_master_secret) {
+    copy_hs_hash(peer, &hs_hash);
+    dtls_hash_update(&hs_hash, data, data_length);
+    dtls_hash_finalize(job->session_hash, &hs_hash);
+    job->extended_master_secret = 1;
+  }
+
+  return dtls_crypto_job_start(ctx, peer, job);
+}
+
+/**
+ * Keeps the handshake message @p data in the reassembly buffer of
+ * @p peer, so it is handled again when the pending crypto job
+ * completes.
+ */
+static int
+dtls_crypto_job_hold(dtls_peer_t *peer, uint8 *data, size_t data_length) {
+  if (dtls_reassembly_add(peer, data, data_length) < 0) {
+    dtls_warn("cannot keep handshake message for crypto job\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+  return 0;
+}
+
+/** Buffers a record of @p peer received while a crypto job is pending. */
+static void
+dtls_crypto_job_defer_record(dtls_peer_t *peer, uint8 *msg, size_t msglen) {
+  netq_t *n;
+  int count;
+
+  LL_COUNT(peer->handshake_params->deferred_records, n, count);
+  if (count >= DTLS_DEFERRED_RECORDS_MAX || msglen > DTLS_MAX_BUF ||
+      !(n = netq_node_new(dtls_mem_owner(peer), msglen))) {
+    dtls_info("drop record, crypto job pending\n");
+    return;
+  }
+
+  n->peer = peer;
+  n->length = msglen;
+  memcpy(n->data, msg, msglen);
+  LL_APPEND(peer->handshake_params->deferred_records, n);
+}
+
+static inline int
+is_crypto_job_pending(const dtls_peer_t *peer) {
+  return peer->handshake_params && peer->handshake_params->crypto_job &&
+    peer->handshake_params->crypto_job->state == DTLS_CRYPTO_JOB_PENDING;
+}
+#endif /* DTLS_ECC */
+
 /**
  * Checks if \p record + \p data contain a Finished message with valid
  * verify_data.
@@ -1643,6 +3236,56 @@ check_finished(dtls_context_t *ctx, dtls_peer_t *peer,
     : dtls_alert_create(DTLS_ALERT_LEVEL_FATAL, DTLS_ALERT_DECRYPT_ERROR);
 }
 
+/** Maximum length of the additional data of the AEAD cipher. */
+#define DTLS_A_DATA_LENGTH_MAX (23 + DTLS_MAX_CID_LENGTH)
+
+/**
+ * Writes the additional data of the AEAD cipher for the record that
+ * starts with \p header of \p header_length bytes and has \p length
+ * bytes of plaintext to \p a_data, which must hold at least
+ * DTLS_A_DATA_LENGTH_MAX bytes.
+ * \return The length of the additional data.
+ */
+static size_t
+dtls_record_a_data(const uint8 *header, size_t header_length,
+                   size_t length, uint8 *a_data) {
+  uint8 *p = a_data;
+
+#if DTLS_MAX_CID_LENGTH > 0
+  if (header[0] == DTLS_CT_TLS12_CID) {
+    /* RFC 9146, section 5:
+     *
+     * additional_data = seq_num_placeholder + tls12_cid + cid_length +
+     *                   tls12_cid + DTLSCiphertext.version + epoch +
+     *                   sequence_number + cid +
+     *                   length_of_DTLSInnerPlaintext;
+     */
+    memset(p, 0xff, 8);
+    p += 8;
+    dtls_int_to_uint8(p, DTLS_CT_TLS12_CID);
+    p += sizeof(uint8);
+    dtls_int_to_uint8(p, header_length - DTLS_RH_LENGTH);
+    p += sizeof(uint8);
+    /* type, version, epoch, seq_num and cid */
+    memcpy(p, header, header_length - sizeof(uint16));
+    p += header_length - sizeof(uint16);
+  } else
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+  {
+    /* RFC 5246, Section 6.2.3.3:
+     *
+     * additional_data = seq_num + TLSCompressed.type +
+     *                   TLSCompressed.version + TLSCompressed.length;
+     */
+    (void)header_length;
+    memcpy(p, &DTLS_RECORD_HEADER(header)->epoch, 8); /* epoch and seq_num */
+    memcpy(p + 8, header, 3); /* type and version */
+    p += 11;
+  }
+  dtls_int_to_uint16(p, length);
+  return p + sizeof(uint16) - a_data;
+}
+
 /**
  * Prepares the payload given in \p data for sending with
  * dtls_send(). The \p data is encrypted and compressed according to
@@ -1674,6 +3317,7 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
 		    size_t data_array_len,
 		    uint8 *sendbuf, size_t *rlen) {
   uint8 *p, *start;
+  size_t header_length = DTLS_RH_LENGTH;
   int res;
   unsigned int i;
 
@@ -1688,6 +3332,22 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
   }
 
   p = dtls_set_record_header(type, security->epoch, &(security->rseq), sendbuf);
+#if DTLS_MAX_CID_LENGTH > 0
+  if (security->cipher_index != DTLS_CIPHER_INDEX_NULL &&
+      peer->write_cid_length) {
+    /* RFC 9146: the connection id follows the sequence number, the
+     * content type is protected in the DTLSInnerPlaintext */
+    header_length += peer->write_cid_length;
+    if (*rlen < header_length) {
+      dtls_alert("The sendbuf (%zu bytes) is too small\n", *rlen);
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    }
+    dtls_set_content_type(DTLS_RECORD_HEADER(sendbuf), DTLS_CT_TLS12_CID);
+    memcpy(p - sizeof(uint16), peer->write_cid, peer->write_cid_length);
+    p = sendbuf + header_length;
+    memset(p - sizeof(uint16), 0, sizeof(uint16));
+  }
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
   start = p;
 
   if (security->cipher_index == DTLS_CIPHER_INDEX_NULL) {
@@ -1708,13 +3368,9 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
   } else { /* TLS_PSK_WITH_AES_128_CCM_8, TLS_PSK_WITH_AES_128_CCM,
               TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 or
               TLS_ECDHE_ECDSA_WITH_AES_128_CCM */
-    /**
-     * length of additional_data for the AEAD cipher which consists of
-     * seq_num(2+6) + type(1) + version(2) + length(2)
-     */
-#define A_DATA_LEN 13
     unsigned char nonce[DTLS_CCM_BLOCKSIZE];
-    unsigned char A_DATA[A_DATA_LEN];
+    unsigned char A_DATA[DTLS_A_DATA_LENGTH_MAX];
+    size_t a_data_length;
     const uint8_t mac_len = get_cipher_suite_mac_len(security->cipher_index);
     const cipher_suite_key_exchange_algorithm_t key_exchange_algorithm =
             get_key_exchange_algorithm(security->cipher_index);
@@ -1780,7 +3436,7 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
 
     for (i = 0; i < data_array_len; i++) {
       /* check the minimum that we need for packets that are not encrypted */
-      if (*rlen < res + DTLS_RH_LENGTH + data_len_array[i]) {
+      if (*rlen < res + header_length + data_len_array[i]) {
         dtls_debug("dtls_prepare_record: send buffer too small\n");
         return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
       }
@@ -1790,6 +3446,19 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
       res += data_len_array[i];
     }
 
+#if DTLS_MAX_CID_LENGTH > 0
+    if (header_length > DTLS_RH_LENGTH) {
+      /* DTLSInnerPlaintext without padding */
+      if (*rlen < res + header_length + sizeof(uint8)) {
+        dtls_debug("dtls_prepare_record: send buffer too small\n");
+        return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+      }
+      dtls_int_to_uint8(p, type);
+      p += sizeof(uint8);
+      res += sizeof(uint8);
+    }
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+
     memset(nonce, 0, DTLS_CCM_BLOCKSIZE);
     memcpy(nonce, dtls_kb_local_iv(security, peer->role),
 	   dtls_kb_iv_size(security, peer->role));
@@ -1799,19 +3468,12 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
     dtls_debug_dump("key:", dtls_kb_local_write_key(security, peer->role),
 		    dtls_kb_key_size(security, peer->role));
 
-    /* re-use N to create additional data according to RFC 5246, Section 6.2.3.3:
-     *
-     * additional_data = seq_num + TLSCompressed.type +
-     *                   TLSCompressed.version + TLSCompressed.length;
-     */
-    memcpy(A_DATA, &DTLS_RECORD_HEADER(sendbuf)->epoch, 8); /* epoch and seq_num */
-    memcpy(A_DATA + 8,  &DTLS_RECORD_HEADER(sendbuf)->content_type, 3); /* type and version */
-    dtls_int_to_uint16(A_DATA + 11, res - 8); /* length */
+    a_data_length = dtls_record_a_data(sendbuf, header_length, res - 8, A_DATA);
 
     res = dtls_encrypt_params(&params, start + 8, res - 8, start + 8,
                dtls_kb_local_write_key(security, peer->role),
                dtls_kb_key_size(security, peer->role),
-               A_DATA, A_DATA_LEN);
+               A_DATA, a_data_length);
 
     if (res < 0)
       return res;
@@ -1821,9 +3483,9 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
   }
 
   /* fix length of fragment in sendbuf */
-  dtls_int_to_uint16(sendbuf + 11, res);
+  dtls_int_to_uint16(sendbuf + header_length - sizeof(uint16), res);
 
-  *rlen = DTLS_RH_LENGTH + res;
+  *rlen = header_length + res;
   return 0;
 }
 
@@ -2002,10 +3664,201 @@ dtls_send_handshake_msg(dtls_context_t *ctx,
       (dtls_uint16_to_int(HANDSHAKE(Data)->message_seq) > 0)))))
 
 
+/** Returns the bytes added to a message to @p peer by the record layer. */
+static size_t
+dtls_record_overhead(const dtls_peer_t *peer,
+                     const dtls_security_parameters_t *security) {
+  size_t overhead = DTLS_RH_LENGTH;
+
+  if (security->cipher_index == DTLS_CIPHER_INDEX_NULL)
+    return overhead;
+#if DTLS_MAX_CID_LENGTH > 0
+  /* connection id and the content type of the DTLSInnerPlaintext */
+  if (peer->write_cid_length)
+    overhead += peer->write_cid_length + sizeof(uint8);
+#else /* DTLS_MAX_CID_LENGTH > 0 */
+  (void)peer;
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+  /* explicit nonce and MAC */
+  return overhead + 8 + get_cipher_suite_mac_len(security->cipher_index);
+}
+
+/** Returns the size limit of the datagrams to @p peer. */
+static inline size_t
+dtls_peer_mtu(const dtls_context_t *ctx, const dtls_peer_t *peer) {
+  return peer->mtu ? peer->mtu : ctx->mtu;
+}
+
+/**
+ * Returns the largest plaintext of a record for @p peer protected
+ * with @p security, so that the record fits into @p mtu bytes and
+ * into the record size limit of the peer.
+ */
+static size_t
+dtls_record_limit(const dtls_peer_t *peer,
+                  const dtls_security_parameters_t *security, size_t mtu) {
+  size_t overhead = security ? dtls_record_overhead(peer, security) : DTLS_RH_LENGTH;
+  size_t limit = mtu > overhead ? mtu - overhead : 0;
+
+  /* unprotected records are not subject to the limit */
+  if (security && security->cipher_index != DTLS_CIPHER_INDEX_NULL &&
+      peer->record_size_limit && peer->record_size_limit < limit)
+    limit = peer->record_size_limit;
+  return limit;
+}
+
+/**
+ * Builds the records of the flight @p node, starting with the message
+ * at @p offset of the flight's data, and passes as many of them
+ * together to the write callback as fit into the peer's datagram size
+ * limit. Handshake messages that do not fit into a datagram of their
+ * own are fragmented. This function returns the number of datagrams
+ * and adds their size to @p bytes.
+ */
+static unsigned int
+dtls_flight_write(dtls_context_t *ctx, netq_t *node, size_t offset,
+                  size_t *bytes) {
 #ifdef DTLS_CONSTRAINED_STACK
-static dtls_mutex_t static_mutex = DTLS_MUTEX_INITIALIZER;
-static unsigned char sendbuf[DTLS_MAX_BUF];
-#endif /* DTLS_CONSTRAINED_STACK */
+  unsigned char *sendbuf = ctx->sendbuf;
+#else /* ! DTLS_CONSTRAINED_STACK */
+  unsigned char sendbuf[DTLS_MAX_BUF];
+#endif /* ! DTLS_CONSTRAINED_STACK */
+  dtls_peer_t *peer = node->peer;
+  size_t mtu = dtls_peer_mtu(ctx, peer);
+  size_t used = 0;
+  unsigned int datagrams = 0;
+  netq_t *n;
+
+  for (n = node; n; n = n->flight_next) {
+    unsigned char *p = n->data;
+
+    if (offset >= n->length) {
+      offset -= n->length;
+      continue;
+    }
+    p += offset;
+    offset = 0;
+
+    while (p < n->data + n->length) {
+      uint8_t type = dtls_uint8_to_int(p);
+      dtls_security_parameters_t *security =
+        dtls_security_params_epoch(peer, dtls_uint16_to_int(p + 1));
+      size_t length = dtls_uint16_to_int(p + 3);
+      unsigned char *data = p + DTLS_FLIGHT_MSG_HEADER;
+      size_t overhead = security ? dtls_record_overhead(peer, security) : 0;
+      uint8 header[DTLS_HS_LENGTH];
+      uint8 *data_array[2];
+      size_t data_len_array[2];
+      size_t data_array_len = 1;
+      size_t fragment_offset = 0, fragment_length = 0, max_fragment = 0;
+      size_t limit;
+
+      p = data + length;
+      if (type == DTLS_CT_HANDSHAKE) {
+        dtls_handshake_header_t *hs_header = DTLS_HANDSHAKE_HEADER(data);
+        dtls_debug("** send flight handshake packet of type: %s (%i)\n",
+                   dtls_handshake_type_to_name(hs_header->msg_type),
+                   hs_header->msg_type);
+        /* each fragment repeats the handshake header */
+        memcpy(header, data, DTLS_HS_LENGTH);
+        max_fragment = length - DTLS_HS_LENGTH;
+        limit = dtls_record_limit(peer, security, mtu);
+        /* A server cannot reassemble an initial ClientHello before it
+         * has verified the cookie, so it is never fragmented. */
+        if (length > limit && limit > DTLS_HS_LENGTH &&
+            !(security && security->epoch == 0 &&
+              hs_header->msg_type == DTLS_HT_CLIENT_HELLO))
+          max_fragment = limit - DTLS_HS_LENGTH;
+      } else {
+        dtls_debug("** send flight packet\n");
+      }
+
+      do {
+        size_t len;
+        int err;
+
+        if (type == DTLS_CT_HANDSHAKE) {
+          fragment_length = length - DTLS_HS_LENGTH - fragment_offset;
+          if (fragment_length > max_fragment)
+            fragment_length = max_fragment;
+          dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(header)->fragment_offset,
+                             fragment_offset);
+          dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(header)->fragment_length,
+                             fragment_length);
+          data_array[0] = header;
+          data_len_array[0] = DTLS_HS_LENGTH;
+          data_array[1] = data + DTLS_HS_LENGTH + fragment_offset;
+          data_len_array[1] = fragment_length;
+          data_array_len = 2;
+        } else {
+          data_array[0] = data;
+          data_len_array[0] = length;
+        }
+
+        if (used && used + overhead + data_len_array[0] +
+            (data_array_len > 1 ? data_len_array[1] : 0) > mtu) {
+          (void)CALL(ctx, write, &peer->session, sendbuf, used);
+          *bytes += used;
+          datagrams++;
+          used = 0;
+        }
+
+        len = DTLS_MAX_BUF - used;
+        err = dtls_prepare_record(peer, security, type, data_array,
+                                  data_len_array, data_array_len,
+                                  sendbuf + used, &len);
+        if (err < 0) {
+          dtls_warn("can not send flight packet, err: %i\n", err);
+          break;
+        }
+
+        /* Signal DTLS version 1.0 in the record layer of an initial
+         * ClientHello, see dtls_send_multi(). */
+        if (security->epoch == 0 && type == DTLS_CT_HANDSHAKE &&
+            data[0] == DTLS_HT_CLIENT_HELLO) {
+          dtls_int_to_uint16(sendbuf + used + 1, DTLS10_VERSION);
+        }
+        dtls_debug_hexdump("flight header", sendbuf + used, sizeof(dtls_record_header_t));
+        dtls_debug_hexdump("flight unencrypted", data_array[0], data_len_array[0]);
+        if (data_array_len > 1)
+          dtls_debug_hexdump("flight fragment", data_array[1], data_len_array[1]);
+        used += len;
+        fragment_offset += fragment_length;
+      } while (fragment_offset + DTLS_HS_LENGTH < length);
+    }
+  }
+
+  if (used) {
+    (void)CALL(ctx, write, &peer->session, sendbuf, used);
+    *bytes += used;
+    datagrams++;
+  }
+  return datagrams;
+}
+
+/**
+ * Sends the messages that have been added to the flight of @p peer
+ * since the last call, so that the records of a flight share their
+ * datagrams.
+ */
+static void
+dtls_flight_flush(dtls_context_t *ctx, dtls_peer_t *peer) {
+  netq_t *flight, *n;
+  size_t offset = 0, length = 0, bytes = 0;
+
+  dtls_sendqueue_lock(ctx);
+  flight = peer->retransmit;
+  if (flight && (flight->job == RESEND || flight->job == FINISHED)) {
+    for (n = flight; n; n = n->flight_next)
+      length += n->length;
+    offset = flight->flushed;
+    flight->flushed = length;
+  }
+  dtls_sendqueue_unlock(ctx);
+
+  if (offset < length)
+    (void)dtls_flight_write(ctx, flight, offset, &bytes);
+}
 
 /**
  * Sends the data passed in @p buf as a DTLS record of type @p type to
@@ -2029,29 +3882,57 @@ dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
 		unsigned char type, uint8 *buf_array[],
 		size_t buf_len_array[], size_t buf_array_len)
 {
-  /* We cannot use ctx->sendbuf here as it is reserved for collecting
-   * the input for this function, i.e. buf == ctx->sendbuf.
-   *
-   * TODO: check if we can use the receive buf here. This would mean
-   * that we might not be able to handle multiple records stuffed in
-   * one UDP datagram */
-#ifndef DTLS_CONSTRAINED_STACK
+  /* The record is assembled either on the stack or, for constrained
+   * stacks, in the buffer owned by ctx. No state is shared between
+   * contexts, hence no locking is required here. */
+#ifdef DTLS_CONSTRAINED_STACK
+  unsigned char *sendbuf = ctx->sendbuf;
+#else /* ! DTLS_CONSTRAINED_STACK */
   unsigned char sendbuf[DTLS_MAX_BUF];
 #endif /* ! DTLS_CONSTRAINED_STACK */
-  size_t len = sizeof(sendbuf);
+  size_t len = DTLS_MAX_BUF;
   int res;
   unsigned int i;
   size_t overall_len = 0;
 
-#ifdef DTLS_CONSTRAINED_STACK
-  dtls_mutex_lock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
+  for (i = 0; i < buf_array_len; i++) {
+    overall_len += buf_len_array[i];
+  }
+
+  if (type == DTLS_CT_HANDSHAKE || type == DTLS_CT_CHANGE_CIPHER_SPEC) {
+    /* copy messages of handshake into the peer's flight, which is
+     * sent by dtls_flight_flush() */
+    if (dtls_flight_add(ctx, peer, security ? security->epoch : 0, type,
+                        buf_array, buf_len_array, buf_array_len,
+                        overall_len) == 0) {
+#ifdef WITH_CONTIKI
+      /* must set timer within the context of the retransmit process */
+      PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
+      etimer_set(&ctx->retransmit_timer, peer->retransmit->timeout);
+      PROCESS_CONTEXT_END(&dtls_retransmit_process);
+#else /* WITH_CONTIKI */
+      dtls_debug("copied to flight\n");
+#endif /* WITH_CONTIKI */
+      return overall_len;
+    }
+    dtls_warn("retransmit buffer full\n");
+  }
+
+  /* the pending records of the flight are sent first */
+  dtls_flight_flush(ctx, peer);
+
+  if (security && security->cipher_index != DTLS_CIPHER_INDEX_NULL &&
+      peer->record_size_limit && overall_len > peer->record_size_limit) {
+    dtls_warn("%zu bytes exceed the record size limit of the peer (%u)\n",
+              overall_len, peer->record_size_limit);
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
 
   res = dtls_prepare_record(peer, security, type, buf_array, buf_len_array,
                             buf_array_len, sendbuf, &len);
 
   if (res < 0)
-    goto return_unlock;
+    return res;
 
   /* if (peer && MUST_HASH(peer, type, buf, buflen)) */
   /*   update_hs_hash(peer, buf, buflen); */
@@ -2074,55 +3955,11 @@ dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
   dtls_debug_hexdump("send header", sendbuf, sizeof(dtls_record_header_t));
   for (i = 0; i < buf_array_len; i++) {
     dtls_debug_hexdump("send unencrypted", buf_array[i], buf_len_array[i]);
-    overall_len += buf_len_array[i];
-  }
-
-  if (type == DTLS_CT_HANDSHAKE || type == DTLS_CT_CHANGE_CIPHER_SPEC) {
-    /* copy messages of handshake into retransmit buffer */
-    netq_t *n = netq_node_new(overall_len);
-    if (n) {
-      dtls_tick_t now;
-      dtls_ticks(&now);
-      n->t = now + 2 * CLOCK_SECOND;
-      n->retransmit_cnt = 0;
-      n->timeout = 2 * CLOCK_SECOND;
-      n->peer = peer;
-      n->epoch = (security) ? security->epoch : 0;
-      n->type = type;
-      n->job = RESEND;
-      n->length = 0;
-      for (i = 0; i < buf_array_len; i++) {
-        memcpy(n->data + n->length, buf_array[i], buf_len_array[i]);
-        n->length += buf_len_array[i];
-      }
-
-      if (!netq_insert_node(&ctx->sendqueue, n)) {
-        dtls_warn("cannot add packet to retransmit buffer\n");
-        netq_node_free(n);
-#ifdef WITH_CONTIKI
-      } else {
-        /* must set timer within the context of the retransmit process */
-        PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
-        etimer_set(&ctx->retransmit_timer, n->timeout);
-        PROCESS_CONTEXT_END(&dtls_retransmit_process);
-#else /* WITH_CONTIKI */
-        dtls_debug("copied to sendqueue\n");
-#endif /* WITH_CONTIKI */
-      }
-    } else {
-      dtls_warn("retransmit buffer full\n");
-    }
   }
 
-  /* FIXME: copy to peer's sendqueue (after fragmentation if
-   * necessary) and initialize retransmit timer */
+  /* handshake messages are fragmented by dtls_flight_write() */
   res = CALL(ctx, write, session, sendbuf, len);
 
-return_unlock:
-#ifdef DTLS_CONSTRAINED_STACK
-  dtls_mutex_unlock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
-
   /* Guess number of bytes application data actually sent:
    * dtls_prepare_record() tells us in len the number of bytes to
    * send, res will contain the bytes actually sent. */
@@ -2138,7 +3975,7 @@ dtls_send_alert(dtls_context_t *ctx, dtls_peer_t *peer, dtls_alert_level_t level
 
   /* copy close alert in retransmit buffer to emulate timeout */
   /* not resent, therefore don't copy the complete record */
-  netq_t *n = netq_node_new(2);
+  netq_t *n = netq_node_new(ctx->mem, 2);
   if (n) {
     dtls_tick_t now;
     dtls_ticks(&now);
@@ -2146,27 +3983,30 @@ dtls_send_alert(dtls_context_t *ctx, dtls_peer_t *peer, dtls_alert_level_t level
     n->retransmit_cnt = 0;
     n->timeout = 2 * CLOCK_SECOND;
     n->peer = peer;
-    n->epoch = peer->security_params[0]->epoch;
+#ifdef DTLS_CONCURRENT_PEERS
+    n->session = peer->session;
+#endif /* DTLS_CONCURRENT_PEERS */
+    n->epoch = peer->security.epoch;
     n->type = DTLS_CT_ALERT;
     n->length = 2;
     n->data[0] = level;
     n->data[1] = description;
     n->job = TIMEOUT;
 
-    if (!netq_insert_node(&ctx->sendqueue, n)) {
-      dtls_warn("cannot add alert to retransmit buffer\n");
-      netq_node_free(n);
-      n = NULL;
+    /* the alert replaces a pending flight */
+    dtls_stop_retransmission(ctx, peer);
+    dtls_sendqueue_lock(ctx);
+    peer->retransmit = n;
+    netq_wheel_insert(&ctx->sendqueue, n);
+    dtls_sendqueue_unlock(ctx);
 #ifdef WITH_CONTIKI
-    } else {
-      /* must set timer within the context of the retransmit process */
-      PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
-      etimer_set(&ctx->retransmit_timer, n->timeout);
-      PROCESS_CONTEXT_END(&dtls_retransmit_process);
+    /* must set timer within the context of the retransmit process */
+    PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
+    etimer_set(&ctx->retransmit_timer, n->timeout);
+    PROCESS_CONTEXT_END(&dtls_retransmit_process);
 #else /* WITH_CONTIKI */
-      dtls_debug("alert copied to retransmit buffer\n");
+    dtls_debug("alert copied to retransmit buffer\n");
 #endif /* WITH_CONTIKI */
-    }
   } else {
     dtls_warn("cannot add alert, retransmit buffer full\n");
   }
@@ -2183,6 +4023,7 @@ dtls_close(dtls_context_t *ctx, const session_t *remote) {
   int res = -1;
   dtls_peer_t *peer;
 
+  dtls_session_lock(ctx, remote);
   peer = dtls_get_peer(ctx, remote);
 
   if (peer) {
@@ -2191,6 +4032,7 @@ dtls_close(dtls_context_t *ctx, const session_t *remote) {
     res = dtls_send_alert(ctx, peer, DTLS_ALERT_LEVEL_WARNING,
                           DTLS_ALERT_CLOSE_NOTIFY);
   }
+  dtls_session_unlock(ctx, remote);
   return res;
 }
 
@@ -2202,16 +4044,372 @@ dtls_destroy_peer(dtls_context_t *ctx, dtls_peer_t *peer, int flags) {
     dtls_close(ctx, &peer->session);
   }
   dtls_stop_retransmission(ctx, peer);
-  DEL_PEER(ctx->peers, peer);
+  dtls_del_peer(ctx, peer);
   dtls_dsrv_log_addr(DTLS_LOG_DEBUG, "removed peer", &peer->session);
   dtls_free_peer(peer);
 }
 
+/** Returns non-zero if @p peer has been idle for @p timeout seconds
+ *  at @p now. */
+static inline int
+dtls_peer_idle(const dtls_peer_t *peer, unsigned int timeout, dtls_tick_t now) {
+  return now - peer->last_seen >= timeout * DTLS_TICKS_PER_SECOND;
+}
+
+/** Returns non-zero if @p peer may be evicted at @p now. */
+static inline int
+dtls_peer_evictable(const dtls_context_t *ctx, const dtls_peer_t *peer,
+                    dtls_tick_t now) {
+  return peer && peer->established &&
+    dtls_peer_idle(peer, ctx->limits.evict_idle, now);
+}
+
+/**
+ * Removes the peers of one list of @p ctx, established or not, that
+ * have exceeded their timeout at @p now. As the list is ordered by
+ * dtls_peer_t::last_seen, only its head is checked. This function
+ * returns non-zero and sets @p deadline to the timeout of the new
+ * head, if there is one.
+ */
+static int
+dtls_expire_list(dtls_context_t *ctx, uint8_t established, dtls_tick_t now,
+                 dtls_tick_t *deadline) {
+  dtls_session_key_t key;
+  dtls_peer_t *peer;
+  unsigned int timeout;
+  uint32_t hash;
+  int res = 0;
+
+  dtls_lru_lock(ctx);
+  timeout = established ?
+    ctx->limits.idle_timeout : ctx->limits.handshake_timeout;
+  while (timeout && (peer = established ? ctx->lru : ctx->handshakes)) {
+    if (!dtls_peer_idle(peer, timeout, now)) {
+      *deadline = peer->last_seen + timeout * DTLS_TICKS_PER_SECOND;
+      res = 1;
+      break;
+    }
+    memcpy(&key, &peer->key, sizeof(dtls_session_key_t));
+    dtls_lru_unlock(ctx);
+
+    hash = dtls_session_key_hash(&key);
+    dtls_session_lock_hash(ctx, hash);
+    peer = dtls_find_peer(ctx, &key, hash);
+    dtls_lru_lock(ctx);
+    if (peer && peer->established == established &&
+        dtls_peer_idle(peer, timeout, now)) {
+      dtls_lru_unlock(ctx);
+      dtls_dsrv_log_addr(DTLS_LOG_INFO, established ?
+                         "session expired" : "handshake expired",
+                         &peer->session);
+      CALL(ctx, event, &peer->session, 0, established ?
+           DTLS_EVENT_IDLE_TIMEOUT : DTLS_EVENT_HANDSHAKE_TIMEOUT);
+      /* the callback may have removed the peer */
+      peer = dtls_find_peer(ctx, &key, hash);
+      if (peer) {
+        dtls_destroy_peer(ctx, peer,
+                          established && ctx->limits.evict_close_notify ?
+                          DTLS_DESTROY_CLOSE : 0);
+      }
+      dtls_lru_lock(ctx);
+    }
+    dtls_session_unlock_hash(ctx, hash);
+  }
+  dtls_lru_unlock(ctx);
+  return res;
+}
+
+/**
+ * Checks the limits of @p ctx before a new peer is added, and evicts
+ * the least recently used established peers if necessary. This
+ * function returns @c 0 if the new peer may be added, or a value less
+ * than zero otherwise.
+ */
+static int
+dtls_admit_peer(dtls_context_t *ctx) {
+  dtls_session_key_t key;
+  dtls_peer_t *peer;
+  dtls_tick_t now;
+  uint32_t hash;
+
+  dtls_ticks(&now);
+  dtls_lru_lock(ctx);
+  if (ctx->limits.max_handshakes &&
+      ctx->num_peers - ctx->num_established >= ctx->limits.max_handshakes) {
+    dtls_lru_unlock(ctx);
+    dtls_info("handshake limit reached\n");
+    return -1;
+  }
+
+  while (ctx->limits.max_peers && ctx->num_peers >= ctx->limits.max_peers) {
+    if (!dtls_peer_evictable(ctx, ctx->lru, now)) {
+      dtls_lru_unlock(ctx);
+      dtls_info("peer limit reached\n");
+      return -1;
+    }
+    memcpy(&key, &ctx->lru->key, sizeof(dtls_session_key_t));
+    dtls_lru_unlock(ctx);
+
+    /* Another thread may be using the peer, or may already have
+     * evicted it. */
+    hash = dtls_session_key_hash(&key);
+    if (!dtls_session_trylock_hash(ctx, hash)) {
+      dtls_info("peer limit reached, cannot evict peer in use\n");
+      return -1;
+    }
+    peer = dtls_find_peer(ctx, &key, hash);
+    dtls_lru_lock(ctx);
+    if (dtls_peer_evictable(ctx, peer, now)) {
+      dtls_lru_unlock(ctx);
+      dtls_dsrv_log_addr(DTLS_LOG_INFO, "evict peer", &peer->session);
+      dtls_destroy_peer(ctx, peer,
+                        ctx->limits.evict_close_notify ? DTLS_DESTROY_CLOSE : 0);
+      dtls_lru_lock(ctx);
+    }
+    dtls_session_unlock_hash(ctx, hash);
+  }
+  dtls_lru_unlock(ctx);
+  return 0;
+}
+
+void
+dtls_set_peer_limits(dtls_context_t *ctx, const dtls_peer_limits_t *limits) {
+  dtls_lru_lock(ctx);
+  ctx->limits = *limits;
+  dtls_lru_unlock(ctx);
+}
+
+void
+dtls_set_rto_config(dtls_context_t *ctx, const dtls_rto_config_t *config) {
+  dtls_sendqueue_lock(ctx);
+  ctx->rto = *config;
+  dtls_sendqueue_unlock(ctx);
+}
+
+void
+dtls_set_retransmit_pacing(dtls_context_t *ctx, const dtls_pacing_t *pacing) {
+  dtls_sendqueue_lock(ctx);
+  ctx->pacing = *pacing;
+  /* start with the full budget */
+  ctx->pacing_bytes = (int64_t)pacing->bytes_per_second * DTLS_TICKS_PER_SECOND;
+  ctx->pacing_datagrams = (int64_t)pacing->datagrams_per_second * DTLS_TICKS_PER_SECOND;
+  dtls_ticks(&ctx->pacing_time);
+  dtls_sendqueue_unlock(ctx);
+}
+
+int
+dtls_set_ticket_keys(dtls_context_t *ctx, const dtls_ticket_key_t *keys,
+                     size_t count) {
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  if (count > DTLS_TICKET_KEYS)
+    return -1;
+
+  dtls_sessions_lock(ctx);
+  memset(ctx->ticket_keys, 0, sizeof(ctx->ticket_keys));
+  if (count)
+    memcpy(ctx->ticket_keys, keys, count * sizeof(dtls_ticket_key_t));
+  ctx->num_ticket_keys = count;
+  ctx->ticket_keys_external = count > 0;
+  dtls_sessions_unlock(ctx);
+  return 0;
+#else /* DTLS_SESSION_TICKET_LENGTH > 0 */
+  (void)ctx;
+  (void)keys;
+  (void)count;
+  return -1;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+}
+
+int
+dtls_set_cid_prefix(dtls_context_t *ctx, const uint8 *prefix, size_t length) {
+#if DTLS_CID_LENGTH > 0
+  if (length >= DTLS_CID_LENGTH)
+    return -1;
+
+  memcpy(ctx->cid_prefix, prefix, length);
+  ctx->cid_prefix_length = length;
+  return 0;
+#else /* DTLS_CID_LENGTH > 0 */
+  (void)ctx;
+  (void)prefix;
+  (void)length;
+  return -1;
+#endif /* DTLS_CID_LENGTH > 0 */
+}
+
+int
+dtls_set_address_validation(dtls_context_t *ctx,
+                            const dtls_address_validation_t *config) {
+#if DTLS_VALIDATED_ADDRESSES > 0
+  dtls_sessions_lock(ctx);
+  ctx->validation = *config;
+  memset(ctx->validated, 0, sizeof(ctx->validated));
+  dtls_sessions_unlock(ctx);
+  return 0;
+#else /* DTLS_VALIDATED_ADDRESSES > 0 */
+  (void)ctx;
+  (void)config;
+  return -1;
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+}
+
+int
+dtls_get_rtt(dtls_context_t *ctx, const session_t *session, dtls_rtt_t *rtt) {
+  dtls_peer_t *peer = NULL;
+  dtls_tick_t srtt, rttvar, rto;
+
+  if (session) {
+    dtls_session_lock(ctx, session);
+    peer = dtls_get_peer(ctx, session);
+    if (!peer) {
+      dtls_session_unlock(ctx, session);
+      return -1;
+    }
+  }
+
+  dtls_sendqueue_lock(ctx);
+  srtt = peer ? peer->srtt : ctx->srtt;
+  rttvar = peer ? peer->rttvar : ctx->rttvar;
+  rto = peer ? dtls_peer_rto(ctx, peer) : dtls_rto(ctx, srtt, rttvar);
+  dtls_sendqueue_unlock(ctx);
+  if (session) {
+    dtls_session_unlock(ctx, session);
+  }
+
+  rtt->srtt = DTLS_TICKS_TO_MS(srtt);
+  rtt->rttvar = DTLS_TICKS_TO_MS(rttvar);
+  rtt->rto = DTLS_TICKS_TO_MS(rto);
+  return 0;
+}
+
+int
+dtls_set_peer_mtu(dtls_context_t *ctx, const session_t *session, size_t mtu) {
+  dtls_peer_t *peer;
+
+  dtls_session_lock(ctx, session);
+  peer = dtls_get_peer(ctx, session);
+  if (peer)
+    peer->mtu = mtu < DTLS_MAX_BUF ? mtu : DTLS_MAX_BUF;
+  dtls_session_unlock(ctx, session);
+  return peer ? 0 : -1;
+}
+
+int
+dtls_report_path_mtu(dtls_context_t *ctx, const session_t *session, size_t mtu) {
+  dtls_peer_t *peer;
+
+  dtls_session_lock(ctx, session);
+  peer = dtls_get_peer(ctx, session);
+  if (peer && mtu < dtls_peer_mtu(ctx, peer)) {
+    dtls_info("path MTU lowered to %zu\n", mtu);
+    peer->mtu = mtu;
+  }
+  dtls_session_unlock(ctx, session);
+  return peer ? 0 : -1;
+}
+
+/*
+ * The client addresses validated by a cookie exchange or a handshake.
+ * An address is found by a tag, the cookie secret's HMAC of its IP
+ * address without the port, in a slot indexed by the tag. A newer
+ * address replaces an older one in the same slot.
+ */
+#if DTLS_VALIDATED_ADDRESSES > 0
+static uint32_t
+dtls_address_tag(dtls_context_t *ctx, const session_t *session) {
+  dtls_hmac_context_t hmac_context;
+  dtls_session_key_t key;
+  unsigned char buf[DTLS_HMAC_MAX];
+  uint32_t tag;
+
+  dtls_session_key(session, &key);
+  key.port = 0;
+  dtls_hmac_init(&hmac_context, ctx->cookie_secret, DTLS_COOKIE_SECRET_LENGTH);
+  dtls_hmac_update(&hmac_context, (uint8 *)&key, sizeof(key));
+  dtls_hmac_finalize(&hmac_context, buf);
+  tag = dtls_uint32_to_int(buf);
+  return tag ? tag : 1;
+}
+
+/* Counts an initial ClientHello, the caller holds the sessions lock. */
+static int
+dtls_hello_rate_ok(dtls_context_t *ctx, dtls_tick_t now) {
+  unsigned int max_rate = ctx->validation.max_rate;
+
+  if (now - ctx->hello_time >= DTLS_TICKS_PER_SECOND) {
+    ctx->hellos_before = now - ctx->hello_time < 2 * DTLS_TICKS_PER_SECOND ?
+      ctx->hellos : 0;
+    ctx->hellos = 0;
+    ctx->hello_time = now;
+  }
+  ctx->hellos++;
+  return !max_rate ||
+    (ctx->hellos <= max_rate && ctx->hellos_before <= max_rate);
+}
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+
+/**
+ * Checks if the address of @p session has been validated recently
+ * and the rate of initial ClientHellos permits to skip the cookie
+ * exchange.
+ */
+static int
+dtls_address_validated(dtls_context_t *ctx, const session_t *session) {
+#if DTLS_VALIDATED_ADDRESSES > 0
+  dtls_validated_address_t *slot;
+  dtls_tick_t now;
+  uint32_t tag;
+  int res;
+
+  if (!ctx->validation.lifetime)
+    return 0;
+
+  tag = dtls_address_tag(ctx, session);
+  dtls_ticks(&now);
+  dtls_sessions_lock(ctx);
+  slot = &ctx->validated[tag % DTLS_VALIDATED_ADDRESSES];
+  res = dtls_hello_rate_ok(ctx, now) && slot->tag == tag &&
+    now - slot->validated <
+    (dtls_tick_t)ctx->validation.lifetime * DTLS_TICKS_PER_SECOND;
+  dtls_sessions_unlock(ctx);
+  return res;
+#else /* DTLS_VALIDATED_ADDRESSES > 0 */
+  (void)ctx;
+  (void)session;
+  return 0;
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+}
+
+/** Remembers the address of @p session as validated. */
+static void
+dtls_validate_address(dtls_context_t *ctx, const session_t *session) {
+#if DTLS_VALIDATED_ADDRESSES > 0
+  dtls_validated_address_t *slot;
+  dtls_tick_t now;
+  uint32_t tag;
+
+  if (!ctx->validation.lifetime)
+    return;
+
+  tag = dtls_address_tag(ctx, session);
+  dtls_ticks(&now);
+  dtls_sessions_lock(ctx);
+  slot = &ctx->validated[tag % DTLS_VALIDATED_ADDRESSES];
+  slot->tag = tag;
+  slot->validated = now;
+  dtls_sessions_unlock(ctx);
+#else /* DTLS_VALIDATED_ADDRESSES > 0 */
+  (void)ctx;
+  (void)session;
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+}
+
 /**
  * Checks a received ClientHello message for a valid cookie. When the
  * ClientHello contains no cookie, the function fails and a HelloVerifyRequest
  * is sent to the peer (using the write callback function registered
- * with \p ctx). The return value is \c -1 on error, \c 1 when
+ * with \p ctx), unless the client's address has been validated
+ * recently. The return value is \c -1 on error, \c 1 when
  * undecided, and \c 0 if the ClientHello was good.
  *
  * \param ctx              The DTLS context.
@@ -2264,6 +4462,16 @@ dtls_0_verify_peer(dtls_context_t *ctx,
     dtls_debug_dump("not matching cookie", cookie, len);
   } else {
     dtls_debug("found matching cookie\n");
+    dtls_validate_address(ctx, ephemeral_peer->session);
+    return 0;
+  }
+
+  /* A client that has answered a HelloVerifyRequest recently is
+   * trusted to own its address, unless it would replace an existing
+   * session with an unverified ClientHello. */
+  if (dtls_address_validated(ctx, ephemeral_peer->session) &&
+      !dtls_get_peer(ctx, ephemeral_peer->session)) {
+    dtls_debug("address validated recently, skip HelloVerifyRequest\n");
     return 0;
   }
 
@@ -2484,24 +4692,42 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
    * buffer. (The size of the destination buffer is checked by the
    * encoding function, so we do not need to guess.)
    *
+   * session id              := DTLS_SESSION_ID_LENGTH bytes
    * extensions length       := 2 bytes
    * client certificate type := 5 bytes
    * server certificate type := 5 bytes
    * ec_point_formats        := 6 bytes
    * extended master secret  := 4 bytes
    * renegotiation info      := 5 bytes
+   * record size limit       := 6 bytes
+   * session ticket          := 4 bytes
+   * connection id           := 5 bytes + DTLS_CID_LENGTH
    *
    * (no elliptic_curves in ServerHello.)
    */
-  uint8 buf[DTLS_SH_LENGTH + 2 + 5 + 5 + 6 + 4 + 5];
+  uint8 buf[DTLS_SH_LENGTH + DTLS_SESSION_ID_LENGTH + 2 + 5 + 5 + 6 + 4 + 5 + 6 + 4 + 5 + DTLS_CID_LENGTH];
   uint8 *p;
   uint8 extension_size;
+  uint8 cid_length = 0;
   dtls_handshake_parameters_t * const handshake = peer->handshake_params;
   const dtls_cipher_t cipher_suite = get_cipher_suite(handshake->cipher_index);
   const int ecdsa = is_key_exchange_ecdhe_ecdsa(handshake->cipher_index);
 
+#if DTLS_CID_LENGTH > 0
+  if (handshake->connection_id) {
+    /* the client is asked to send our connection id, which is kept
+     * when the ServerHello is sent again */
+    if (!peer->read_cid_length && dtls_add_cid(ctx, peer) < 0)
+      dtls_warn("no free connection id, the client's is used alone\n");
+    cid_length = peer->read_cid_length;
+  }
+#endif /* DTLS_CID_LENGTH > 0 */
+
   extension_size = (handshake->extended_master_secret ? 4 : 0) +
                    (handshake->renegotiation_info ? 5 : 0) +
+                   (peer->record_size_limit ? 6 : 0) +
+                   (handshake->session_ticket ? 4 : 0) +
+                   (handshake->connection_id ? 5 + cid_length : 0) +
                    (ecdsa ? 5 + 5 + 6 : 0);
 
   /* Handshake header */
@@ -2511,13 +4737,16 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
   dtls_int_to_uint16(p, DTLS_VERSION);
   p += sizeof(uint16);
 
-  /* Set 32 bytes of server random data. */
-  dtls_prng(handshake->tmp.random.server, DTLS_RANDOM_LENGTH);
-
+  /* The server random has been set by handle_verified_client_hello(). */
   memcpy(p, handshake->tmp.random.server, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  *p++ = 0;			/* no session id */
+  /* the id of the new or resumed session, empty if it cannot be
+   * resumed */
+  dtls_int_to_uint8(p, handshake->session_id_length);
+  p += sizeof(uint8);
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   if (cipher_suite != TLS_NULL_WITH_NULL_NULL) {
     /* selected cipher suite */
@@ -2573,9 +4802,47 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
     p += sizeof(uint8);
 
   }
-  if (handshake->extended_master_secret) {
-    /* extended master secret, 4 bytes */
-    dtls_int_to_uint16(p, TLS_EXT_EXTENDED_MASTER_SECRET);
+  if (handshake->extended_master_secret) {
+    /* extended master secret, 4 bytes */
+    dtls_int_to_uint16(p, TLS_EXT_EXTENDED_MASTER_SECRET);
+    p += sizeof(uint16);
+
+    /* length of this extension type */
+    dtls_int_to_uint16(p, 0);
+    p += sizeof(uint16);
+  }
+
+  if (handshake->renegotiation_info) {
+    /* RFC5746 minimal version, empty renegotiation info, 5 bytes */
+    dtls_int_to_uint16(p, TLS_EXT_RENEGOTIATION_INFO);
+    p += sizeof(uint16);
+
+    /* length of this extension type */
+    dtls_int_to_uint16(p, 1);
+    p += sizeof(uint16);
+
+    /* empty renegotiation info */
+    *p++ = 0;
+  }
+
+#if DTLS_RECORD_SIZE_LIMIT > 0
+  if (peer->record_size_limit) {
+    /* only sent in response to the client's, 6 bytes */
+    dtls_int_to_uint16(p, TLS_EXT_RECORD_SIZE_LIMIT);
+    p += sizeof(uint16);
+
+    /* length of this extension type */
+    dtls_int_to_uint16(p, sizeof(uint16));
+    p += sizeof(uint16);
+
+    dtls_int_to_uint16(p, DTLS_OWN_RECORD_SIZE_LIMIT);
+    p += sizeof(uint16);
+  }
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+
+  if (handshake->session_ticket) {
+    /* empty, a NewSessionTicket follows, 4 bytes */
+    dtls_int_to_uint16(p, TLS_EXT_SESSION_TICKET);
     p += sizeof(uint16);
 
     /* length of this extension type */
@@ -2583,17 +4850,21 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
     p += sizeof(uint16);
   }
 
-  if (handshake->renegotiation_info) {
-    /* RFC5746 minimal version, empty renegotiation info, 5 bytes */
-    dtls_int_to_uint16(p, TLS_EXT_RENEGOTIATION_INFO);
+  if (handshake->connection_id) {
+    /* RFC 9146, 5 bytes + the connection id */
+    dtls_int_to_uint16(p, TLS_EXT_CONNECTION_ID);
     p += sizeof(uint16);
 
     /* length of this extension type */
-    dtls_int_to_uint16(p, 1);
+    dtls_int_to_uint16(p, sizeof(uint8) + cid_length);
     p += sizeof(uint16);
 
-    /* empty renegotiation info */
-    *p++ = 0;
+    dtls_int_to_uint8(p, cid_length);
+    p += sizeof(uint8);
+#if DTLS_CID_LENGTH > 0
+    memcpy(p, peer->read_cid, cid_length);
+    p += cid_length;
+#endif /* DTLS_CID_LENGTH > 0 */
   }
 
   assert((buf <= p) && ((unsigned int)(p - buf) <= sizeof(buf)));
@@ -2711,6 +4982,7 @@ dtls_send_server_key_exchange_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   uint32_t point_r[9];
   uint32_t point_s[9];
   dtls_handshake_parameters_t *config = peer->handshake_params;
+  dtls_crypto_job_t *job;
 
   /* ServerKeyExchange
    *
@@ -2741,16 +5013,27 @@ dtls_send_server_key_exchange_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   ephemeral_pub_y = p;
   p += DTLS_EC_KEY_SIZE;
 
-  dtls_ecdsa_generate_key(config->keyx.ecdsa.own_eph_priv,
-			  ephemeral_pub_x, ephemeral_pub_y,
-			  DTLS_EC_KEY_SIZE);
+  job = dtls_crypto_job_take(config, DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE);
+  if (job) {
+    /* key and signature have been created by the crypto executor */
+    memcpy(config->keyx.ecdsa.own_eph_priv, job->own_eph_priv, DTLS_EC_KEY_SIZE);
+    memcpy(ephemeral_pub_x, job->own_eph_pub_x, DTLS_EC_KEY_SIZE);
+    memcpy(ephemeral_pub_y, job->own_eph_pub_y, DTLS_EC_KEY_SIZE);
+    memcpy(point_r, job->point_r, sizeof(point_r));
+    memcpy(point_s, job->point_s, sizeof(point_s));
+    dtls_crypto_job_free(job);
+  } else {
+    dtls_ecdsa_generate_key(config->keyx.ecdsa.own_eph_priv,
+			    ephemeral_pub_x, ephemeral_pub_y,
+			    DTLS_EC_KEY_SIZE);
 
-  /* sign the ephemeral and its paramaters */
-  dtls_ecdsa_create_sig(key->priv_key, DTLS_EC_KEY_SIZE,
-		       config->tmp.random.client, DTLS_RANDOM_LENGTH,
-		       config->tmp.random.server, DTLS_RANDOM_LENGTH,
-		       key_params, p - key_params,
-		       point_r, point_s);
+    /* sign the ephemeral and its paramaters */
+    dtls_ecdsa_create_sig(key->priv_key, DTLS_EC_KEY_SIZE,
+			  config->tmp.random.client, DTLS_RANDOM_LENGTH,
+			  config->tmp.random.server, DTLS_RANDOM_LENGTH,
+			  key_params, p - key_params,
+			  point_r, point_s);
+  }
 
   p = dtls_add_ecdsa_signature_elem(p, point_r, point_s);
 
@@ -2992,6 +5275,7 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
     {
       uint8 *ephemeral_pub_x;
       uint8 *ephemeral_pub_y;
+      dtls_crypto_job_t *job;
 
       dtls_int_to_uint8(p, 1 + 2 * DTLS_EC_KEY_SIZE);
       p += sizeof(uint8);
@@ -3005,9 +5289,18 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
       ephemeral_pub_y = p;
       p += DTLS_EC_KEY_SIZE;
 
-    dtls_ecdsa_generate_key(peer->handshake_params->keyx.ecdsa.own_eph_priv,
-    			    ephemeral_pub_x, ephemeral_pub_y,
-    			    DTLS_EC_KEY_SIZE);
+      job = dtls_crypto_job_peek(handshake, DTLS_CRYPTO_JOB_CLIENT_KEY_EXCHANGE);
+      if (job) {
+        /* the pre master secret is taken by calculate_key_block() */
+        memcpy(handshake->keyx.ecdsa.own_eph_priv, job->own_eph_priv,
+               DTLS_EC_KEY_SIZE);
+        memcpy(ephemeral_pub_x, job->own_eph_pub_x, DTLS_EC_KEY_SIZE);
+        memcpy(ephemeral_pub_y, job->own_eph_pub_y, DTLS_EC_KEY_SIZE);
+      } else {
+        dtls_ecdsa_generate_key(peer->handshake_params->keyx.ecdsa.own_eph_priv,
+                                ephemeral_pub_x, ephemeral_pub_y,
+                                DTLS_EC_KEY_SIZE);
+      }
 
       break;
     }
@@ -3106,6 +5399,87 @@ dtls_send_finished(dtls_context_t *ctx, dtls_peer_t *peer,
 				 buf, p - buf);
 }
 
+/**
+ * Sends a session ticket with the session negotiated with @p peer,
+ * before the ChangeCipherSpec of the server.
+ */
+static int
+dtls_send_new_session_ticket(dtls_context_t *ctx, dtls_peer_t *peer)
+{
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  uint8 buf[sizeof(uint32) + sizeof(uint16) + DTLS_TICKET_LENGTH];
+  uint8 *p = buf;
+  int res;
+
+  /* lifetime hint */
+  dtls_int_to_uint32(p, ctx->session_lifetime);
+  p += sizeof(uint32);
+
+  res = dtls_ticket_seal(ctx, peer->handshake_params, p + sizeof(uint16));
+  if (res < 0) {
+    dtls_warn("cannot create session ticket\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+  dtls_int_to_uint16(p, res);
+  p += sizeof(uint16) + res;
+
+  return dtls_send_handshake_msg(ctx, peer, DTLS_HT_NEW_SESSION_TICKET,
+				 buf, p - buf);
+#else /* DTLS_SESSION_TICKET_LENGTH > 0 */
+  (void)ctx;
+  (void)peer;
+  return 0;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+}
+
+/**
+ * Sends the flight of an abbreviated handshake, the ServerHello with
+ * the id of the resumed @p session, a NewSessionTicket if the ticket
+ * the client has sent is to be replaced, and the server's
+ * ChangeCipherSpec and Finished. The client answers with its
+ * ChangeCipherSpec and Finished.
+ */
+static int
+dtls_send_server_resume_msgs(dtls_context_t *ctx, dtls_peer_t *peer,
+			     const dtls_session_cache_entry_t *session)
+{
+  int res;
+
+  res = dtls_send_server_hello(ctx, peer);
+  if (res < 0) {
+    dtls_debug("dtls_server_hello: cannot prepare ServerHello record\n");
+    return res;
+  }
+
+  res = dtls_session_resume(peer, session);
+  if (res < 0) {
+    return res;
+  }
+
+  if (peer->handshake_params->session_ticket) {
+    res = dtls_send_new_session_ticket(ctx, peer);
+    if (res < 0)
+      return res;
+  }
+
+  res = dtls_send_ccs(ctx, peer);
+  if (res < 0) {
+    dtls_debug("cannot send CCS message\n");
+    return res;
+  }
+
+  dtls_security_params_switch(peer);
+
+  res = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+  if (res < 0) {
+    dtls_debug("sending server Finished failed\n");
+    return res;
+  }
+
+  peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+  return 0;
+}
+
 static int
 dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
                        uint8 cookie[], size_t cookie_length) {
@@ -3114,7 +5488,16 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   uint8_t *p_cipher_suites_size = NULL;
   uint8_t index = 0;
   uint8_t cipher_suites_size = 0;
-  uint8_t extension_size = 4; /* extended master secret extension */
+  /* extended master secret extension */
+  uint16_t extension_size = 4;
+#if DTLS_RECORD_SIZE_LIMIT > 0
+  /* record size limit extension */
+  extension_size += 6;
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+#if DTLS_MAX_CID_LENGTH > 0
+  /* connection id extension */
+  extension_size += 5;
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
 #ifdef DTLS_ECC
   uint8_t ecdsa = 0;
 #endif
@@ -3134,16 +5517,39 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   }
 
   if (cookie_length == 0) {
+    dtls_session_cache_entry_t session;
+
     /* Set 32 bytes of client random data */
     dtls_prng(handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
+
+    /* offer the last session with this server for resumption */
+    handshake->session_id_length = 0;
+#if DTLS_SESSION_TICKET_LENGTH > 0
+    handshake->ticket_length = 0;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+    if (dtls_session_cache_get(ctx, DTLS_CLIENT, &peer->session,
+                               NULL, 0, &session) == 0 &&
+        known_cipher(ctx, session.cipher_index, 1) &&
+        contains_cipher_suite(handshake->user_parameters.cipher_suites,
+                              get_cipher_suite(session.cipher_index))) {
+      handshake->session_id_length = session.id_length;
+      memcpy(handshake->session_id, session.id, session.id_length);
+#if DTLS_SESSION_TICKET_LENGTH > 0
+      handshake->ticket_length = session.ticket_length;
+      memcpy(handshake->ticket, session.ticket, session.ticket_length);
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+    }
+    memset(&session, 0, sizeof(session));
   }
   /* we must use the same Client Random as for the previous request */
   memcpy(p, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  /* session id (length 0) */
-  dtls_int_to_uint8(p, 0);
+  /* session id, the same as for the previous request */
+  dtls_int_to_uint8(p, handshake->session_id_length);
   p += sizeof(uint8);
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   /* cookie */
   dtls_int_to_uint8(p, cookie_length);
@@ -3199,6 +5605,12 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
     extension_size += 6 + 6 + 8 + 6 + 8;
   }
 #endif
+#if DTLS_SESSION_TICKET_LENGTH > 0 && DTLS_SESSION_CACHE_SIZE > 0
+  if (ctx->session_lifetime) {
+    /* session ticket, 4 bytes and the ticket */
+    extension_size += 4 + handshake->ticket_length;
+  }
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 && DTLS_SESSION_CACHE_SIZE > 0 */
 
   /* compression method */
   dtls_int_to_uint8(p, 1);
@@ -3305,6 +5717,48 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   p += sizeof(uint16);
   handshake->extended_master_secret = 1;
 
+#if DTLS_RECORD_SIZE_LIMIT > 0
+  /* record size limit, 6 bytes */
+  dtls_int_to_uint16(p, TLS_EXT_RECORD_SIZE_LIMIT);
+  p += sizeof(uint16);
+
+  /* length of this extension type */
+  dtls_int_to_uint16(p, sizeof(uint16));
+  p += sizeof(uint16);
+
+  dtls_int_to_uint16(p, DTLS_OWN_RECORD_SIZE_LIMIT);
+  p += sizeof(uint16);
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+
+#if DTLS_MAX_CID_LENGTH > 0
+  /* connection id, empty as the records of the server are found by
+   * its address, 5 bytes */
+  dtls_int_to_uint16(p, TLS_EXT_CONNECTION_ID);
+  p += sizeof(uint16);
+
+  /* length of this extension type */
+  dtls_int_to_uint16(p, sizeof(uint8));
+  p += sizeof(uint16);
+
+  dtls_int_to_uint8(p, 0);
+  p += sizeof(uint8);
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+
+#if DTLS_SESSION_TICKET_LENGTH > 0 && DTLS_SESSION_CACHE_SIZE > 0
+  if (ctx->session_lifetime) {
+    /* session ticket, empty to ask the server for one */
+    dtls_int_to_uint16(p, TLS_EXT_SESSION_TICKET);
+    p += sizeof(uint16);
+
+    /* length of this extension type */
+    dtls_int_to_uint16(p, handshake->ticket_length);
+    p += sizeof(uint16);
+
+    memcpy(p, handshake->ticket, handshake->ticket_length);
+    p += handshake->ticket_length;
+  }
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 && DTLS_SESSION_CACHE_SIZE > 0 */
+
   handshake->hs_state.read_epoch = dtls_security_params(peer)->epoch;
   assert((buf <= p) && ((unsigned int)(p - buf) <= sizeof(buf)));
 
@@ -3321,6 +5775,8 @@ check_server_hello(dtls_context_t *ctx,
 		      uint8 *data, size_t data_length)
 {
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_entry_t session;
+  int i, resume;
 
   /*
    * Check we have enough data for the ServerHello
@@ -3359,9 +5815,18 @@ check_server_hello(dtls_context_t *ctx,
   data += DTLS_RANDOM_LENGTH;
   data_length -= DTLS_RANDOM_LENGTH;
 
-  /* skip session_id */
-  SKIP_VAR_FIELD(data, data_length, uint8, DTLS_ALERT_DECODE_ERROR,
-                 "ServerHello, session_id");
+  /* session_id, the offered one if the server resumes the session */
+  i = dtls_uint8_to_int(data);
+  if (i > DTLS_SESSION_ID_LENGTH || data_length < sizeof(uint8) + i) {
+    dtls_alert("invalid session id in ServerHello\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
+  resume = i && i == handshake->session_id_length &&
+    memcmp(handshake->session_id, data + sizeof(uint8), i) == 0;
+  handshake->session_id_length = i;
+  memcpy(handshake->session_id, data + sizeof(uint8), i);
+  data += sizeof(uint8) + i;
+  data_length -= sizeof(uint8) + i;
   /*
    * Need to re-check in case session id was not empty
    *   2 bytes for the selected cipher suite
@@ -3395,7 +5860,20 @@ check_server_hello(dtls_context_t *ctx,
 
   /* Server may not support extended master secret */
   handshake->extended_master_secret = 0;
-  return dtls_check_tls_extension(peer, data, data_length, 0);
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  /* only a NewSessionTicket replaces the offered ticket */
+  handshake->session_ticket = 0;
+  handshake->ticket_length = 0;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+  i = dtls_check_tls_extension(peer, data, data_length, 0);
+  if (i < 0 || !resume)
+    return i;
+
+  i = dtls_session_resumable(ctx, peer, &session);
+  if (i == 0)
+    i = dtls_session_resume(peer, &session);
+  memset(&session, 0, sizeof(session));
+  return i;
 }
 
 static int
@@ -3474,14 +5952,14 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
 				dtls_peer_t *peer,
 				uint8 *data, size_t data_length)
 {
-  (void) ctx;
   dtls_handshake_parameters_t *config = peer->handshake_params;
   int ret;
   unsigned char result_r[DTLS_EC_KEY_SIZE];
   unsigned char result_s[DTLS_EC_KEY_SIZE];
   unsigned char *key_params;
-
-  update_hs_hash(peer, data, data_length);
+  uint8 *msg = data;
+  size_t msg_length = data_length;
+  dtls_crypto_job_t *job;
 
   assert(is_key_exchange_ecdhe_ecdsa(config->cipher_index));
 
@@ -3542,18 +6020,33 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
   data += ret;
   data_length -= ret;
 
-  ret = dtls_ecdsa_verify_sig(config->keyx.ecdsa.other_pub_x, config->keyx.ecdsa.other_pub_y,
-			    sizeof(config->keyx.ecdsa.other_pub_x),
-			    config->tmp.random.client, DTLS_RANDOM_LENGTH,
-			    config->tmp.random.server, DTLS_RANDOM_LENGTH,
-			    key_params,
-			    1 + 2 + 1 + 1 + (2 * DTLS_EC_KEY_SIZE),
-			    result_r, result_s);
+  ret = dtls_offload_verify_key_exchange(ctx, peer, result_r, result_s);
+  if (ret == DTLS_CRYPTO_PENDING) {
+    return ret;
+  }
+
+  job = dtls_crypto_job_take(config, DTLS_CRYPTO_JOB_VERIFY_KEY_EXCHANGE);
+  if (job) {
+    ret = job->result;
+    dtls_crypto_job_free(job);
+  } else {
+    ret = dtls_ecdsa_verify_sig(config->keyx.ecdsa.other_pub_x, config->keyx.ecdsa.other_pub_y,
+			      sizeof(config->keyx.ecdsa.other_pub_x),
+			      config->tmp.random.client, DTLS_RANDOM_LENGTH,
+			      config->tmp.random.server, DTLS_RANDOM_LENGTH,
+			      key_params,
+			      DTLS_EC_KEY_PARAMS_LENGTH,
+			      result_r, result_s);
+  }
 
   if (ret < 0) {
     dtls_alert("server key exchange wrong signature\n");
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
   }
+
+  /* The message is added after the verification, which may have been
+   * offloaded and therefore handles this message twice. */
+  update_hs_hash(peer, msg, msg_length);
   return 0;
 }
 #endif /* DTLS_ECC */
@@ -3690,6 +6183,54 @@ check_certificate_request(dtls_context_t *ctx,
 }
 #endif /* DTLS_ECC */
 
+#if DTLS_SESSION_TICKET_LENGTH > 0
+/**
+ * Parses the NewSessionTicket of the server and keeps the ticket with
+ * the session, when the handshake completes.
+ */
+static int
+check_new_session_ticket(dtls_peer_t *peer, uint8 *data, size_t data_length)
+{
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  size_t length;
+
+  update_hs_hash(peer, data, data_length);
+
+  if (data_length < DTLS_HS_LENGTH + sizeof(uint32) + sizeof(uint16))
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+
+  /* skip the lifetime hint, the session lifetime of the client applies */
+  data += DTLS_HS_LENGTH + sizeof(uint32);
+  data_length -= DTLS_HS_LENGTH + sizeof(uint32);
+
+  length = dtls_uint16_to_int(data);
+  if (data_length != sizeof(uint16) + length)
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+
+  if (length <= DTLS_SESSION_TICKET_LENGTH) {
+    handshake->ticket_length = length;
+    memcpy(handshake->ticket, data + sizeof(uint16), length);
+  } else {
+    dtls_info("session ticket of %zu bytes is too long to keep\n", length);
+  }
+  handshake->session_ticket = 0;
+  return 0;
+}
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+/**
+ * Checks if the client @p peer may send application data after its
+ * Finished, see dtls_set_false_start(). RFC 7918 requires a full
+ * handshake with a forward secure key exchange and an AEAD cipher,
+ * which all ECDHE_ECDSA cipher suites of tinydtls use.
+ */
+static int
+dtls_may_false_start(const dtls_context_t *ctx, const dtls_peer_t *peer) {
+  return ctx->false_start && peer->role == DTLS_CLIENT &&
+    !peer->handshake_params->resumed &&
+    is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher_index);
+}
+
 static int
 check_server_hellodone(dtls_context_t *ctx,
 		      dtls_peer_t *peer,
@@ -3702,6 +6243,14 @@ check_server_hellodone(dtls_context_t *ctx,
 
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
 
+#ifdef DTLS_ECC
+  /* ephemeral key and ECDH are done before any message is sent */
+  res = dtls_offload_client_key_exchange(ctx, peer);
+  if (res == DTLS_CRYPTO_PENDING) {
+    return res;
+  }
+#endif /* DTLS_ECC */
+
   /* calculate master key, send CCS */
 
   update_hs_hash(peer, data, data_length);
@@ -3769,10 +6318,11 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
 {
   dtls_record_header_t *header = DTLS_RECORD_HEADER(packet);
   dtls_security_parameters_t *security = dtls_security_params_read_epoch(peer, dtls_get_epoch(header));
+  size_t header_length = dtls_record_header_length(packet);
   int clen;
 
-  *cleartext = (uint8 *)packet + sizeof(dtls_record_header_t);
-  clen = length - sizeof(dtls_record_header_t);
+  *cleartext = (uint8 *)packet + header_length;
+  clen = length - header_length;
 
   if (!security) {
     dtls_alert("No security context for epoch: %i\n", dtls_get_epoch(header));
@@ -3785,13 +6335,9 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
   } else { /* TLS_PSK_WITH_AES_128_CCM_8, TLS_PSK_WITH_AES_128_CCM,
               TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 or
               TLS_ECDHE_ECDSA_WITH_AES_128_CCM */
-    /**
-     * length of additional_data for the AEAD cipher which consists of
-     * seq_num(2+6) + type(1) + version(2) + length(2)
-     */
-#define A_DATA_LEN 13
     unsigned char nonce[DTLS_CCM_BLOCKSIZE];
-    unsigned char A_DATA[A_DATA_LEN];
+    unsigned char A_DATA[DTLS_A_DATA_LENGTH_MAX];
+    size_t a_data_length;
     const uint8_t mac_len = get_cipher_suite_mac_len(security->cipher_index);
     /* For backwards-compatibility, dtls_encrypt_params is called with
      * M=<macLen> and L=3. */
@@ -3814,25 +6360,21 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
 		    dtls_kb_key_size(security, peer->role));
     dtls_debug_dump("ciphertext", *cleartext, clen);
 
-    /* re-use N to create additional data according to RFC 5246, Section 6.2.3.3:
-     *
-     * additional_data = seq_num + TLSCompressed.type +
-     *                   TLSCompressed.version + TLSCompressed.length;
-     */
-    memcpy(A_DATA, &DTLS_RECORD_HEADER(packet)->epoch, 8); /* epoch and seq_num */
-    memcpy(A_DATA + 8,  &DTLS_RECORD_HEADER(packet)->content_type, 3); /* type and version */
-
-    dtls_int_to_uint16(A_DATA + 11, clen - mac_len); /* length without MAC */
+    /* length without MAC */
+    a_data_length = dtls_record_a_data(packet, header_length, clen - mac_len,
+                                       A_DATA);
 
     clen = dtls_decrypt_params(&params, *cleartext, clen, *cleartext,
                dtls_kb_remote_write_key(security, peer->role),
                dtls_kb_key_size(security, peer->role),
-               A_DATA, A_DATA_LEN);
+               A_DATA, a_data_length);
     if (clen < 0)
       dtls_warn("decryption failed\n");
     else {
       dtls_debug("decrypt_verify(): found %i bytes cleartext\n", clen);
-      dtls_security_params_free_other(peer);
+      /* the previous epoch is kept to send a pending flight again */
+      if (!peer->retransmit)
+        dtls_security_params_free_other(peer);
       dtls_debug_dump("cleartext", *cleartext, clen);
     }
   }
@@ -3854,6 +6396,16 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
 static int
 handle_verified_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
 		uint8 *data, size_t data_length) {
+  dtls_session_cache_entry_t session;
+  int err;
+
+#ifdef DTLS_ECC
+  /* When resumed by dtls_crypto_job_complete(), the ClientHello has
+   * already been processed. */
+  if (dtls_crypto_job_peek(peer->handshake_params,
+			   DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE))
+    goto send_server_hello;
+#endif /* DTLS_ECC */
 
   clear_hs_hash(peer);
 
@@ -3863,8 +6415,9 @@ handle_verified_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
    * message containing a ClientHello. dtls_get_cipher() therefore
    * does not check again.
    */
-  int err = dtls_update_parameters(ctx, peer, data, data_length);
+  err = dtls_update_parameters(ctx, peer, data, data_length, &session);
   if (err < 0) {
+    memset(&session, 0, sizeof(session));
     dtls_warn("error updating security parameters\n");
     return err;
   }
@@ -3872,6 +6425,31 @@ handle_verified_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   /* update finish MAC */
   update_hs_hash(peer, data, data_length);
 
+  /* Set 32 bytes of server random data. */
+  dtls_prng(peer->handshake_params->tmp.random.server, DTLS_RANDOM_LENGTH);
+
+  if (peer->handshake_params->resumed) {
+    err = dtls_send_server_resume_msgs(ctx, peer, &session);
+    memset(&session, 0, sizeof(session));
+    return err;
+  }
+
+  /* The id of the new session, if it may be resumed from the cache.
+   * A client that receives a ticket keeps the session instead. */
+  peer->handshake_params->session_id_length =
+    DTLS_SESSION_CACHE_SIZE && ctx->session_lifetime &&
+    !peer->handshake_params->session_ticket ? DTLS_SESSION_ID_LENGTH : 0;
+  dtls_prng(peer->handshake_params->session_id,
+            peer->handshake_params->session_id_length);
+
+#ifdef DTLS_ECC
+  err = dtls_offload_server_key_exchange(ctx, peer);
+  if (err == DTLS_CRYPTO_PENDING) {
+    return err;
+  }
+
+ send_server_hello:
+#endif /* DTLS_ECC */
   err = dtls_send_server_hello_msgs(ctx, peer);
   if (err < 0) {
     return err;
@@ -3899,7 +6477,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
    * should get expected when we still should retransmit something, when
    * we do everything accordingly to the DTLS 1.2 standard this should
    * not be a problem. */
-  dtls_stop_retransmission(ctx, peer);
+  dtls_flight_acked(ctx, peer);
 
   /* The following switch construct handles the given message with
    * respect to the current internal state for this peer. In case of
@@ -3937,7 +6515,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       return err;
     }
     /* check_server_hello sets the cipher_index */
-    if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher_index))
+    if (peer->handshake_params->resumed)
+      peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    else if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher_index))
       peer->state = DTLS_STATE_WAIT_SERVERCERTIFICATE;
     else {
       peer->optional_handshake_message = DTLS_HT_SERVER_KEY_EXCHANGE;
@@ -3999,6 +6579,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_server_key_exchange err: %i\n", err);
       return err;
     }
+    if (err == DTLS_CRYPTO_PENDING) {
+      return err;
+    }
     peer->state = DTLS_STATE_WAIT_SERVERHELLODONE;
     /* update_hs_hash(peer, data, data_length); */
 
@@ -4015,7 +6598,11 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_server_hellodone err: %i\n", err);
       return err;
     }
+    if (err == DTLS_CRYPTO_PENDING) {
+      return err;
+    }
     peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    peer->handshake_params->false_start = dtls_may_false_start(ctx, peer);
     /* update_hs_hash(peer, data, data_length); */
 
     break;
@@ -4038,6 +6625,27 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
     break;
 #endif /* DTLS_ECC */
 
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  case DTLS_HT_NEW_SESSION_TICKET:
+
+    if (role != DTLS_CLIENT || state != DTLS_STATE_WAIT_CHANGECIPHERSPEC ||
+        !peer->handshake_params->session_ticket) {
+      return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
+    }
+
+    err = check_new_session_ticket(peer, data, data_length);
+    if (err < 0) {
+      dtls_warn("error in check_new_session_ticket err: %i\n", err);
+      return err;
+    }
+
+    if (peer->handshake_params->ccs_deferred) {
+      peer->handshake_params->hs_state.read_epoch++;
+      peer->state = DTLS_STATE_WAIT_FINISHED;
+    }
+    break;
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
   case DTLS_HT_FINISHED:
     /* expect a Finished message from server */
 
@@ -4050,10 +6658,17 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_finished err: %i\n", err);
       return err;
     }
-    if (role == DTLS_SERVER) {
-      /* send ServerFinished */
+    /* The server sends its Finished second in a full handshake, the
+     * client in an abbreviated one. */
+    if ((role == DTLS_SERVER) != peer->handshake_params->resumed) {
       update_hs_hash(peer, data, data_length);
 
+      if (peer->handshake_params->session_ticket) {
+        err = dtls_send_new_session_ticket(ctx, peer);
+        if (err < 0)
+          return err;
+      }
+
       /* send change cipher spec message and switch to new configuration */
       err = dtls_send_ccs(ctx, peer);
       if (err < 0) {
@@ -4063,12 +6678,21 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
 
       dtls_security_params_switch(peer);
 
-      err = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+      if (role == DTLS_SERVER)
+        err = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+      else
+        err = dtls_send_finished(ctx, peer, PRF_LABEL(client), PRF_LABEL_SIZE(client));
       if (err < 0) {
-        dtls_warn("sending server Finished failed\n");
+        dtls_warn("sending Finished failed\n");
         return err;
       }
     }
+    if (!peer->handshake_params->resumed
+#if DTLS_SESSION_TICKET_LENGTH > 0
+        || peer->handshake_params->ticket_length
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+        )
+      dtls_session_cache_put(ctx, peer);
     dtls_handshake_free(peer->handshake_params);
     peer->handshake_params = NULL;
     dtls_debug("Handshake complete\n");
@@ -4094,6 +6718,14 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_client_keyexchange err: %i\n", err);
       return err;
     }
+#ifdef DTLS_ECC
+    /* The key block is not required before the ChangeCipherSpec, but
+     * records are deferred while the job is pending anyway. */
+    err = dtls_offload_key_block(ctx, peer, data, data_length);
+    if (err == DTLS_CRYPTO_PENDING) {
+      return err;
+    }
+#endif /* DTLS_ECC */
     update_hs_hash(peer, data, data_length);
 
     /* Keep hash information for extended master secret */
@@ -4128,7 +6760,12 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
 
   case DTLS_HT_CLIENT_HELLO:
 
-    if (state != DTLS_STATE_CONNECTED) {
+    if (state != DTLS_STATE_CONNECTED
+#ifdef DTLS_ECC
+        && !dtls_crypto_job_peek(peer->handshake_params,
+                                 DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE)
+#endif /* DTLS_ECC */
+        ) {
       return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
     }
 
@@ -4141,7 +6778,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
     if (!peer->handshake_params) {
       dtls_handshake_header_t *hs_header = DTLS_HANDSHAKE_HEADER(data);
 
-      peer->handshake_params = dtls_handshake_new();
+      peer->handshake_params = dtls_handshake_new(ctx->mem);
       if (!peer->handshake_params)
         return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
 
@@ -4150,6 +6787,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       peer->handshake_params->hs_state.read_epoch = dtls_security_params(peer)->epoch;
     }
     err = handle_verified_client_hello(ctx, peer, data, data_length);
+    if (err == DTLS_CRYPTO_PENDING) {
+      return err;
+    }
 
     /* after sending the ServerHelloDone, we expect the
      * ClientKeyExchange (possibly containing the PSK id),
@@ -4200,17 +6840,63 @@ handle_0_verified_client_hello(dtls_context_t *ctx,
   int err;
 
   dtls_peer_t *peer = dtls_get_peer(ctx, ephemeral_peer->session);
+#ifdef DTLS_ECC
+  if (peer && is_crypto_job_pending(peer) &&
+      peer->handshake_params->crypto_job->type ==
+      DTLS_CRYPTO_JOB_SERVER_KEY_EXCHANGE) {
+    /* Retransmitted ClientHello, do not start over while the
+     * ServerKeyExchange is still being created. */
+    dtls_info("ignore ClientHello, crypto job pending\n");
+    return 0;
+  }
+#endif /* DTLS_ECC */
+  if (peer && peer->role == DTLS_SERVER && peer->handshake_params &&
+      (peer->state == DTLS_STATE_WAIT_CLIENTCERTIFICATE ||
+       peer->state == DTLS_STATE_WAIT_CLIENTKEYEXCHANGE) &&
+      peer->handshake_params->hs_state.mseq_r == ephemeral_peer->mseq + 1 &&
+      data_length >= DTLS_HS_LENGTH + sizeof(uint16) + DTLS_RANDOM_LENGTH &&
+      memcmp(data + DTLS_HS_LENGTH + sizeof(uint16),
+             peer->handshake_params->tmp.random.client,
+             DTLS_RANDOM_LENGTH) == 0) {
+    /* The ClientHello this handshake has started with, so the client
+     * has not received our flight. */
+    dtls_flight_resend(ctx, peer);
+    return 0;
+  }
+  if (peer && peer->role == DTLS_SERVER && peer->handshake_params &&
+      peer->handshake_params->resumed &&
+      peer->state == DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+      peer->handshake_params->hs_state.mseq_r == ephemeral_peer->mseq + 1 &&
+      data_length > DTLS_HS_LENGTH + sizeof(uint16) + DTLS_RANDOM_LENGTH +
+      peer->handshake_params->session_id_length &&
+      data[DTLS_HS_LENGTH + sizeof(uint16) + DTLS_RANDOM_LENGTH] ==
+      peer->handshake_params->session_id_length &&
+      memcmp(data + DTLS_HS_LENGTH + sizeof(uint16) + DTLS_RANDOM_LENGTH + 1,
+             peer->handshake_params->session_id,
+             peer->handshake_params->session_id_length) == 0) {
+    /* The client random has been replaced by the master secret of the
+     * resumed session, but the session id identifies the client. */
+    dtls_flight_resend(ctx, peer);
+    return 0;
+  }
   if (peer) {
      dtls_debug("removing the peer, new handshake\n");
      dtls_destroy_peer(ctx, peer, 0);
      peer = NULL;
   }
+
+  if (dtls_admit_peer(ctx) < 0) {
+    if (ctx->limits.reject == DTLS_REJECT_ALERT)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    /* the client may try again with its next retransmission */
+    return 0;
+  }
   dtls_debug("creating new peer\n");
 
   /* msg contains a ClientHello with a valid cookie, so we can
    * safely create the server state machine and continue with
    * the handshake. */
-  peer = dtls_new_peer(ephemeral_peer->session);
+  peer = dtls_alloc_peer(ctx->mem, ephemeral_peer->session);
   if (!peer) {
     dtls_alert("cannot create peer\n");
     return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
@@ -4230,10 +6916,10 @@ handle_0_verified_client_hello(dtls_context_t *ctx,
     return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
   }
 
-  peer->handshake_params = dtls_handshake_new();
+  peer->handshake_params = dtls_handshake_new(ctx->mem);
   if (!peer->handshake_params) {
     dtls_alert("cannot create handshake parameter\n");
-    DEL_PEER(ctx->peers, peer);
+    dtls_del_peer(ctx, peer);
     dtls_free_peer(peer);
     return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
   }
@@ -4243,6 +6929,16 @@ handle_0_verified_client_hello(dtls_context_t *ctx,
   peer->handshake_params->hs_state.mseq_s = ephemeral_peer->mseq;
 
   err = handle_verified_client_hello(ctx, peer, data, data_length);
+#ifdef DTLS_ECC
+  if (err == DTLS_CRYPTO_PENDING) {
+    /* handled again by dtls_crypto_job_complete() */
+    err = dtls_crypto_job_hold(peer, data, data_length);
+    if (err < 0) {
+      dtls_destroy_peer(ctx, peer, DTLS_DESTROY_CLOSE);
+    }
+    return err;
+  }
+#endif /* DTLS_ECC */
   if (err < 0) {
     dtls_destroy_peer(ctx, peer, DTLS_DESTROY_CLOSE);
     return err;
@@ -4290,7 +6986,8 @@ handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer
   fragment_length = dtls_uint24_to_int(hs_header->fragment_length);
   fragment_offset = dtls_uint24_to_int(hs_header->fragment_offset);
   if (packet_length != fragment_length || fragment_offset != 0) {
-    dtls_warn("No fragment support (yet)\n");
+    /* without a peer there is no state to reassemble it */
+    dtls_warn("drop fragmented initial ClientHello\n");
     return 0;
   }
   if (fragment_length + DTLS_HS_LENGTH != data_length) {
@@ -4316,6 +7013,49 @@ handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer
   return err;
 }
 
+/**
+ * Handles the buffered handshake messages of @p peer, as long as the
+ * next expected message is complete.
+ *
+ * \param ctx   The DTLS context to use.
+ * \param peer  The remote peer.
+ * \param res   The result to return if no message is handled.
+ * \return Less than zero on error, the result of the last handled
+ *         message otherwise.
+ */
+static int
+handle_reassembly(dtls_context_t *ctx, dtls_peer_t *peer, int res)
+{
+  netq_t *node;
+  uint16_t mseq;
+
+  while (peer->handshake_params) {
+    mseq = peer->handshake_params->hs_state.mseq_r;
+    node = dtls_reassembly_get(peer, mseq);
+    if (!node || !dtls_reassembly_complete(node))
+      break;
+
+    peer->handshake_params->reassembly[mseq % DTLS_HANDSHAKE_WINDOW] = NULL;
+    res = handle_handshake_msg(ctx, peer, node->data, node->length);
+
+#ifdef DTLS_ECC
+    if (res == DTLS_CRYPTO_PENDING) {
+      /* keep the message until the crypto job is completed */
+      peer->handshake_params->reassembly[mseq % DTLS_HANDSHAKE_WINDOW] = node;
+      return 0;
+    }
+#endif /* DTLS_ECC */
+
+    /* free message data */
+    netq_node_free(node);
+
+    if (res < 0) {
+      return res;
+    }
+  }
+  return res;
+}
+
 static int
 handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t data_length)
 {
@@ -4340,16 +7080,21 @@ handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t dat
   packet_length = dtls_uint24_to_int(hs_header->length);
   fragment_length = dtls_uint24_to_int(hs_header->fragment_length);
   fragment_offset = dtls_uint24_to_int(hs_header->fragment_offset);
-  if (packet_length != fragment_length || fragment_offset != 0) {
-    dtls_warn("No fragment support (yet)\n");
-    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
-  }
   if (fragment_length + DTLS_HS_LENGTH != data_length) {
     dtls_warn("Fragment size does not match packet size\n");
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
   }
+  if (fragment_offset + fragment_length > packet_length) {
+    dtls_warn("Fragment exceeds the handshake message\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+  }
 
   if (!peer->handshake_params) {
+    if (hs_header->msg_type == DTLS_HT_FINISHED) {
+      /* the peer has not received our last flight */
+      dtls_flight_resend(ctx, peer);
+      return 0;
+    }
 
     dtls_warn("ignore unexpected handshake message\n");
     return 0;
@@ -4358,83 +7103,39 @@ handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t dat
   if (mseq < peer->handshake_params->hs_state.mseq_r) {
     dtls_warn("The message sequence number is too small, expected %i, got: %i\n",
 	      peer->handshake_params->hs_state.mseq_r, mseq);
+    /* the last message of the peer's previous flight, sent again */
+    if (mseq + 1 == peer->handshake_params->hs_state.mseq_r)
+      dtls_flight_resend(ctx, peer);
     return 0;
-  } else if (mseq > peer->handshake_params->hs_state.mseq_r) {
-    /* A packet in between is missing, buffer this packet. */
-    netq_t *n;
-
-    dtls_info("The message sequence number is too larger, expected %i, got: %i\n",
-	      peer->handshake_params->hs_state.mseq_r, mseq);
-
-    /* TODO: only add packet that are not too new. */
-    if (data_length > DTLS_MAX_BUF) {
-      dtls_warn("the packet is too big to buffer for reoder\n");
-      return 0;
-    }
-
-    netq_t *node = netq_head(&peer->handshake_params->reorder_queue);
-    while (node) {
-      dtls_handshake_header_t *node_header = DTLS_HANDSHAKE_HEADER(node->data);
-      if (dtls_uint16_to_int(node_header->message_seq) == mseq) {
-        dtls_warn("a packet with this sequence number is already stored\n");
-        return 0;
-      }
-      node = netq_next(node);
-    }
-
-    n = netq_node_new(data_length);
-    if (!n) {
-      dtls_warn("no space in reorder buffer\n");
-      return 0;
-    }
-
-    n->peer = peer;
-    n->length = data_length;
-    memcpy(n->data, data, data_length);
-
-    if (!netq_insert_node(&peer->handshake_params->reorder_queue, n)) {
-      dtls_warn("cannot add packet to reorder buffer\n");
-      netq_node_free(n);
-    }
-    dtls_info("Added packet %u for reordering\n", mseq);
-    return 0;
-  } else if (mseq == peer->handshake_params->hs_state.mseq_r) {
-    /* Found the expected packet, use this and all the buffered packet */
-    int next = 1;
-
+  } else if (mseq >= peer->handshake_params->hs_state.mseq_r + DTLS_HANDSHAKE_WINDOW) {
+    dtls_info("message %i is beyond the reassembly window, expected %i\n",
+	      mseq, peer->handshake_params->hs_state.mseq_r);
+    return 0;
+  } else if (mseq == peer->handshake_params->hs_state.mseq_r &&
+             fragment_length == packet_length &&
+             !dtls_reassembly_get(peer, mseq)) {
+    /* Found the expected message, use this and all the buffered messages */
     res = handle_handshake_msg(ctx, peer, data, data_length);
+#ifdef DTLS_ECC
+    if (res == DTLS_CRYPTO_PENDING)
+      return dtls_crypto_job_hold(peer, data, data_length);
+#endif /* DTLS_ECC */
     if (res < 0)
       return res;
 
-    /* We do not know in which order the packet are in the list just search the list for every packet. */
-    while (next && peer->handshake_params) {
-      next = 0;
-      netq_t *node = netq_head(&peer->handshake_params->reorder_queue);
-      while (node) {
-        dtls_handshake_header_t *node_header = DTLS_HANDSHAKE_HEADER(node->data);
-
-        if (dtls_uint16_to_int(node_header->message_seq) == peer->handshake_params->hs_state.mseq_r) {
-          netq_remove(&peer->handshake_params->reorder_queue, node);
-          next = 1;
-          res = handle_handshake_msg(ctx, peer, node->data, node->length);
-
-          /* free message data */
-          netq_node_free(node);
-
-          if (res < 0) {
-            return res;
-          }
+    return handle_reassembly(ctx, peer, res);
+  }
 
-          break;
-        } else {
-          node = netq_next(node);
-        }
-      }
-    }
-    return res;
+  /* A fragment, or a message after one that is missing. */
+  if (mseq > peer->handshake_params->hs_state.mseq_r) {
+    dtls_info("The message sequence number is too larger, expected %i, got: %i\n",
+	      peer->handshake_params->hs_state.mseq_r, mseq);
   }
-  assert(0);
-  return 0;
+  if (dtls_reassembly_add(peer, data, data_length) == 0) {
+    dtls_info("Added fragment %zu+%zu of message %u\n",
+              fragment_offset, fragment_length, mseq);
+  }
+  return handle_reassembly(ctx, peer, 0);
 }
 
 static int
@@ -4460,8 +7161,20 @@ handle_ccs(dtls_context_t *ctx, dtls_peer_t *peer,
   if (data_length != 1 || data[0] != 1)
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
 
-  /* Just change the cipher when we are on the same epoch */
-  if (peer->role == DTLS_SERVER) {
+  if (peer->role == DTLS_CLIENT && peer->handshake_params->session_ticket) {
+    /* The NewSessionTicket sent before is missing, at least one of
+     * its fragments has been lost. The epoch is changed once it is
+     * complete. Our flight has been received, sending it again makes
+     * the server repeat its flight. */
+    dtls_info("ChangeCipherSpec before NewSessionTicket, deferred\n");
+    peer->handshake_params->ccs_deferred = 1;
+    dtls_flight_resend(ctx, peer);
+    return 0;
+  }
+
+  /* Just change the cipher when we are on the same epoch. The key
+   * block of an abbreviated handshake is derived with the ServerHello. */
+  if (peer->role == DTLS_SERVER && !peer->handshake_params->resumed) {
     err = calculate_key_block(ctx, peer->handshake_params, peer,
 			      &peer->session, peer->role);
     if (err < 0) {
@@ -4503,13 +7216,15 @@ handle_alert(dtls_context_t *ctx, dtls_peer_t *peer,
    * used by peer is released.
    */
   close_notify = data[1] == DTLS_ALERT_CLOSE_NOTIFY;
+  if (data[0] == DTLS_ALERT_LEVEL_FATAL)
+    dtls_session_cache_remove(ctx, peer);
   if (data[0] == DTLS_ALERT_LEVEL_FATAL || close_notify) {
     if (close_notify)
       dtls_info("invalidate peer (Close Notify)\n");
     else
       dtls_alert("%d invalidate peer\n", data[1]);
 
-    DEL_PEER(ctx->peers, peer);
+    dtls_del_peer(ctx, peer);
 
 #ifdef WITH_CONTIKI
 #ifndef NDEBUG
@@ -4550,27 +7265,198 @@ static int dtls_alert_send_from_err(dtls_context_t *ctx, dtls_peer_t *peer, int
   if (dtls_is_alert(err)) {
     dtls_alert_level_t level = ((-err) & 0xff00) >> 8;
     dtls_alert_t desc = (-err) & 0xff;
+    if (level == DTLS_ALERT_LEVEL_FATAL)
+      dtls_session_cache_remove(ctx, peer);
     peer->state = DTLS_STATE_CLOSING;
     return dtls_send_alert(ctx, peer, level, desc);
   } else if (err == -1) {
+    dtls_session_cache_remove(ctx, peer);
     peer->state = DTLS_STATE_CLOSING;
     return dtls_send_alert(ctx, peer, DTLS_ALERT_LEVEL_FATAL, DTLS_ALERT_INTERNAL_ERROR);
   }
   return -1;
 }
 
+/**
+ * Buffers a record of @p peer that has overtaken the ChangeCipherSpec
+ * of the handshake, so that it is handled once the next epoch has been
+ * installed.
+ */
+static void
+dtls_defer_next_epoch_record(dtls_peer_t *peer, uint8 *msg, size_t msglen) {
+  netq_t *n;
+  int count;
+
+  LL_COUNT(peer->handshake_params->next_epoch_records, n, count);
+  if (count >= DTLS_NEXT_EPOCH_RECORDS_MAX || msglen > DTLS_MAX_BUF ||
+      !(n = netq_node_new(dtls_mem_owner(peer), msglen))) {
+    dtls_info("drop record of the next epoch\n");
+    return;
+  }
+
+  n->peer = peer;
+  n->length = msglen;
+  memcpy(n->data, msg, msglen);
+  LL_APPEND(peer->handshake_params->next_epoch_records, n);
+}
+
+static int handle_message(dtls_context_t *ctx, session_t *session,
+                          const dtls_session_key_t *key, uint32_t hash,
+                          uint8 *msg, int msglen);
+
+/**
+ * Buffers the application data of @p peer that has overtaken the
+ * Finished message, which may come from a client in False Start, so
+ * that it is read once the handshake is complete.
+ */
+static void
+dtls_defer_early_data(dtls_peer_t *peer, const uint8 *data, size_t length) {
+  netq_t *n;
+  int count;
+
+  LL_COUNT(peer->handshake_params->early_data, n, count);
+  if (count >= DTLS_EARLY_DATA_RECORDS_MAX || length > DTLS_MAX_BUF ||
+      !(n = netq_node_new(dtls_mem_owner(peer), length))) {
+    dtls_info("** drop application data before Finish.\n");
+    return;
+  }
+
+  n->peer = peer;
+  n->length = length;
+  memcpy(n->data, data, length);
+  LL_APPEND(peer->handshake_params->early_data, n);
+}
+
+/**
+ * Reads the application data @p records, which the peer with @p key
+ * has sent before its handshake completed, and releases them.
+ */
+static void
+dtls_read_early_data(dtls_context_t *ctx,
+                     const dtls_session_key_t *key, uint32_t hash,
+                     netq_t *records) {
+  dtls_peer_t *peer;
+  netq_t *node;
+
+  while ((node = records)) {
+    records = node->next;
+    /* the peer may be removed by each callback */
+    peer = dtls_find_peer(ctx, key, hash);
+    if (peer && peer->state == DTLS_STATE_CONNECTED)
+      CALL(ctx, read, &peer->session, node->data, node->length);
+    netq_node_free(node);
+  }
+}
+
+#if DTLS_CID_LENGTH > 0
+/**
+ * Returns the peer that has been given the connection id of the
+ * tls12_cid record @p msg of @p rlen bytes, received from @p session
+ * with the session key @p key and its hash value @p hash. A peer known
+ * by another address is moved to @p session, if the record is
+ * authentic and newer than the records received before (RFC 9146,
+ * section 6). Otherwise, @c NULL is returned.
+ */
+static dtls_peer_t *
+dtls_get_cid_peer(dtls_context_t *ctx, session_t *session,
+                  const dtls_session_key_t *key, uint32_t hash,
+                  uint8 *msg, unsigned int rlen) {
+#ifdef DTLS_CONSTRAINED_STACK
+  uint8 *buf = ctx->sendbuf;
+#else /* ! DTLS_CONSTRAINED_STACK */
+  uint8 buf[DTLS_MAX_BUF];
+#endif /* ! DTLS_CONSTRAINED_STACK */
+  const uint8 *cid = msg + DTLS_RH_LENGTH - sizeof(uint16);
+  dtls_security_parameters_t *security;
+  dtls_peer_t *peer;
+  uint32_t peer_hash = 0;
+  uint8 *data;
+  int other_address = 0, moved = 0;
+
+  dtls_peers_rdlock(ctx);
+  FIND_CID_PEER(ctx, cid, peer);
+  if (peer && memcmp(&peer->key, key, sizeof(dtls_session_key_t)) != 0) {
+    peer_hash = dtls_session_key_hash(&peer->key);
+    other_address = 1;
+  }
+  dtls_peers_unlock(ctx);
+  if (!other_address)
+    return peer;
+
+  /* The peer is protected by the session lock of its old address,
+   * the caller holds that of the new one. While both are taken, the
+   * lock of the new address may be released for a moment. Another
+   * peer added for it meanwhile makes dtls_move_peer() fail. */
+  dtls_session_lock_other(ctx, hash, peer_hash);
+  dtls_peers_rdlock(ctx);
+  FIND_CID_PEER(ctx, cid, peer);
+  if (peer && dtls_session_key_hash(&peer->key) != peer_hash)
+    peer = NULL;
+  dtls_peers_unlock(ctx);
+
+  security = peer ? dtls_security_params_read_epoch(peer,
+                      dtls_get_epoch(DTLS_RECORD_HEADER(msg))) : NULL;
+  if (security && rlen <= DTLS_MAX_BUF &&
+      (security->cseq.bitfield == 0 ||
+       dtls_uint48_to_int(DTLS_RECORD_HEADER(msg)->sequence_number) >
+       security->cseq.cseq)) {
+    /* authenticate a copy, the record is handled by the caller */
+    memcpy(buf, msg, rlen);
+    moved = decrypt_verify(peer, buf, rlen, &data) >= 0 &&
+      dtls_move_peer(ctx, peer, session, key, hash) == 0;
+  }
+  dtls_session_unlock_other(ctx, hash, peer_hash);
+
+  if (!moved) {
+    dtls_info("record with connection id from new address, drop it\n");
+    return NULL;
+  }
+  dtls_dsrv_log_addr(DTLS_LOG_INFO, "peer moved to", session);
+  CALL(ctx, event, &peer->session, 0, DTLS_EVENT_ADDRESS_CHANGED);
+  /* the peer may have been removed by the callback */
+  return dtls_find_peer(ctx, key, hash);
+}
+#endif /* DTLS_CID_LENGTH > 0 */
+
+/**
+ * Handles the records of @p peer that have overtaken the
+ * ChangeCipherSpec, after the next epoch has been installed.
+ */
+static void
+dtls_handle_next_epoch_records(dtls_context_t *ctx, dtls_peer_t *peer,
+                               session_t *session,
+                               const dtls_session_key_t *key, uint32_t hash) {
+  netq_t *records, *node;
+
+  if (!peer->handshake_params || !peer->handshake_params->next_epoch_records)
+    return;
+
+  /* The records are detached, as the peer may be removed or complete
+   * its handshake with each of them. */
+  records = peer->handshake_params->next_epoch_records;
+  peer->handshake_params->next_epoch_records = NULL;
+  while ((node = records)) {
+    records = node->next;
+    handle_message(ctx, session, key, hash, node->data, node->length);
+    netq_node_free(node);
+  }
+}
+
 /**
  * Handles incoming data as DTLS message from given peer.
  */
-int
-dtls_handle_message(dtls_context_t *ctx,
-		    session_t *session,
-		    uint8 *msg, int msglen) {
+static int
+handle_message(dtls_context_t *ctx,
+	       session_t *session,
+	       const dtls_session_key_t *key, uint32_t hash,
+	       uint8 *msg, int msglen) {
   dtls_peer_t *peer = NULL;
   unsigned int rlen;		/* record length */
   uint8 *data = NULL;		/* (decrypted) payload */
   int data_length;		/* length of decrypted payload
 				   (without MAC and padding) */
+  netq_t *early_data;		/* see dtls_defer_early_data() */
+  dtls_state_t state;
   int err;
 
   /* check for ClientHellos of epoch 0, maybe a peer's start over */
@@ -4638,7 +7524,14 @@ dtls_handle_message(dtls_context_t *ctx,
     }
 
     /* check if we have DTLS state for addr/port/ifindex */
-    peer = dtls_get_peer(ctx, session);
+#if DTLS_CID_LENGTH > 0
+    if (content_type == DTLS_CT_TLS12_CID)
+      /* the records of epoch 0 are never sent with a connection id */
+      peer = epoch > 0 ?
+        dtls_get_cid_peer(ctx, session, key, hash, msg, rlen) : NULL;
+    else
+#endif /* DTLS_CID_LENGTH > 0 */
+    peer = dtls_find_peer(ctx, key, hash);
     if (peer) {
         dtls_debug("dtls_handle_message: FOUND PEER\n");
     } else {
@@ -4652,7 +7545,25 @@ dtls_handle_message(dtls_context_t *ctx,
       return 0;
     }
 
+#ifdef DTLS_ECC
+    if (is_crypto_job_pending(peer)) {
+      /* handled by dtls_crypto_job_complete() */
+      dtls_crypto_job_defer_record(peer, msg, rlen);
+      msg += rlen;
+      msglen -= rlen;
+      continue;
+    }
+#endif /* DTLS_ECC */
+
     dtls_security_parameters_t *security = dtls_security_params_read_epoch(peer, epoch);
+    if (!security && peer->handshake_params &&
+        epoch == peer->handshake_params->hs_state.read_epoch + 1) {
+      dtls_info("record of epoch %u before ChangeCipherSpec\n", epoch);
+      dtls_defer_next_epoch_record(peer, msg, rlen);
+      msg += rlen;
+      msglen -= rlen;
+      continue;
+    }
     if (!security) {
       if (content_type_name) {
         dtls_warn("No security context for epoch: %i (%s)\n", epoch, content_type_name);
@@ -4714,8 +7625,29 @@ dtls_handle_message(dtls_context_t *ctx,
       }
     }
     if (data_length < 0) {
-      dtls_info("decrypt_verify() failed, drop message.\n");
-      return 0;
+      /* only this record is dropped, the datagram may carry
+       * further records of a flight */
+      dtls_info("decrypt_verify() failed, drop record.\n");
+      msg += rlen;
+      msglen -= rlen;
+      continue;
+    }
+#if DTLS_CID_LENGTH > 0
+    if (content_type == DTLS_CT_TLS12_CID) {
+      /* DTLSInnerPlaintext: the content, its real type, and padding */
+      while (data_length > 0 && data[data_length - 1] == 0)
+        data_length--;
+      if (data_length == 0) {
+        dtls_info("tls12_cid record without content type, drop record.\n");
+        msg += rlen;
+        msglen -= rlen;
+        continue;
+      }
+      content_type = data[--data_length];
+    }
+#endif /* DTLS_CID_LENGTH > 0 */
+    if (epoch > 0) {
+      dtls_touch_peer(ctx, peer);
     }
 
     dtls_debug_hexdump("receive header", msg, sizeof(dtls_record_header_t));
@@ -4741,6 +7673,7 @@ dtls_handle_message(dtls_context_t *ctx,
 
         return err;
       }
+      dtls_handle_next_epoch_records(ctx, peer, session, key, hash);
       break;
 
     case DTLS_CT_ALERT:
@@ -4770,9 +7703,16 @@ dtls_handle_message(dtls_context_t *ctx,
       break;
 
     case DTLS_CT_HANDSHAKE:
-
+      state = peer->state;
+      /* the early data would be released with the handshake parameters */
+      early_data = NULL;
+      if (state == DTLS_STATE_WAIT_FINISHED && peer->handshake_params) {
+        early_data = peer->handshake_params->early_data;
+        peer->handshake_params->early_data = NULL;
+      }
       err = handle_handshake(ctx, peer, data, data_length);
       if (err < 0) {
+        netq_delete_all(&early_data);
         dtls_warn("error 0x%04x handling handshake packet of type: %s (%i),"
                   " state %d\n", -err, dtls_handshake_type_to_name(data[0]),
                   data[0], peer->state);
@@ -4787,20 +7727,49 @@ dtls_handle_message(dtls_context_t *ctx,
         }
         return err;
       }
-      if (peer && peer->state == DTLS_STATE_CONNECTED) {
-	/* stop retransmissions */
-	dtls_stop_retransmission(ctx, peer);
+      if (early_data && peer->state != DTLS_STATE_CONNECTED) {
+        /* still waiting for the Finished */
+        if (peer->handshake_params)
+          peer->handshake_params->early_data = early_data;
+        else
+          netq_delete_all(&early_data);
+        early_data = NULL;
+      }
+      if (peer && state != DTLS_STATE_CONNECTED &&
+          peer->state == DTLS_STATE_CONNECTED) {
+	/* keep our last flight in case the peer has not received it */
+	dtls_flight_hold(ctx, peer);
+	dtls_touch_peer(ctx, peer);
+	if (peer->role == DTLS_SERVER)
+	  dtls_validate_address(ctx, &peer->session);
 	CALL(ctx, event, &peer->session, 0, DTLS_EVENT_CONNECTED);
+	dtls_read_early_data(ctx, key, hash, early_data);
+      } else if (peer && state == DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+                 peer->state == DTLS_STATE_WAIT_FINISHED) {
+        /* a deferred ChangeCipherSpec has been applied */
+        dtls_handle_next_epoch_records(ctx, peer, session, key, hash);
+      } else if (peer && state != DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+                 peer->state == DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+                 peer->handshake_params->false_start) {
+	CALL(ctx, event, &peer->session, 0, DTLS_EVENT_FALSE_START);
       }
       break;
 
     case DTLS_CT_APPLICATION_DATA:
-      if (epoch == 0 || peer->state == DTLS_STATE_WAIT_FINISHED) {
+      if (epoch == 0) {
           dtls_info("** drop application data before Finish.\n");
           return 0;
       }
+      if (peer->state == DTLS_STATE_WAIT_FINISHED) {
+        dtls_defer_early_data(peer, data, data_length);
+        break;
+      }
       dtls_info("** application data:\n");
-      dtls_stop_retransmission(ctx, peer);
+      /* A client in False Start sends data before it has received our
+       * Finished, which is then kept until it expires. */
+      if (peer->role == DTLS_CLIENT ||
+          !is_key_exchange_ecdhe_ecdsa(dtls_security_params(peer)->cipher_index))
+        dtls_flight_acked(ctx, peer);
       CALL(ctx, read, &peer->session, data, data_length);
       break;
     default:
@@ -4815,6 +7784,124 @@ dtls_handle_message(dtls_context_t *ctx,
   return 0;
 }
 
+int
+dtls_handle_message(dtls_context_t *ctx,
+		    session_t *session,
+		    uint8 *msg, int msglen) {
+  dtls_session_key_t key;
+  dtls_peer_t *peer;
+  uint32_t hash;
+  int res;
+
+  /* the key is computed once per datagram, not per record */
+  dtls_session_key(session, &key);
+  hash = dtls_session_key_hash(&key);
+
+  dtls_session_lock_hash(ctx, hash);
+  res = handle_message(ctx, session, &key, hash, msg, msglen);
+  /* the records of the flight sent in response share their datagrams */
+  peer = dtls_find_peer(ctx, &key, hash);
+  if (peer)
+    dtls_flight_flush(ctx, peer);
+  dtls_session_unlock_hash(ctx, hash);
+  return res;
+}
+
+#ifdef DTLS_ECC
+static int
+crypto_job_complete(dtls_context_t *ctx, dtls_crypto_job_t *job) {
+  dtls_peer_t *peer;
+  netq_t *node, *deferred;
+  session_t session;
+  dtls_session_key_t key;
+  uint32_t hash;
+  dtls_state_t state;
+  int err;
+
+  peer = dtls_get_peer(ctx, &job->session);
+  if (!peer || !peer->handshake_params ||
+      peer->handshake_params->crypto_job != job) {
+    dtls_debug("discard crypto job, peer has been removed\n");
+    dtls_crypto_job_free(job);
+    return 0;
+  }
+
+  dtls_debug("completed crypto job %d\n", job->type);
+  job->state = DTLS_CRYPTO_JOB_DONE;
+
+  /* the deferred records would be released with the handshake
+   * parameters when the handshake completes */
+  deferred = peer->handshake_params->deferred_records;
+  peer->handshake_params->deferred_records = NULL;
+
+  state = peer->state;
+  err = handle_reassembly(ctx, peer, 0);
+  if (err < 0) {
+    netq_delete_all(&deferred);
+    dtls_warn("error 0x%04x resuming handshake, state %d\n", -err, peer->state);
+    dtls_alert_send_from_err(ctx, peer, err);
+
+    if (DTLS_ALERT_LEVEL_FATAL == ((-err) & 0xff00) >> 8) {
+      /* invalidate peer */
+      peer->state = DTLS_STATE_CLOSED;
+      dtls_stop_retransmission(ctx, peer);
+      dtls_destroy_peer(ctx, peer, DTLS_DESTROY_CLOSE);
+    }
+    return err;
+  }
+  if (peer->state == DTLS_STATE_CONNECTED) {
+    dtls_flight_hold(ctx, peer);
+    dtls_touch_peer(ctx, peer);
+    CALL(ctx, event, &peer->session, 0, DTLS_EVENT_CONNECTED);
+  } else if (state != DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+             peer->state == DTLS_STATE_WAIT_CHANGECIPHERSPEC &&
+             peer->handshake_params->false_start) {
+    CALL(ctx, event, &peer->session, 0, DTLS_EVENT_FALSE_START);
+  }
+
+  /* Handle the records received in the meantime. The peer may be
+   * removed by each of them. */
+  memcpy(&session, &peer->session, sizeof(session_t));
+  memcpy(&key, &peer->key, sizeof(dtls_session_key_t));
+  hash = dtls_session_key_hash(&key);
+  while ((peer = dtls_find_peer(ctx, &key, hash)) &&
+	 !is_crypto_job_pending(peer) &&
+	 (node = netq_pop_first(&deferred))) {
+    handle_message(ctx, &session, &key, hash, node->data, node->length);
+    netq_node_free(node);
+  }
+
+  if (deferred && peer && is_crypto_job_pending(peer)) {
+    /* another job has been started, the remaining records go first */
+    LL_CONCAT(deferred, peer->handshake_params->deferred_records);
+    peer->handshake_params->deferred_records = deferred;
+    deferred = NULL;
+  }
+  netq_delete_all(&deferred);
+
+  return 0;
+}
+
+int
+dtls_crypto_job_complete(dtls_context_t *ctx, dtls_crypto_job_t *job) {
+  session_t session;
+  dtls_peer_t *peer;
+  int res;
+
+  assert(job);
+
+  /* the job may be released while being completed */
+  memcpy(&session, &job->session, sizeof(session_t));
+  dtls_session_lock(ctx, &session);
+  res = crypto_job_complete(ctx, job);
+  peer = dtls_get_peer(ctx, &session);
+  if (peer)
+    dtls_flight_flush(ctx, peer);
+  dtls_session_unlock(ctx, &session);
+  return res;
+}
+#endif /* DTLS_ECC */
+
 dtls_context_t *
 dtls_new_context(void *app_data) {
   dtls_context_t *c;
@@ -4829,6 +7916,36 @@ dtls_new_context(void *app_data) {
 
   memset(c, 0, sizeof(dtls_context_t));
   c->app = app_data;
+  c->limits.max_peers = DTLS_PEERS_LIMIT;
+  c->limits.max_handshakes = DTLS_HANDSHAKES_LIMIT;
+  c->limits.evict_idle = DTLS_PEER_EVICT_IDLE;
+  c->limits.evict_close_notify = 1;
+  c->limits.reject = DTLS_REJECT_DROP;
+  c->limits.idle_timeout = DTLS_PEER_IDLE_TIMEOUT;
+  c->limits.handshake_timeout = DTLS_HANDSHAKE_TIMEOUT;
+  netq_wheel_init(&c->sendqueue, now);
+  c->mtu = DTLS_DEFAULT_MTU;
+  c->session_lifetime = DTLS_SESSION_LIFETIME;
+  c->rto.initial = DTLS_RTO_INITIAL;
+  c->rto.min = DTLS_RTO_MIN;
+  c->rto.max = DTLS_RTO_MAX;
+  c->rto.jitter = DTLS_RTO_JITTER;
+  c->pacing.bytes_per_second = DTLS_RETRANSMIT_BYTES_PER_SECOND;
+  c->pacing.datagrams_per_second = DTLS_RETRANSMIT_DATAGRAMS_PER_SECOND;
+  c->pacing_bytes = (int64_t)c->pacing.bytes_per_second * DTLS_TICKS_PER_SECOND;
+  c->pacing_datagrams = (int64_t)c->pacing.datagrams_per_second * DTLS_TICKS_PER_SECOND;
+  c->pacing_time = now;
+
+#ifdef DTLS_CONCURRENT_PEERS
+  if (init_context_locks(c) < 0)
+    goto error;
+#endif /* DTLS_CONCURRENT_PEERS */
+
+#if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
+  c->mem = dtls_mem_new();
+  if (!c->mem)
+    goto error;
+#endif /* ! WITH_CONTIKI && ! RIOT_VERSION */
 
 #ifdef WITH_CONTIKI
   process_start(&dtls_retransmit_process, (char *)c);
@@ -4843,6 +7960,10 @@ dtls_new_context(void *app_data) {
   else
     goto error;
 
+  if (!dtls_prng((unsigned char *)&c->jitter_state, sizeof(c->jitter_state)))
+    goto error;
+  c->jitter_state |= 1;         /* xorshift must not start at zero */
+
   return c;
 
  error:
@@ -4854,17 +7975,35 @@ dtls_new_context(void *app_data) {
 
 void dtls_reset_peer(dtls_context_t *ctx, dtls_peer_t *peer)
 {
+  session_t session;
+
+  memcpy(&session, &peer->session, sizeof(session_t));
+  dtls_session_lock(ctx, &session);
   dtls_destroy_peer(ctx, peer, DTLS_DESTROY_CLOSE);
+  dtls_session_unlock(ctx, &session);
 }
 
 void
 dtls_free_context(dtls_context_t *ctx) {
-  dtls_peer_t *p, *tmp;
+  dtls_peer_t *p;
+#ifndef DTLS_PEERS_OPENHASH
+  dtls_peer_t *tmp;
+#endif /* ! DTLS_PEERS_OPENHASH */
 
   if (!ctx) {
     return;
   }
 
+#ifdef DTLS_PEERS_OPENHASH
+  {
+    size_t pos = 0;
+
+    while ((p = dtls_peer_table_next(&ctx->peers, &pos))) {
+      dtls_destroy_peer(ctx, p, DTLS_DESTROY_CLOSE);
+    }
+    dtls_peer_table_free(&ctx->peers);
+  }
+#else /* ! DTLS_PEERS_OPENHASH */
   if (ctx->peers) {
 #ifdef DTLS_PEERS_NOHASH
     LL_FOREACH_SAFE(ctx->peers, p, tmp) {
@@ -4874,20 +8013,47 @@ dtls_free_context(dtls_context_t *ctx) {
       dtls_destroy_peer(ctx, p, DTLS_DESTROY_CLOSE);
     }
   }
-
+#endif /* ! DTLS_PEERS_OPENHASH */
+
+#if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
+  netq_wheel_delete_all(&ctx->sendqueue);
+  dtls_mem_free(ctx->mem);
+#endif /* ! WITH_CONTIKI && ! RIOT_VERSION */
+#ifdef DTLS_CONCURRENT_PEERS
+  free_context_locks(ctx);
+#endif /* DTLS_CONCURRENT_PEERS */
+#if DTLS_SESSION_CACHE_SIZE > 0
+  /* do not leave the master secrets behind */
+  memset(ctx->sessions, 0, sizeof(ctx->sessions));
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  memset(ctx->ticket_keys, 0, sizeof(ctx->ticket_keys));
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
   free_context(ctx);
 }
 
+#if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
 int
-dtls_connect_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
+dtls_set_allocator(dtls_context_t *ctx, const dtls_allocator_t *allocator) {
+  return dtls_mem_set_allocator(ctx->mem, allocator);
+}
+
+int
+dtls_reserve(dtls_context_t *ctx, dtls_pool_type_t type, size_t count) {
+  return dtls_mem_reserve(ctx->mem, type, count);
+}
+#endif /* ! WITH_CONTIKI && ! RIOT_VERSION */
+
+static int
+connect_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
   int res;
   dtls_peer_t* previous_peer;
 
-  assert(peer);
-  if (!peer)
-    return -1;
-
   previous_peer = dtls_get_peer(ctx, &peer->session);
+  if (previous_peer == peer) {
+    dtls_warn("peer is already connected\n");
+    return -1;
+  }
   /* check if the same peer is already in our list */
   if (previous_peer) {
     if (previous_peer->role == DTLS_SERVER) {
@@ -4908,18 +8074,39 @@ dtls_connect_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
   }
 
   /* send ClientHello with empty Cookie */
-  peer->handshake_params = dtls_handshake_new();
+  peer->handshake_params = dtls_handshake_new(ctx->mem);
       if (!peer->handshake_params)
         return -1;
 
   peer->handshake_params->hs_state.mseq_r = 0;
   peer->handshake_params->hs_state.mseq_s = 0;
   res = dtls_send_client_hello(ctx, peer, NULL, 0);
-  if (res < 0)
+  if (res < 0) {
     dtls_warn("cannot send ClientHello\n");
-  else
+  } else {
+    dtls_flight_flush(ctx, peer);
     peer->state = DTLS_STATE_CLIENTHELLO;
+  }
+
+  return res;
+}
+
+int
+dtls_connect_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
+  session_t session;
+  int res;
+
+  assert(peer);
+  if (!peer)
+    return -1;
 
+  memcpy(&session, &peer->session, sizeof(session_t));
+  dtls_session_lock(ctx, &session);
+  if (dtls_get_peer(ctx, &session) || dtls_admit_peer(ctx) == 0)
+    res = connect_peer(ctx, peer);
+  else
+    res = -1;
+  dtls_session_unlock(ctx, &session);
   return res;
 }
 
@@ -4928,129 +8115,245 @@ dtls_connect(dtls_context_t *ctx, const session_t *dst) {
   dtls_peer_t *peer;
   int res;
 
-  peer = dtls_get_peer(ctx, dst);
+  dtls_session_lock(ctx, dst);
 
-  if (!peer)
-    peer = dtls_new_peer(dst);
+  /* an existing peer is replaced by connect_peer() */
+  peer = NULL;
+  if (dtls_get_peer(ctx, dst) || dtls_admit_peer(ctx) == 0)
+    peer = dtls_alloc_peer(ctx->mem, dst);
 
   if (!peer) {
     dtls_crit("cannot create new peer\n");
-    return -1;
-  }
-
-  res = dtls_connect_peer(ctx, peer);
+    res = -1;
+  } else {
+    res = connect_peer(ctx, peer);
 
-  /* Invoke event callback to indicate connection attempt or
-   * re-negotiation. */
-  if (res > 0) {
-    CALL(ctx, event, &peer->session, 0, DTLS_EVENT_CONNECT);
+    /* Invoke event callback to indicate connection attempt or
+     * re-negotiation. */
+    if (res > 0) {
+      CALL(ctx, event, &peer->session, 0, DTLS_EVENT_CONNECT);
+    }
   }
 
+  dtls_session_unlock(ctx, dst);
   return res;
 }
 
+/**
+ * Sends the records of the flight @p node again and charges them to
+ * the retransmission budget of @p context.
+ */
+static void
+dtls_flight_send(dtls_context_t *context, netq_t *node) {
+  size_t bytes = 0;
+  unsigned int datagrams;
+
+  datagrams = dtls_flight_write(context, node, 0, &bytes);
+
+  /* the budget may become negative, so that a flight is never split */
+  dtls_sendqueue_lock(context);
+  context->pacing_bytes -= (int64_t)bytes * DTLS_TICKS_PER_SECOND;
+  context->pacing_datagrams -= (int64_t)datagrams * DTLS_TICKS_PER_SECOND;
+  dtls_sendqueue_unlock(context);
+}
+
 static void
 dtls_retransmit(dtls_context_t *context, netq_t *node) {
+  dtls_peer_t *peer;
+
   if (!context || !node)
     return;
 
+  peer = node->peer;
+
   /* re-initialize timeout when maximum number of retransmissions are not reached yet */
-  if (node->retransmit_cnt < DTLS_DEFAULT_MAX_RETRANSMIT) {
-#ifndef DTLS_CONSTRAINED_STACK
-      unsigned char sendbuf[DTLS_MAX_BUF];
-#endif /* ! DTLS_CONSTRAINED_STACK */
-      size_t len = sizeof(sendbuf);
-      int err;
-      unsigned char *data = node->data;
-      size_t length = node->length;
+  if (node->job == RESEND && node->retransmit_cnt < DTLS_DEFAULT_MAX_RETRANSMIT) {
       dtls_tick_t now;
-      dtls_security_parameters_t *security = dtls_security_params_epoch(node->peer, node->epoch);
-
-      if (node->job == TIMEOUT) {
-        if (node->type == DTLS_CT_ALERT) {
-          dtls_debug("** alert times out\n");
-          handle_alert(context, node->peer, NULL, data, length);
-        }
-        netq_node_free(node);
-        return;
-      }
-
-#ifdef DTLS_CONSTRAINED_STACK
-      dtls_mutex_lock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
 
       dtls_ticks(&now);
+      dtls_sendqueue_lock(context);
       node->retransmit_cnt++;
-      node->t = now + (node->timeout << node->retransmit_cnt);
-      netq_insert_node(&context->sendqueue, node);
+      node->sent = now;
+      node->t = now + min(node->timeout << node->retransmit_cnt,
+                          DTLS_MS_TO_TICKS(context->rto.max));
+      netq_wheel_remove(&context->sendqueue, node);
+      netq_wheel_insert(&context->sendqueue, node);
+      dtls_sendqueue_unlock(context);
+
+      dtls_flight_send(context, node);
+      return;
+  }
 
-      if (node->type == DTLS_CT_HANDSHAKE) {
-        dtls_handshake_header_t *hs_header = DTLS_HANDSHAKE_HEADER(data);
-        dtls_debug("** retransmit handshake packet of type: %s (%i)\n",
-                   dtls_handshake_type_to_name(hs_header->msg_type),
-                   hs_header->msg_type);
-      } else {
-        dtls_debug("** retransmit packet\n");
-      }
+  dtls_sendqueue_lock(context);
+  peer->retransmit = NULL;
+  dtls_sendqueue_unlock(context);
 
-      err = dtls_prepare_record(node->peer, security, node->type, &data, &length,
-                1, sendbuf, &len);
-      if (err < 0) {
-        dtls_warn("can not retransmit packet, err: %i\n", err);
-        goto return_unlock;
-      }
-      dtls_debug_hexdump("retransmit header", sendbuf, sizeof(dtls_record_header_t));
-      dtls_debug_hexdump("retransmit unencrypted", node->data, node->length);
+  if (node->job == TIMEOUT) {
+    if (node->type == DTLS_CT_ALERT) {
+      dtls_debug("** alert times out\n");
+      handle_alert(context, peer, NULL, node->data, node->length);
+    }
+  } else {
+    /* no more retransmissions, remove flight from system */
+    dtls_debug("** removed transaction\n");
+  }
 
-      (void)CALL(context, write, &node->peer->session, sendbuf, len);
-return_unlock:
-#ifdef DTLS_CONSTRAINED_STACK
-      dtls_mutex_unlock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
+  /* And finally delete the node */
+  netq_flight_free(node);
+}
 
-      return;
+/**
+ * Retransmits the flight of @p peer at once when the peer has sent
+ * its previous flight again, as ours was probably lost (RFC 6347,
+ * section 4.2.4). Within one round-trip time of the last transmission
+ * the peer's flight may have crossed ours, so it is ignored then.
+ */
+static void
+dtls_flight_resend(dtls_context_t *ctx, dtls_peer_t *peer) {
+  netq_t *flight;
+  dtls_tick_t now, rtt;
+  int resend;
+
+  dtls_ticks(&now);
+  dtls_sendqueue_lock(ctx);
+  flight = peer->retransmit;
+  rtt = peer->srtt ? peer->srtt : ctx->srtt;
+  resend = flight &&
+    ((flight->job == RESEND &&
+      flight->retransmit_cnt < DTLS_DEFAULT_MAX_RETRANSMIT) ||
+     flight->job == FINISHED) &&
+    now - flight->sent >= rtt && dtls_pacing_allows(ctx, now);
+  if (resend)
+    flight->sent = now;
+  dtls_sendqueue_unlock(ctx);
+
+  if (!resend)
+    return;
+
+  dtls_debug("peer sent its flight again, resend ours\n");
+  if (flight->job == RESEND) {
+    /* counts as retransmission, also for the backoff */
+    dtls_retransmit(ctx, flight);
+  } else {
+    dtls_flight_send(ctx, flight);
   }
+}
+
+/**
+ * Keeps the last flight of a handshake after it has completed, so
+ * that it can be sent again if the peer has not received it. The
+ * flight is not retransmitted on timeout and removed after rto.max,
+ * or when the peer's application data arrives.
+ */
+static void
+dtls_flight_hold(dtls_context_t *ctx, dtls_peer_t *peer) {
+  netq_t *flight;
+  dtls_tick_t now;
 
-  /* no more retransmissions, remove node from system */
+  dtls_ticks(&now);
+  dtls_sendqueue_lock(ctx);
+  flight = peer->retransmit;
+  if (flight && flight->job == RESEND) {
+    flight->job = FINISHED;
+    flight->t = now + DTLS_MS_TO_TICKS(ctx->rto.max);
+    netq_wheel_remove(&ctx->sendqueue, flight);
+    netq_wheel_insert(&ctx->sendqueue, flight);
+  }
+  dtls_sendqueue_unlock(ctx);
+}
+
+static void
+dtls_flight_acked(dtls_context_t *ctx, dtls_peer_t *peer) {
+  netq_t *flight;
+  dtls_tick_t now;
 
-  dtls_debug("** removed transaction\n");
+  dtls_ticks(&now);
+  dtls_sendqueue_lock(ctx);
+  flight = peer->retransmit;
+  /* a retransmitted flight gives no valid sample (Karn's algorithm) */
+  if (flight && flight->job == RESEND && flight->retransmit_cnt == 0) {
+    dtls_tick_t r = max(now - flight->sent, 1);
 
-  /* And finally delete the node */
-  netq_node_free(node);
+    dtls_rtt_update(&peer->srtt, &peer->rttvar, r);
+    dtls_rtt_update(&ctx->srtt, &ctx->rttvar, r);
+    dtls_debug("flight round-trip time %u ms, smoothed %u ms\n",
+               DTLS_TICKS_TO_MS(r), DTLS_TICKS_TO_MS(peer->srtt));
+  }
+  dtls_sendqueue_unlock(ctx);
+
+  dtls_stop_retransmission(ctx, peer);
 }
 
 static void
 dtls_stop_retransmission(dtls_context_t *context, dtls_peer_t *peer) {
   netq_t *node;
-  node = netq_head(&context->sendqueue);
-
-  while (node) {
-    if (dtls_session_equals(&node->peer->session, &peer->session)) {
-      netq_t *tmp = node;
-      node = netq_next(node);
-      netq_remove(&context->sendqueue, tmp);
-      netq_node_free(tmp);
-    } else
-      node = netq_next(node);
-  }
+
+  dtls_sendqueue_lock(context);
+  node = peer->retransmit;
+  peer->retransmit = NULL;
+  if (node)
+    netq_wheel_remove(&context->sendqueue, node);
+  dtls_sendqueue_unlock(context);
+
+  netq_flight_free(node);
 }
 
 void
 dtls_check_retransmit(dtls_context_t *context, clock_time_t *next) {
-  dtls_tick_t now;
-  netq_t *node = netq_head(&context->sendqueue);
+  dtls_tick_t now, deadline = 0, hs_deadline = 0, t;
+  int expires, paced;
+  netq_t *node;
 
   dtls_ticks(&now);
-  /* comparison considering 32bit overflow */
-  while (node && DTLS_IS_BEFORE_TIME(node->t, now)) {
-    netq_pop_first(&context->sendqueue);
+  expires = dtls_expire_list(context, 1, now, &deadline);
+  if (dtls_expire_list(context, 0, now, &hs_deadline) &&
+      (!expires || DTLS_IS_BEFORE_TIME(hs_deadline, deadline))) {
+    deadline = hs_deadline;
+    expires = 1;
+  }
+
+  dtls_sendqueue_lock(context);
+  /* due flights beyond the budget stay in the wheel */
+  while ((paced = !dtls_pacing_allows(context, now)) == 0 &&
+         (node = netq_wheel_peek(&context->sendqueue, now))) {
+#ifdef DTLS_CONCURRENT_PEERS
+    {
+      /* The peer of a queued flight is only valid with its session
+       * lock held. A flight is therefore taken only after the lock of
+       * the session copied into it has been acquired, and only if a
+       * due flight of that session is still first. Unlike a
+       * comparison of peer pointers, this cannot confuse a removed
+       * peer with a new one that was allocated at the same address. */
+      session_t session = node->session;
+
+      dtls_sendqueue_unlock(context);
+      dtls_session_lock(context, &session);
+      dtls_sendqueue_lock(context);
+      node = netq_wheel_peek(&context->sendqueue, now);
+      if (node && dtls_session_equals(&node->session, &session)) {
+        netq_wheel_remove(&context->sendqueue, node);
+        dtls_sendqueue_unlock(context);
+        dtls_retransmit(context, node);
+        dtls_sendqueue_lock(context);
+      }
+      dtls_session_unlock(context, &session);
+    }
+#else /* ! DTLS_CONCURRENT_PEERS */
+    netq_wheel_remove(&context->sendqueue, node);
     dtls_retransmit(context, node);
-    node = netq_head(&context->sendqueue);
+#endif /* ! DTLS_CONCURRENT_PEERS */
   }
 
   if (next) {
-    *next = node ? node->t : 0;
+    if (!netq_wheel_next(&context->sendqueue, &t)) {
+      *next = expires ? deadline : 0;
+    } else {
+      if (paced && DTLS_IS_BEFORE_TIME(t, now))
+        t = dtls_pacing_resume(context, now);
+      *next = expires && DTLS_IS_BEFORE_TIME(deadline, t) ? deadline : t;
+    }
   }
+  dtls_sendqueue_unlock(context);
 }
 
 #ifdef WITH_CONTIKI
@@ -5059,7 +8362,7 @@ dtls_check_retransmit(dtls_context_t *context, clock_time_t *next) {
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(dtls_retransmit_process, ev, data)
 {
-  clock_time_t now;
+  clock_time_t now, next;
   netq_t *node;
 
   PROCESS_BEGIN();
@@ -5071,19 +8374,19 @@ PROCESS_THREAD(dtls_retransmit_process, ev, data)
     if (ev == PROCESS_EVENT_TIMER) {
       if (etimer_expired(&the_dtls_context.retransmit_timer)) {
 
-	node = netq_head(&the_dtls_context.sendqueue);
-
 	now = clock_time();
-	if (node && node->t <= now) {
-	  netq_pop_first(&the_dtls_context.sendqueue);
+	node = dtls_pacing_allows(&the_dtls_context, now) ?
+	  netq_wheel_pop(&the_dtls_context.sendqueue, now) : NULL;
+	if (node) {
 	  dtls_retransmit(&the_dtls_context, node);
-	  node = netq_head(&the_dtls_context.sendqueue);
 	}
 
 	/* need to set timer to some value even if no nextpdu is available */
-	if (node) {
+	if (netq_wheel_next(&the_dtls_context.sendqueue, &next)) {
+	  if (next <= now && !dtls_pacing_allows(&the_dtls_context, now))
+	    next = dtls_pacing_resume(&the_dtls_context, now);
 	  etimer_set(&the_dtls_context.retransmit_timer,
-		     node->t <= now ? 1 : node->t - now);
+		     next <= now ? 1 : next - now);
 	} else {
 	  etimer_set(&the_dtls_context.retransmit_timer, 0xFFFF);
 	}
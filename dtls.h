@@ -35,7 +35,9 @@
 
 #include "alert.h"
 #include "crypto.h"
+#include "dtls_alloc.h"
 #include "hmac.h"
+#include "netq.h"
 
 #include "global.h"
 #include "dtls_time.h"
@@ -218,26 +220,227 @@ typedef struct {
 			  const unsigned char *other_pub_x,
 			  const unsigned char *other_pub_y,
 			  size_t key_size);
+
+  /**
+   * Called to hand an expensive cryptographic operation of a
+   * handshake (ECDH, ECDSA sign or verify, PRF) to an asynchronous
+   * executor, e.g. a thread pool. The executor must call
+   * dtls_crypto_job_run() for @p job on any thread and afterwards
+   * dtls_crypto_job_complete() on the thread that uses @p ctx. Until
+   * then, the handshake of this peer is suspended while records of
+   * other peers are still processed.
+   *
+   * dtls_crypto_job_complete() must not be called from within this
+   * callback. If this pointer is NULL, all operations are done
+   * synchronously.
+   *
+   * An accepted @p job is owned by the executor until it is passed to
+   * dtls_crypto_job_complete(), which releases it. Jobs are not
+   * cancelled when their peer is removed, they are discarded on
+   * completion. As completing still uses @p ctx, the executor must be
+   * drained before dtls_free_context() is called. See
+   * tests/unit-tests/test_crypto_job.c for a simple executor.
+   *
+   * @param ctx  The current dtls context.
+   * @param job  The job to execute.
+   * @return @c 0 if the job was accepted, or less than zero to have
+   *         it executed synchronously.
+   */
+  int (*crypto_submit)(struct dtls_context_t *ctx, dtls_crypto_job_t *job);
 #endif /* DTLS_ECC */
 } dtls_handler_t;
 
 struct netq_t;
 
+/** Handling of a new handshake that exceeds the peer limits. */
+typedef enum dtls_reject_policy_t {
+  DTLS_REJECT_DROP = 0,         /**< ignore the ClientHello */
+  DTLS_REJECT_ALERT             /**< send a fatal internal_error alert */
+} dtls_reject_policy_t;
+
+/**
+ * Limits the number of peers of a context, see dtls_set_peer_limits().
+ * A limit of @c 0 means no limit.
+ */
+typedef struct dtls_peer_limits_t {
+  unsigned int max_peers;       /**< all peers */
+  unsigned int max_handshakes;  /**< peers without a completed handshake */
+  /** minimum time in seconds since the last authenticated record of
+   *  an evicted peer */
+  unsigned int evict_idle;
+  int evict_close_notify;       /**< send close_notify to evicted peers */
+  dtls_reject_policy_t reject;  /**< how a server rejects a ClientHello */
+  /** seconds without an authenticated record, after which an
+   *  established peer is removed */
+  unsigned int idle_timeout;
+  /** seconds after which a peer is removed if its first handshake
+   *  has not completed */
+  unsigned int handshake_timeout;
+} dtls_peer_limits_t;
+
+/**
+ * Bounds of the retransmission timeout in milliseconds, see
+ * dtls_set_rto_config().
+ */
+typedef struct dtls_rto_config_t {
+  unsigned int initial;         /**< timeout without an RTT estimate */
+  unsigned int min;             /**< lower bound of the estimated timeout */
+  unsigned int max;             /**< upper bound, also for the backoff */
+  unsigned int jitter;          /**< random extension in percent */
+} dtls_rto_config_t;
+
+/**
+ * Limits of the retransmissions of a context per second, see
+ * dtls_set_retransmit_pacing(). A limit of @c 0 disables it.
+ */
+typedef struct dtls_pacing_t {
+  unsigned int bytes_per_second;
+  unsigned int datagrams_per_second;
+} dtls_pacing_t;
+
+/**
+ * A session that may be resumed with an abbreviated handshake. A
+ * server finds it by its id, a client by the address of the server.
+ */
+typedef struct dtls_session_cache_entry_t {
+  session_t remote;		/**< the peer of the full handshake */
+  dtls_tick_t created;		/**< time of the full handshake */
+  dtls_peer_type role;		/**< our role in the session */
+  uint8 id_length;		/**< 0 for an unused entry */
+  uint8 id[DTLS_SESSION_ID_LENGTH];
+  uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
+  dtls_cipher_index_t cipher_index;
+  unsigned int extended_master_secret:1;
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  uint16_t ticket_length;	/**< 0 if the server has not sent a ticket */
+  uint8 ticket[DTLS_SESSION_TICKET_LENGTH];
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+} dtls_session_cache_entry_t;
+
+/** Number of keys a server accepts session tickets of. */
+#define DTLS_TICKET_KEYS 2
+/** Length of the name of a session ticket key. */
+#define DTLS_TICKET_KEY_NAME_LENGTH 16
+/** Length of a session ticket key, used with AES-128-CCM. */
+#define DTLS_TICKET_KEY_LENGTH 16
+
+/** A key to protect session tickets, see dtls_set_ticket_keys(). */
+typedef struct dtls_ticket_key_t {
+  /** identifies the key, tickets carry it in the clear */
+  uint8 name[DTLS_TICKET_KEY_NAME_LENGTH];
+  uint8 key[DTLS_TICKET_KEY_LENGTH];
+} dtls_ticket_key_t;
+
+/** Settings of the validated client addresses, see
+ *  dtls_set_address_validation(). */
+typedef struct dtls_address_validation_t {
+  /** seconds an address is remembered after its cookie exchange, 0
+   *  to send a HelloVerifyRequest to every client */
+  unsigned int lifetime;
+  /** initial ClientHellos per second, above which every client is
+   *  sent a HelloVerifyRequest again, 0 for no limit */
+  unsigned int max_rate;
+} dtls_address_validation_t;
+
+/** A client address that has been validated by a cookie exchange. */
+typedef struct dtls_validated_address_t {
+  uint32_t tag;			/**< keyed hash of the address, 0 if unused */
+  dtls_tick_t validated;	/**< time of the cookie exchange */
+} dtls_validated_address_t;
+
+/** Round-trip time estimate in milliseconds, see dtls_get_rtt(). */
+typedef struct dtls_rtt_t {
+  unsigned int srtt;            /**< smoothed round-trip time, 0 if unknown */
+  unsigned int rttvar;          /**< round-trip time variation */
+  unsigned int rto;             /**< timeout of the next flight */
+} dtls_rtt_t;
+
 /** Holds global information of the DTLS engine. */
 typedef struct dtls_context_t {
   unsigned char cookie_secret[DTLS_COOKIE_SECRET_LENGTH];
   clock_time_t cookie_secret_age; /**< the time the secret has been generated */
 
+#ifdef DTLS_PEERS_OPENHASH
+  dtls_peer_table_t peers;	/**< open addressing peer table */
+#else /* ! DTLS_PEERS_OPENHASH */
   dtls_peer_t *peers;		/**< peer hash map */
+#endif /* ! DTLS_PEERS_OPENHASH */
+#if DTLS_CID_LENGTH > 0
+#ifndef DTLS_PEERS_NOHASH
+  dtls_peer_t *cid_peers;	/**< peers by their connection id */
+#endif /* ! DTLS_PEERS_NOHASH */
+  /** the first bytes of the connection ids, see dtls_set_cid_prefix() */
+  uint8 cid_prefix[DTLS_CID_LENGTH];
+  uint8 cid_prefix_length;
+#endif /* DTLS_CID_LENGTH > 0 */
 #ifdef WITH_CONTIKI
   struct etimer retransmit_timer; /**< fires when the next packet must be sent */
 #endif /* WITH_CONTIKI */
 
-  struct netq_t *sendqueue;     /**< the packets to send */
+  netq_wheel_t sendqueue;       /**< the packets to retransmit */
+
+  dtls_mem_t *mem;		/**< object pools, NULL on Contiki and RIOT */
+
+  dtls_peer_limits_t limits;	/**< see dtls_set_peer_limits() */
+  dtls_peer_t *lru;		/**< established peers, least recently used first */
+  dtls_peer_t *handshakes;	/**< other peers, oldest first */
+  unsigned int num_peers;	/**< number of peers */
+  unsigned int num_established;	/**< number of peers in lru */
+
+  size_t mtu;			/**< see dtls_set_mtu() */
+
+  unsigned int session_lifetime; /**< see dtls_set_session_lifetime() */
+  int false_start;		/**< see dtls_set_false_start() */
+#if DTLS_SESSION_CACHE_SIZE > 0
+  /** sessions that may be resumed, oldest are replaced first */
+  dtls_session_cache_entry_t sessions[DTLS_SESSION_CACHE_SIZE];
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  /** the key to issue tickets with first, see dtls_set_ticket_keys() */
+  dtls_ticket_key_t ticket_keys[DTLS_TICKET_KEYS];
+  uint8 num_ticket_keys;	/**< number of valid ticket_keys */
+  /** set if the application provides the keys */
+  unsigned int ticket_keys_external:1;
+  dtls_tick_t ticket_key_created; /**< time of the first generated key */
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+#if DTLS_VALIDATED_ADDRESSES > 0
+  /** see dtls_set_address_validation() */
+  dtls_address_validation_t validation;
+  /** the client addresses that have answered a HelloVerifyRequest,
+   *  indexed by their tag */
+  dtls_validated_address_t validated[DTLS_VALIDATED_ADDRESSES];
+  dtls_tick_t hello_time;	/**< start of the second hellos counts */
+  unsigned int hellos;		/**< initial ClientHellos since hello_time */
+  unsigned int hellos_before;	/**< initial ClientHellos the second before */
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+
+  dtls_rto_config_t rto;	/**< see dtls_set_rto_config() */
+  /** estimate from the flights of all peers, used for new peers, in
+   *  ticks */
+  dtls_tick_t srtt;
+  dtls_tick_t rttvar;
+  uint32_t jitter_state;	/**< random state for the jitter */
+
+  dtls_pacing_t pacing;		/**< see dtls_set_retransmit_pacing() */
+  /** remaining retransmission budget, in bytes and datagrams times
+   *  DTLS_TICKS_PER_SECOND */
+  int64_t pacing_bytes;
+  int64_t pacing_datagrams;
+  dtls_tick_t pacing_time;	/**< time of the last update of the budget */
 
   void *app;			/**< application-specific data */
 
   dtls_handler_t *h;		/**< callback handlers */
+
+#ifdef DTLS_CONCURRENT_PEERS
+  struct dtls_context_locks_t *locks; /**< see DTLS_CONCURRENT_PEERS */
+#endif /* DTLS_CONCURRENT_PEERS */
+
+#ifdef DTLS_CONSTRAINED_STACK
+  /** record buffer used by dtls_send_multi() and dtls_retransmit() */
+  unsigned char sendbuf[DTLS_MAX_BUF];
+#endif /* DTLS_CONSTRAINED_STACK */
 } dtls_context_t;
 
 /** 
@@ -251,12 +454,219 @@ void dtls_init(void);
  * object must be released with dtls_free_context(). */
 dtls_context_t *dtls_new_context(void *app_data);
 
-/** Releases any storage that has been allocated for \p ctx. */
+/**
+ * Releases any storage that has been allocated for \p ctx. Jobs that
+ * were handed to the crypto_submit() callback must have been passed
+ * to dtls_crypto_job_complete() before.
+ */
 void dtls_free_context(dtls_context_t *ctx);
 
+#if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
+/**
+ * Sets the allocator for the object pools of @p ctx, e.g. to take
+ * them from an arena. This must be called before the first peer is
+ * created, the default uses malloc() and free().
+ *
+ * @return @c 0 on success, or less than zero if @p ctx already has
+ *   allocated objects.
+ */
+int dtls_set_allocator(dtls_context_t *ctx, const dtls_allocator_t *allocator);
+
+/**
+ * Preallocates room for @p count objects of type @p type in the pools
+ * of @p ctx.
+ *
+ * @return @c 0 on success, or less than zero if no memory is
+ *   available.
+ */
+int dtls_reserve(dtls_context_t *ctx, dtls_pool_type_t type, size_t count);
+#endif /* ! WITH_CONTIKI && ! RIOT_VERSION */
+
+/**
+ * Sets the peer limits of @p ctx. When a new peer would exceed
+ * max_peers, established peers are evicted in least recently used
+ * order, as long as they have been idle for evict_idle seconds. A
+ * peer is used by each authenticated record it sends. If no peer can
+ * be evicted, or the new peer would exceed max_handshakes, a server
+ * handles the ClientHello according to @c reject and dtls_connect()
+ * fails.
+ *
+ * Peers that exceed idle_timeout or handshake_timeout are removed by
+ * dtls_check_retransmit(), after the event callback has been called
+ * with DTLS_EVENT_IDLE_TIMEOUT or DTLS_EVENT_HANDSHAKE_TIMEOUT.
+ * Expired sessions get a close_notify like evicted ones.
+ *
+ * With DTLS_CONCURRENT_PEERS, the limits may be exceeded by one peer
+ * per thread. The defaults are DTLS_PEERS_LIMIT,
+ * DTLS_HANDSHAKES_LIMIT, DTLS_PEER_EVICT_IDLE, close_notify,
+ * DTLS_REJECT_DROP, DTLS_PEER_IDLE_TIMEOUT and DTLS_HANDSHAKE_TIMEOUT.
+ */
+void dtls_set_peer_limits(dtls_context_t *ctx, const dtls_peer_limits_t *limits);
+
+/**
+ * Sets the bounds of the retransmission timeout of @p ctx. The time
+ * from sending a flight to the arrival of the peer's next flight is
+ * measured unless the flight was retransmitted, and kept as smoothed
+ * round-trip time and variation per peer and per context, as in RFC
+ * 6298. The timeout of a flight is srtt + 4 * rttvar of its peer,
+ * limited to min and max, and extended by a random amount of up to
+ * @c jitter percent. Peers without a measurement use the context's
+ * estimate, and @c initial as long as the context has none. Each
+ * retransmission doubles the timeout, up to max.
+ *
+ * The defaults are DTLS_RTO_INITIAL, DTLS_RTO_MIN, DTLS_RTO_MAX and
+ * DTLS_RTO_JITTER.
+ */
+void dtls_set_rto_config(dtls_context_t *ctx, const dtls_rto_config_t *config);
+
+/**
+ * Limits the retransmissions of @p ctx, so that a burst of expiring
+ * flights does not flood the network. Up to one second's worth of
+ * budget is accumulated. A flight is retransmitted as a whole while
+ * budget is left, flights that expire beyond it are deferred in the
+ * order of their deadlines. The first transmission of a flight is
+ * not limited.
+ *
+ * The defaults are DTLS_RETRANSMIT_BYTES_PER_SECOND and
+ * DTLS_RETRANSMIT_DATAGRAMS_PER_SECOND.
+ */
+void dtls_set_retransmit_pacing(dtls_context_t *ctx, const dtls_pacing_t *pacing);
+
+/**
+ * Returns the round-trip time estimate of the peer at @p session in
+ * @p rtt, or of @p ctx if @p session is @c NULL.
+ *
+ * @return @c 0 on success, or less than zero if there is no such
+ *   peer.
+ */
+int dtls_get_rtt(dtls_context_t *ctx, const session_t *session, dtls_rtt_t *rtt);
+
+/**
+ * Sets the size limit of the datagrams to the peer at @p session,
+ * which overrides the limit of @p ctx. A limit of @c 0 restores the
+ * limit of @p ctx. The limit is at most DTLS_MAX_BUF.
+ *
+ * @return @c 0 on success, or less than zero if there is no such
+ *   peer.
+ */
+int dtls_set_peer_mtu(dtls_context_t *ctx, const session_t *session, size_t mtu);
+
+/**
+ * Lowers the size limit of the datagrams to the peer at @p session to
+ * @p mtu, e.g. when an ICMP Packet Too Big or Fragmentation Needed
+ * message has been received for it, or when sending a datagram has
+ * failed with EMSGSIZE. The limit is never raised by this function.
+ * A flight that has been lost is fragmented with the new limit when it
+ * is retransmitted. This function may be called from the write
+ * callback.
+ *
+ * @return @c 0 on success, or less than zero if there is no such
+ *   peer.
+ */
+int dtls_report_path_mtu(dtls_context_t *ctx, const session_t *session, size_t mtu);
+
 #define dtls_set_app_data(CTX,DATA) ((CTX)->app = (DATA))
 #define dtls_get_app_data(CTX) ((CTX)->app)
 
+/**
+ * Sets the size limit of the datagrams of @p ctx. The records of a
+ * handshake flight are packed into as few datagrams as this limit
+ * permits, handshake messages that exceed it are fragmented. The
+ * limit is at most DTLS_MAX_BUF and defaults to DTLS_DEFAULT_MTU. It
+ * must be set before the context is used, see dtls_set_peer_mtu() for
+ * the limit of a single peer.
+ */
+static inline void dtls_set_mtu(dtls_context_t *ctx, size_t mtu) {
+  ctx->mtu = mtu < DTLS_MAX_BUF ? mtu : DTLS_MAX_BUF;
+}
+
+/**
+ * Sets the time in seconds after its full handshake, for which a
+ * session of @p ctx may be resumed. A server assigns a session id to
+ * each full handshake and keeps the session for DTLS_SESSION_CACHE_SIZE
+ * clients. A client keeps the last session of each server and offers
+ * it in the ClientHello of dtls_connect(), the server then either
+ * resumes it with an abbreviated handshake, or starts a full one.
+ * Sessions that end with a fatal alert are not resumed. A lifetime of
+ * @c 0 disables resumption, the default is DTLS_SESSION_LIFETIME. It
+ * must be set before the context is used. The session cache is
+ * disabled unless DTLS_SESSION_CACHE_SIZE is set at compile time.
+ */
+static inline void dtls_set_session_lifetime(dtls_context_t *ctx,
+                                             unsigned int lifetime) {
+  ctx->session_lifetime = lifetime;
+}
+
+/**
+ * Lets the clients of @p ctx send application data right after their
+ * Finished message, a round trip before the handshake completes (TLS
+ * False Start, RFC 7918). As the RFC requires forward secrecy, this
+ * applies to full handshakes with an ECDHE_ECDSA cipher suite only.
+ * The event DTLS_EVENT_FALSE_START is signaled when dtls_write()
+ * starts to accept data, DTLS_EVENT_CONNECTED follows once the
+ * server's Finished has been verified. False Start is disabled by
+ * default. Servers read application data that arrives before the
+ * Finished of the client once it has been verified.
+ */
+static inline void dtls_set_false_start(dtls_context_t *ctx, int enable) {
+  ctx->false_start = enable;
+}
+
+/**
+ * Sets the keys a server protects its session tickets (RFC 5077)
+ * with. Tickets keep the session state with the client, so that
+ * clients that send the session ticket extension are resumed without
+ * an entry in the session cache. New tickets are issued with the
+ * first of @p keys, tickets of all @p keys are accepted. Servers that
+ * share their keys resume the sessions of each other.
+ *
+ * Without keys, the context generates its own, and replaces it after
+ * the session lifetime. Applications that set keys rotate them by
+ * calling this function again with a new key first, followed by the
+ * previous one. A @p count of @c 0 returns to generated keys.
+ * Session tickets are disabled unless DTLS_SESSION_TICKET_LENGTH is
+ * set at compile time.
+ *
+ * @return @c 0 on success, or less than zero if @p count exceeds
+ *   DTLS_TICKET_KEYS or tickets are disabled.
+ */
+int dtls_set_ticket_keys(dtls_context_t *ctx, const dtls_ticket_key_t *keys,
+                         size_t count);
+
+/**
+ * Lets the server @p ctx start the handshake of a client without a
+ * HelloVerifyRequest, if the client's IP address has completed a
+ * cookie exchange or a handshake within @p config->lifetime seconds.
+ * This saves a round trip when the client connects again, even from
+ * another port. Up to DTLS_VALIDATED_ADDRESSES addresses are
+ * remembered by a hash keyed with the cookie secret. A client with an
+ * existing peer is always verified, so that a spoofed ClientHello
+ * cannot replace its session. While initial ClientHellos arrive
+ * faster than @p config->max_rate per second, every client is
+ * verified. Address validation is disabled by default, and needs
+ * DTLS_VALIDATED_ADDRESSES to be set at compile time. It must be set
+ * before the context is used.
+ *
+ * @return @c 0 on success, or less than zero if DTLS_VALIDATED_ADDRESSES
+ *   is @c 0.
+ */
+int dtls_set_address_validation(dtls_context_t *ctx,
+                                const dtls_address_validation_t *config);
+
+/**
+ * Sets the first bytes of the connection ids (RFC 9146) that @p ctx
+ * asks its peers to send in their records, the remaining bytes are
+ * random. A load balancer that sees the same prefix in all records of
+ * a session routes them to the same context, even after the peer's
+ * address has changed. It must be set before the context is used.
+ *
+ * @return @c 0 on success, or less than zero if @p length leaves no
+ *   random bytes in a connection id of DTLS_CID_LENGTH bytes, or
+ *   connection ids are disabled.
+ */
+int dtls_set_cid_prefix(dtls_context_t *ctx, const uint8 *prefix,
+                        size_t length);
+
 /** Sets the callback handler object for @p ctx to @p h. */
 static inline void dtls_set_handler(dtls_context_t *ctx, dtls_handler_t *h) {
   ctx->h = h;
@@ -326,12 +736,13 @@ int dtls_write(struct dtls_context_t *ctx, session_t *session,
 
 /**
  * Checks sendqueue of given DTLS context object for any outstanding
- * packets to be transmitted. 
+ * packets to be transmitted. Peers that exceed the timeouts set with
+ * dtls_set_peer_limits() are removed as well.
  *
  * @param context The DTLS context object to use.
  * @param next    If not NULL, @p next is filled with the timestamp
- *  of the next scheduled retransmission, or @c 0 when no packets are
- *  waiting.
+ *  of the next scheduled retransmission or peer timeout, or @c 0 when
+ *  neither is pending.
  */
 void dtls_check_retransmit(dtls_context_t *context, clock_time_t *next);
 
@@ -341,6 +752,7 @@ void dtls_check_retransmit(dtls_context_t *context, clock_time_t *next);
 #define DTLS_CT_ALERT              21
 #define DTLS_CT_HANDSHAKE          22
 #define DTLS_CT_APPLICATION_DATA   23
+#define DTLS_CT_TLS12_CID          25 /* see RFC 9146 */
 
 #ifdef __GNUC__
 #define PACK( __Declaration__ ) __Declaration__ __attribute__((__packed__))
@@ -366,6 +778,7 @@ PACK(typedef struct) {
 #define DTLS_HT_CLIENT_HELLO         1
 #define DTLS_HT_SERVER_HELLO         2
 #define DTLS_HT_HELLO_VERIFY_REQUEST 3
+#define DTLS_HT_NEW_SESSION_TICKET   4
 #define DTLS_HT_CERTIFICATE         11
 #define DTLS_HT_SERVER_KEY_EXCHANGE 12
 #define DTLS_HT_CERTIFICATE_REQUEST 13
@@ -427,10 +840,43 @@ int dtls_record_read(dtls_state_t *state, uint8 *msg, int msglen);
  * @param msg     The received data
  * @param msglen  The actual length of @p msg.
  * @return A value less than zero on error, zero on success.
+ *
+ * If tinydtls is built with DTLS_CONCURRENT_PEERS, this function and
+ * the other functions taking a session may be called by several
+ * threads for the same @p ctx. Work on one peer is serialized, work
+ * on different peers runs in parallel. The callbacks are invoked by
+ * the thread that processes the respective peer.
  */
 int dtls_handle_message(dtls_context_t *ctx, session_t *session,
 			uint8 *msg, int msglen);
 
+#ifdef DTLS_ECC
+/**
+ * Executes the cryptographic operation of @p job that was handed to
+ * the crypto_submit() callback. This function only works on the data
+ * of @p job and may therefore be called on any thread.
+ *
+ * @param job  The job to execute.
+ */
+void dtls_crypto_job_run(dtls_crypto_job_t *job);
+
+/**
+ * Completes a job executed by dtls_crypto_job_run() and resumes the
+ * handshake of the related peer. This function must be called on the
+ * thread that uses @p ctx, as dtls_handle_message() is, unless
+ * tinydtls is built with DTLS_CONCURRENT_PEERS. The storage
+ * of @p job is released. A job whose peer has been removed or has
+ * started a new handshake in the meantime is silently discarded.
+ * Jobs may be completed in any order, but @p ctx must not have been
+ * freed.
+ *
+ * @param ctx  The dtls context the job was submitted by.
+ * @param job  The executed job.
+ * @return A value less than zero on error, zero on success.
+ */
+int dtls_crypto_job_complete(dtls_context_t *ctx, dtls_crypto_job_t *job);
+#endif /* DTLS_ECC */
+
 /**
  * Check if @p session is associated with a peer object in @p context.
  * This function returns a pointer to the peer if found, NULL otherwise.
@@ -438,7 +884,9 @@ int dtls_handle_message(dtls_context_t *ctx, session_t *session,
  * @param context  The DTLS context to search.
  * @param session  The remote address and local interface
  * @return A pointer to the peer associated with @p session or NULL if
- *  none exists.
+ *  none exists. With DTLS_CONCURRENT_PEERS, the peer may be removed by
+ *  another thread at any time, unless the caller is a callback invoked
+ *  for @p session.
  */
 dtls_peer_t *dtls_get_peer(const dtls_context_t *context,
 			   const session_t *session);
@@ -669,8 +1117,10 @@ int get_psk_info(struct dtls_context_t *ctx UNUSED_PARAM,
  * @p code will indicate the notification code. For internal events, @p level
  * is @c 0, and @p code a value greater than @c 255. 
  *
- * Internal events are DTLS_EVENT_CONNECTED, @c DTLS_EVENT_CONNECT, and
- * @c DTLS_EVENT_RENEGOTIATE.
+ * Internal events are DTLS_EVENT_CONNECTED, @c DTLS_EVENT_CONNECT,
+ * @c DTLS_EVENT_RENEGOTIATE, @c DTLS_EVENT_IDLE_TIMEOUT,
+ * @c DTLS_EVENT_HANDSHAKE_TIMEOUT, @c DTLS_EVENT_ADDRESS_CHANGED, and
+ * @c DTLS_EVENT_FALSE_START.
  *
  * @code
 int handle_event(struct dtls_context_t *ctx, session_t *session, 
@@ -0,0 +1,276 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include "tinydtls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "dtls_alloc.h"
+#include "dtls_mutex.h"
+#include "netq.h"
+#include "peer.h"
+
+/*
+ * Each object is preceded by a pointer to the pool it belongs to, so
+ * that it can be released without a context. Objects allocated
+ * individually additionally store the address returned by the
+ * allocator in the word before. Pool objects are placed at a fixed
+ * stride, the pool pointer of the next object lives in the padding
+ * after the current one.
+ */
+#define MEM_ALIGN (2 * sizeof(void *))
+
+#define align_up(N, A) (((N) + (A) - 1) & ~((uintptr_t)(A) - 1))
+
+typedef struct dtls_slab_t {
+  struct dtls_slab_t *next;
+} dtls_slab_t;
+
+typedef struct dtls_pool_t {
+  dtls_mem_t *mem;
+  size_t size;                  /**< object size, 0 for individual objects */
+  size_t align;                 /**< object alignment */
+  size_t stride;                /**< distance of two objects in a slab */
+  void *free_list;              /**< released objects, linked by first word */
+  dtls_slab_t *slabs;
+} dtls_pool_t;
+
+struct dtls_mem_t {
+  dtls_allocator_t allocator;
+  /** one pool per type, the last one for individual objects */
+  dtls_pool_t pools[DTLS_POOL_MAX + 1];
+  int used;                     /**< set when the first object is allocated */
+#ifdef DTLS_CONCURRENT_PEERS
+  dtls_mutex_t lock;
+#endif /* DTLS_CONCURRENT_PEERS */
+};
+
+#ifdef DTLS_CONCURRENT_PEERS
+#define mem_lock(M) dtls_mutex_lock(&(M)->lock)
+#define mem_unlock(M) dtls_mutex_unlock(&(M)->lock)
+#else /* ! DTLS_CONCURRENT_PEERS */
+#define mem_lock(M)
+#define mem_unlock(M)
+#endif /* ! DTLS_CONCURRENT_PEERS */
+
+#define pool_of(Ptr) (((dtls_pool_t **)(Ptr))[-1])
+#define raw_of(Ptr) (((void **)(Ptr))[-2])
+
+static void *
+default_alloc(void *arg, size_t size) {
+  (void)arg;
+  return malloc(size);
+}
+
+static void
+default_free(void *arg, void *ptr) {
+  (void)arg;
+  free(ptr);
+}
+
+/* owner of the objects allocated without a context */
+static dtls_mem_t default_mem = {
+  { default_alloc, default_free, NULL },
+  { [DTLS_POOL_MAX] = { &default_mem, 0, MEM_ALIGN, 0, NULL, NULL } },
+  0,
+#ifdef DTLS_CONCURRENT_PEERS
+  DTLS_MUTEX_INITIALIZER
+#endif /* DTLS_CONCURRENT_PEERS */
+};
+
+static void
+pool_init(dtls_pool_t *pool, dtls_mem_t *mem, size_t size, size_t align) {
+  pool->mem = mem;
+  pool->size = size;
+  pool->align = align;
+  pool->stride = size ? align_up(size + sizeof(void *), align) : 0;
+  pool->free_list = NULL;
+  pool->slabs = NULL;
+}
+
+static size_t
+pool_align(dtls_pool_type_t type) {
+  /* start the per-record members of the peer at a cache line */
+  return type == DTLS_POOL_PEER && DTLS_CACHE_LINE_SIZE > MEM_ALIGN ?
+    DTLS_CACHE_LINE_SIZE : MEM_ALIGN;
+}
+
+dtls_mem_t *
+dtls_mem_new(void) {
+  static const size_t sizes[DTLS_POOL_MAX] = {
+    sizeof(dtls_peer_t),
+    sizeof(dtls_security_parameters_t),
+    sizeof(dtls_handshake_parameters_t),
+    sizeof(netq_t) + DTLS_MAX_BUF
+  };
+  dtls_mem_t *mem;
+  int i;
+
+  mem = (dtls_mem_t *)malloc(sizeof(dtls_mem_t));
+  if (!mem)
+    return NULL;
+
+  memset(mem, 0, sizeof(dtls_mem_t));
+#ifdef DTLS_CONCURRENT_PEERS
+  if (dtls_mutex_init(&mem->lock) != 0) {
+    free(mem);
+    return NULL;
+  }
+#endif /* DTLS_CONCURRENT_PEERS */
+  mem->allocator = default_mem.allocator;
+  for (i = 0; i < DTLS_POOL_MAX; i++) {
+    pool_init(&mem->pools[i], mem, sizes[i], pool_align(i));
+  }
+  pool_init(&mem->pools[DTLS_POOL_MAX], mem, 0, MEM_ALIGN);
+  return mem;
+}
+
+void
+dtls_mem_free(dtls_mem_t *mem) {
+  int i;
+
+  if (!mem)
+    return;
+
+  for (i = 0; i < DTLS_POOL_MAX; i++) {
+    dtls_slab_t *slab, *next;
+
+    for (slab = mem->pools[i].slabs; slab; slab = next) {
+      next = slab->next;
+      mem->allocator.free(mem->allocator.arg, slab);
+    }
+  }
+#ifdef DTLS_CONCURRENT_PEERS
+  dtls_mutex_destroy(&mem->lock);
+#endif /* DTLS_CONCURRENT_PEERS */
+  free(mem);
+}
+
+int
+dtls_mem_set_allocator(dtls_mem_t *mem, const dtls_allocator_t *allocator) {
+  int res = -1;
+
+  mem_lock(mem);
+  if (!mem->used) {
+    mem->allocator = *allocator;
+    res = 0;
+  }
+  mem_unlock(mem);
+  return res;
+}
+
+/* Adds a slab of @p count objects to the free list of @p pool. */
+static int
+pool_grow(dtls_pool_t *pool, size_t count) {
+  dtls_allocator_t *allocator = &pool->mem->allocator;
+  dtls_slab_t *slab;
+  uint8_t *obj;
+
+  slab = (dtls_slab_t *)allocator->alloc(allocator->arg,
+                                         pool->align + count * pool->stride);
+  if (!slab)
+    return -1;
+
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+
+  obj = (uint8_t *)align_up((uintptr_t)(slab + 1) + sizeof(void *), pool->align);
+  while (count--) {
+    pool_of(obj) = pool;
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+    obj += pool->stride;
+  }
+  return 0;
+}
+
+int
+dtls_mem_reserve(dtls_mem_t *mem, dtls_pool_type_t type, size_t count) {
+  int res;
+
+  if (type >= DTLS_POOL_MAX || !count)
+    return -1;
+
+  mem_lock(mem);
+  mem->used = 1;
+  res = pool_grow(&mem->pools[type], count);
+  mem_unlock(mem);
+  return res;
+}
+
+static void *
+alloc_individual(dtls_mem_t *mem, size_t size, size_t align) {
+  uint8_t *raw, *obj;
+
+  /* the allocator returns MEM_ALIGN aligned memory, which leaves room
+   * for the two words before an object aligned to align */
+  raw = (uint8_t *)mem->allocator.alloc(mem->allocator.arg, size + align);
+  if (!raw)
+    return NULL;
+
+  obj = (uint8_t *)align_up((uintptr_t)raw + 2 * sizeof(void *), align);
+  raw_of(obj) = raw;
+  pool_of(obj) = &mem->pools[DTLS_POOL_MAX];
+  return obj;
+}
+
+void *
+dtls_mem_alloc(dtls_mem_t *mem, dtls_pool_type_t type, size_t size) {
+  dtls_pool_t *pool;
+  void *obj = NULL;
+
+  if (!mem)
+    return alloc_individual(&default_mem, size, pool_align(type));
+
+  pool = &mem->pools[type];
+  mem_lock(mem);
+  mem->used = 1;
+  if (size > pool->size || DTLS_POOL_SLAB == 0) {
+    obj = alloc_individual(mem, size, pool->align);
+  } else if (pool->free_list || pool_grow(pool, DTLS_POOL_SLAB) == 0) {
+    obj = pool->free_list;
+    pool->free_list = *(void **)obj;
+  }
+  mem_unlock(mem);
+  return obj;
+}
+
+void
+dtls_mem_release(void *ptr) {
+  dtls_pool_t *pool;
+
+  if (!ptr)
+    return;
+
+  pool = pool_of(ptr);
+  if (!pool->size) {
+    dtls_allocator_t *allocator = &pool->mem->allocator;
+
+    allocator->free(allocator->arg, raw_of(ptr));
+  } else {
+    mem_lock(pool->mem);
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+    mem_unlock(pool->mem);
+  }
+}
+
+dtls_mem_t *
+dtls_mem_owner(const void *ptr) {
+  dtls_mem_t *mem = ((dtls_pool_t * const *)ptr)[-1]->mem;
+
+  return mem == &default_mem ? NULL : mem;
+}
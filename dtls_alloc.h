@@ -0,0 +1,119 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/**
+ * @file dtls_alloc.h
+ * @brief Per-context object pools
+ */
+
+#ifndef _DTLS_ALLOC_H_
+#define _DTLS_ALLOC_H_
+
+#include <stddef.h>
+
+#include "tinydtls.h"
+
+/**
+ * @defgroup alloc Object pools
+ *
+ * On platforms that use malloc(), each context keeps a pool for each
+ * of its frequently allocated object types. A pool carves objects
+ * from larger slabs and keeps released objects on a free list, so
+ * that a busy server does not call the system allocator per record or
+ * handshake. Slabs are allocated with a dtls_allocator_t, which
+ * defaults to malloc() and free(), and are only released with the
+ * context.
+ *
+ * Contiki and RIOT use their static storage instead, the @p mem
+ * argument of the allocation functions is ignored there.
+ * @{
+ */
+
+/** Memory allocator for the slabs of a context. */
+typedef struct dtls_allocator_t {
+  /**
+   * Returns at least @p size bytes aligned like the result of
+   * malloc(), or @c NULL if no memory is available.
+   */
+  void *(*alloc)(void *arg, size_t size);
+  /** Releases memory returned by alloc. */
+  void (*free)(void *arg, void *ptr);
+  void *arg;                    /**< passed to alloc and free */
+} dtls_allocator_t;
+
+/** The object types that have a pool. */
+typedef enum {
+  DTLS_POOL_PEER = 0,           /**< dtls_peer_t */
+  DTLS_POOL_SECURITY,           /**< dtls_security_parameters_t */
+  DTLS_POOL_HANDSHAKE,          /**< dtls_handshake_parameters_t */
+  DTLS_POOL_NETQ,               /**< netq_t with up to DTLS_MAX_BUF bytes */
+  DTLS_POOL_MAX
+} dtls_pool_type_t;
+
+typedef struct dtls_mem_t dtls_mem_t;
+
+#if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
+
+/** Creates the pools of a context, using malloc() for the slabs. */
+dtls_mem_t *dtls_mem_new(void);
+
+/**
+ * Releases @p mem with all of its slabs. Objects still allocated
+ * from the pools become invalid.
+ */
+void dtls_mem_free(dtls_mem_t *mem);
+
+/**
+ * Replaces the allocator of @p mem. This is only possible before the
+ * first object is allocated.
+ *
+ * @return @c 0 on success, or less than zero if objects have already
+ *   been allocated.
+ */
+int dtls_mem_set_allocator(dtls_mem_t *mem, const dtls_allocator_t *allocator);
+
+/**
+ * Adds a slab with room for @p count objects to the pool @p type of
+ * @p mem.
+ *
+ * @return @c 0 on success, or less than zero if no memory is
+ *   available.
+ */
+int dtls_mem_reserve(dtls_mem_t *mem, dtls_pool_type_t type, size_t count);
+
+/**
+ * Allocates @p size bytes for an object of type @p type. Objects that
+ * do not fit into the pool, or all objects if @p mem is @c NULL, are
+ * allocated individually. The result must be released with
+ * dtls_mem_release().
+ */
+void *dtls_mem_alloc(dtls_mem_t *mem, dtls_pool_type_t type, size_t size);
+
+/** Returns @p ptr to the pool it was allocated from. */
+void dtls_mem_release(void *ptr);
+
+/**
+ * Returns the pools @p ptr was allocated from, or @c NULL if it was
+ * allocated without a context.
+ */
+dtls_mem_t *dtls_mem_owner(const void *ptr);
+
+#else /* WITH_CONTIKI || RIOT_VERSION */
+
+#define dtls_mem_owner(ptr) ((void)(ptr), (dtls_mem_t *)NULL)
+
+#endif /* WITH_CONTIKI || RIOT_VERSION */
+
+/** @} */
+
+#endif /* _DTLS_ALLOC_H_ */
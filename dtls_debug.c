@@ -15,13 +15,12 @@
  *
  *******************************************************************************/
 
-#include "tinydtls.h"
-
-#ifdef IS_WINDOWS
+/* must precede the first include, e.g. for localtime_r() */
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
 #endif /* _GNU_SOURCE */
-#endif /* IS_WINDOWS */
+
+#include "tinydtls.h"
 
 #if defined(HAVE_ASSERT_H) && !defined(assert)
 #include <assert.h>
@@ -90,7 +89,14 @@ static const char *loglevels[] = {
 static inline size_t
 print_timestamp(char *s, size_t len, time_t t) {
   struct tm *tmp;
+#ifdef WITH_POSIX
+  struct tm tm;
+  tmp = localtime_r(&t, &tm);
+#else /* ! WITH_POSIX */
   tmp = localtime(&t);
+#endif /* ! WITH_POSIX */
+  if (!tmp)
+    return 0;
   return strftime(s, len, "%b %d %H:%M:%S", tmp);
 }
 
@@ -251,7 +257,7 @@ dsrv_print_addr(const session_t *addr, char *buf, size_t len) {
 
 static void
 dtls_logging_handler(log_t level, const char *message) {
-  static char timebuf[32];
+  char timebuf[32];
   FILE* log_fd = level <= DTLS_LOG_CRIT ? stderr : stdout;
 
   if (print_timestamp(timebuf,sizeof(timebuf), time(NULL)))
@@ -319,7 +325,7 @@ dsrv_log(log_t level, const char *format, ...) {
 #elif defined (HAVE_VPRINTF) /* WITH_CONTIKI */
 void
 dsrv_log(log_t level, char *format, ...) {
-  static char timebuf[32];
+  char timebuf[32];
   va_list ap;
 
   if (maxlog < level)
@@ -461,7 +467,7 @@ dtls_dsrv_hexdump_log(log_t level, const char *name, const unsigned char *buf, s
 #else /* WITH_CONTIKI */
 void
 dtls_dsrv_hexdump_log(log_t level, const char *name, const unsigned char *buf, size_t length, int extend) {
-  static char timebuf[32];
+  char timebuf[32];
   int n = 0;
 
   if (maxlog < level)
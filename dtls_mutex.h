@@ -22,6 +22,12 @@
 #ifndef _DTLS_MUTEX_H_
 #define _DTLS_MUTEX_H_
 
+#if defined(DTLS_CONCURRENT_PEERS) && \
+    (defined(RIOT_VERSION) || defined(WITH_CONTIKI) || \
+     defined(WITH_ZEPHYR) || defined(IS_WINDOWS))
+#error "DTLS_CONCURRENT_PEERS requires POSIX threads"
+#endif /* DTLS_CONCURRENT_PEERS */
+
 #if defined(RIOT_VERSION)
 
 #include <mutex.h>
@@ -65,6 +71,35 @@ typedef pthread_mutex_t dtls_mutex_t;
 #define dtls_mutex_trylock(a) pthread_mutex_trylock(a)
 #define dtls_mutex_unlock(a) pthread_mutex_unlock(a)
 
+#ifdef DTLS_CONCURRENT_PEERS
+/* The following requires _POSIX_C_SOURCE >= 200809L. */
+
+#define dtls_mutex_init(a) pthread_mutex_init(a, NULL)
+#define dtls_mutex_destroy(a) pthread_mutex_destroy(a)
+
+/** Initializes @p m as mutex that may be locked again by its owner. */
+static inline int
+dtls_mutex_init_recursive(dtls_mutex_t *m) {
+  pthread_mutexattr_t attr;
+  int res;
+
+  if ((res = pthread_mutexattr_init(&attr)) != 0)
+    return res;
+  res = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  if (res == 0)
+    res = pthread_mutex_init(m, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return res;
+}
+
+typedef pthread_rwlock_t dtls_rwlock_t;
+#define dtls_rwlock_init(a) pthread_rwlock_init(a, NULL)
+#define dtls_rwlock_destroy(a) pthread_rwlock_destroy(a)
+#define dtls_rwlock_rdlock(a) pthread_rwlock_rdlock(a)
+#define dtls_rwlock_wrlock(a) pthread_rwlock_wrlock(a)
+#define dtls_rwlock_unlock(a) pthread_rwlock_unlock(a)
+#endif /* DTLS_CONCURRENT_PEERS */
+
 #endif /* ! RIOT_VERSION && ! WITH_CONTIKI && ! IS_WINDOWS */
 
 #endif /* _DTLS_MUTEX_H_ */
@@ -0,0 +1,442 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif /* _GNU_SOURCE */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#endif /* __linux__ */
+
+#include "tinydtls.h"
+#include "dtls_debug.h"
+#include "dtls_time.h"
+#include "dtls_server.h"
+
+#ifndef DTLS_SERVER_MAX_SHARDS
+/** Upper bound for dtls_server_config_t::shards. */
+#define DTLS_SERVER_MAX_SHARDS 256
+#endif /* DTLS_SERVER_MAX_SHARDS */
+
+#ifndef DTLS_SERVER_RECV_BATCH
+/** Maximum number of datagrams read by a shard per wakeup. */
+#define DTLS_SERVER_RECV_BATCH 32
+#endif /* DTLS_SERVER_RECV_BATCH */
+
+typedef struct dtls_server_shard_t {
+  dtls_server_t *server;	/**< the server this shard belongs to */
+  dtls_context_t *ctx;		/**< DTLS context owned by this shard */
+  dtls_handler_t handler;	/**< handlers with write defaulted */
+  unsigned int index;		/**< index of this shard */
+  int fd;			/**< socket bound with SO_REUSEPORT */
+  int started;			/**< set when thread has been created */
+  pthread_t thread;		/**< worker thread */
+  uint8 buf[DTLS_MAX_BUF];	/**< receive buffer */
+} dtls_server_shard_t;
+
+struct dtls_server_t {
+  void *app;			/**< application-specific data */
+  unsigned int count;		/**< number of shards */
+  int wakeup[2];		/**< pipe to signal termination */
+  dtls_server_shard_t *shards;	/**< array of count shards */
+};
+
+static unsigned int
+dtls_server_default_shards(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return n < DTLS_SERVER_MAX_SHARDS ? (unsigned int)n : DTLS_SERVER_MAX_SHARDS;
+#endif /* _SC_NPROCESSORS_ONLN */
+  return 1;
+}
+
+static int
+dtls_server_socket(const session_t *listen) {
+  int fd;
+  int on = 1;
+  int off = 0;
+  int flags;
+
+  fd = socket(listen->addr.sa.sa_family, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    dtls_alert("socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+#ifdef SO_REUSEPORT
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+    dtls_alert("setsockopt SO_REUSEPORT: %s\n", strerror(errno));
+    goto error;
+  }
+#else /* ! SO_REUSEPORT */
+  (void)on;
+  dtls_alert("SO_REUSEPORT not supported\n");
+  goto error;
+#endif /* ! SO_REUSEPORT */
+
+  if (listen->addr.sa.sa_family == AF_INET6) {
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) < 0) {
+      dtls_warn("setsockopt IPV6_V6ONLY: %s\n", strerror(errno));
+    }
+  }
+
+  flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    dtls_alert("fcntl: %s\n", strerror(errno));
+    goto error;
+  }
+
+  if (bind(fd, &listen->addr.sa, listen->size) < 0) {
+    dtls_alert("bind: %s\n", strerror(errno));
+    goto error;
+  }
+
+  return fd;
+
+ error:
+  close(fd);
+  return -1;
+}
+
+/**
+ * Attaches a classic BPF program to the reuseport group of @p fd that
+ * selects the socket from the source address and port of the
+ * datagram. Unlike the kernel's default selection, the result only
+ * depends on the number of shards, not on the order in which sockets
+ * joined the group. Only the low 32 bits of an IPv6 source address
+ * are taken into account. Records with a connection id are steered by
+ * its first byte instead, the index of the shard that has issued it,
+ * so that they reach their peer after an address change. If the
+ * program cannot be attached, the kernel's own 4-tuple hash is used.
+ */
+static void
+dtls_server_attach_steering(int fd, unsigned int count) {
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_NET_OFF)
+  struct sock_filter code[] = {
+#if DTLS_CID_LENGTH > 1
+    /* the UDP payload starts at 0, A = shard index of a tls12_cid record */
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, DTLS_CT_TLS12_CID, 0, 2),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 11),
+    BPF_JUMP(BPF_JMP | BPF_JA, 14, 0, 0),
+#endif /* DTLS_CID_LENGTH > 1 */
+    /* A = IP version */
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF),
+    BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 4),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 6, 5, 0),
+    /* IPv4: X = source port, A = source address */
+    BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, SKF_NET_OFF),
+    BPF_STMT(BPF_LD | BPF_H | BPF_IND, SKF_NET_OFF),
+    BPF_STMT(BPF_MISC | BPF_TAX, 0),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+    BPF_JUMP(BPF_JMP | BPF_JA, 3, 0, 0),
+    /* IPv6: X = source port, A = low word of source address */
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF + 40),
+    BPF_STMT(BPF_MISC | BPF_TAX, 0),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 20),
+    /* return shard index */
+    BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+    BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9e3779b1),
+    BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+    BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, count),
+    BPF_STMT(BPF_RET | BPF_A, 0)
+  };
+  struct sock_fprog prog = {
+    .len = sizeof(code) / sizeof(code[0]),
+    .filter = code
+  };
+
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                 &prog, sizeof(prog)) < 0) {
+    dtls_warn("setsockopt SO_ATTACH_REUSEPORT_CBPF: %s\n", strerror(errno));
+  }
+#else /* ! SO_ATTACH_REUSEPORT_CBPF */
+  (void)fd;
+  (void)count;
+#endif /* ! SO_ATTACH_REUSEPORT_CBPF */
+}
+
+int
+dtls_server_write(dtls_context_t *ctx, session_t *session,
+                  uint8 *buf, size_t len) {
+  dtls_server_shard_t *shard = dtls_get_app_data(ctx);
+
+  return sendto(shard->fd, buf, len, MSG_DONTWAIT,
+                &session->addr.sa, session->size);
+}
+
+void *
+dtls_server_get_app(dtls_context_t *ctx) {
+  dtls_server_shard_t *shard = dtls_get_app_data(ctx);
+  return shard->server->app;
+}
+
+unsigned int
+dtls_server_get_shard(dtls_context_t *ctx) {
+  dtls_server_shard_t *shard = dtls_get_app_data(ctx);
+  return shard->index;
+}
+
+unsigned int
+dtls_server_get_shards(const dtls_server_t *server) {
+  return server->count;
+}
+
+static void
+dtls_server_read(dtls_server_shard_t *shard) {
+  session_t session;
+  ssize_t len;
+  int n;
+
+  for (n = 0; n < DTLS_SERVER_RECV_BATCH; n++) {
+    memset(&session, 0, sizeof(session_t));
+    session.size = sizeof(session.addr);
+    len = recvfrom(shard->fd, shard->buf, sizeof(shard->buf), MSG_TRUNC,
+                   &session.addr.sa, &session.size);
+    if (len < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        dtls_warn("shard %u: recvfrom: %s\n", shard->index, strerror(errno));
+      return;
+    }
+    if ((size_t)len > sizeof(shard->buf)) {
+      dtls_warn("shard %u: %zd bytes exceeds buffer %d, drop message!\n",
+                shard->index, len, DTLS_MAX_BUF);
+      continue;
+    }
+    dtls_handle_message(shard->ctx, &session, shard->buf, len);
+  }
+}
+
+static void *
+dtls_server_worker(void *arg) {
+  dtls_server_shard_t *shard = (dtls_server_shard_t *)arg;
+  struct pollfd fds[2];
+  clock_time_t next;
+  dtls_tick_t now;
+  int timeout;
+
+  fds[0].fd = shard->fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = shard->server->wakeup[0];
+  fds[1].events = POLLIN;
+
+  while (1) {
+    dtls_check_retransmit(shard->ctx, &next);
+    timeout = -1;
+    if (next) {
+      dtls_ticks(&now);
+      if (DTLS_IS_BEFORE_TIME(next, now))
+        timeout = 0;
+      else
+        timeout = (int)((next - now) * 1000 / DTLS_TICKS_PER_SECOND) + 1;
+    }
+
+    if (poll(fds, 2, timeout) < 0) {
+      if (errno == EINTR)
+        continue;
+      dtls_crit("shard %u: poll: %s\n", shard->index, strerror(errno));
+      break;
+    }
+
+    if (fds[1].revents)
+      break;
+
+    if (fds[0].revents & POLLIN)
+      dtls_server_read(shard);
+  }
+
+  return NULL;
+}
+
+/* Returns the share of one of @p count shards of @p limit, at least 1
+ * unless there is no limit. */
+static unsigned int
+dtls_server_share(unsigned int limit, unsigned int count) {
+  if (!limit)
+    return 0;
+  return limit / count ? limit / count : 1;
+}
+
+dtls_server_t *
+dtls_server_new(const dtls_server_config_t *config) {
+  dtls_server_t *server;
+  unsigned int i;
+
+  if (!config || !config->handler) {
+    return NULL;
+  }
+
+  server = (dtls_server_t *)calloc(1, sizeof(dtls_server_t));
+  if (!server) {
+    dtls_crit("cannot allocate server\n");
+    return NULL;
+  }
+
+  server->app = config->app;
+  server->count = config->shards ? config->shards : dtls_server_default_shards();
+  if (server->count > DTLS_SERVER_MAX_SHARDS) {
+    dtls_warn("limit number of shards to %d\n", DTLS_SERVER_MAX_SHARDS);
+    server->count = DTLS_SERVER_MAX_SHARDS;
+  }
+  server->wakeup[0] = server->wakeup[1] = -1;
+
+  server->shards = (dtls_server_shard_t *)calloc(server->count,
+                                                 sizeof(dtls_server_shard_t));
+  if (!server->shards) {
+    dtls_crit("cannot allocate %u shards\n", server->count);
+    free(server);
+    return NULL;
+  }
+  for (i = 0; i < server->count; i++) {
+    server->shards[i].fd = -1;
+  }
+
+  if (pipe(server->wakeup) < 0) {
+    dtls_alert("pipe: %s\n", strerror(errno));
+    goto error;
+  }
+
+  for (i = 0; i < server->count; i++) {
+    dtls_server_shard_t *shard = &server->shards[i];
+
+    shard->server = server;
+    shard->index = i;
+    shard->handler = *config->handler;
+    if (!shard->handler.write)
+      shard->handler.write = dtls_server_write;
+
+    shard->fd = dtls_server_socket(&config->listen);
+    if (shard->fd < 0)
+      goto error;
+
+    shard->ctx = dtls_new_context(shard);
+    if (!shard->ctx)
+      goto error;
+    dtls_set_handler(shard->ctx, &shard->handler);
+#if DTLS_CID_LENGTH > 1
+    if (server->count > 1) {
+      /* see dtls_server_attach_steering() */
+      uint8 prefix = i;
+
+      dtls_set_cid_prefix(shard->ctx, &prefix, sizeof(prefix));
+    }
+#endif /* DTLS_CID_LENGTH > 1 */
+
+    if (config->limits) {
+      dtls_peer_limits_t limits = *config->limits;
+
+      limits.max_peers = dtls_server_share(limits.max_peers, server->count);
+      limits.max_handshakes = dtls_server_share(limits.max_handshakes,
+                                                server->count);
+      dtls_set_peer_limits(shard->ctx, &limits);
+    }
+  }
+
+  if (server->count > 1)
+    dtls_server_attach_steering(server->shards[0].fd, server->count);
+
+  return server;
+
+ error:
+  dtls_server_free(server);
+  return NULL;
+}
+
+int
+dtls_server_start(dtls_server_t *server) {
+  unsigned int i;
+  int err;
+
+  for (i = 0; i < server->count; i++) {
+    dtls_server_shard_t *shard = &server->shards[i];
+
+    if (shard->started)
+      continue;
+    err = pthread_create(&shard->thread, NULL, dtls_server_worker, shard);
+    if (err) {
+      dtls_alert("cannot start shard %u: %s\n", i, strerror(err));
+      dtls_server_stop(server);
+      return -1;
+    }
+    shard->started = 1;
+  }
+  dtls_info("started %u shards\n", server->count);
+  return 0;
+}
+
+void
+dtls_server_stop(dtls_server_t *server) {
+  static const uint8 stop = 0;
+  unsigned int i;
+
+  if (!server || server->wakeup[1] < 0)
+    return;
+
+  /* The pipe is never read, so it stays readable for all shards. */
+  if (write(server->wakeup[1], &stop, sizeof(stop)) < 0)
+    dtls_warn("cannot signal shards: %s\n", strerror(errno));
+
+  for (i = 0; i < server->count; i++) {
+    if (server->shards[i].started) {
+      pthread_join(server->shards[i].thread, NULL);
+      server->shards[i].started = 0;
+    }
+  }
+
+  /* drain the pipe to allow a restart */
+  close(server->wakeup[0]);
+  close(server->wakeup[1]);
+  if (pipe(server->wakeup) < 0) {
+    dtls_warn("pipe: %s\n", strerror(errno));
+    server->wakeup[0] = server->wakeup[1] = -1;
+  }
+}
+
+void
+dtls_server_free(dtls_server_t *server) {
+  unsigned int i;
+
+  if (!server)
+    return;
+
+  dtls_server_stop(server);
+
+  for (i = 0; i < server->count; i++) {
+    dtls_server_shard_t *shard = &server->shards[i];
+
+    if (shard->ctx)
+      dtls_free_context(shard->ctx);
+    if (shard->fd >= 0)
+      close(shard->fd);
+  }
+
+  if (server->wakeup[0] >= 0)
+    close(server->wakeup[0]);
+  if (server->wakeup[1] >= 0)
+    close(server->wakeup[1]);
+
+  free(server->shards);
+  free(server);
+}
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/**
+ * @file dtls_server.h
+ * @brief Sharded multi-threaded DTLS server runtime for POSIX systems
+ */
+
+#ifndef _DTLS_SERVER_H_
+#define _DTLS_SERVER_H_
+
+#include "tinydtls.h"
+#include "dtls.h"
+
+/**
+ * @defgroup dtls_server Sharded server runtime
+ *
+ * Runs a DTLS server on a number of worker threads (shards). Each
+ * shard owns a UDP socket bound to the same local address with
+ * SO_REUSEPORT, a ::dtls_context_t and therefore its own peer table,
+ * so shards never share mutable state. On Linux, a reuseport steering
+ * program is attached that selects the shard from the client address
+ * and port, so all records of one client are handled by the same
+ * shard. With DTLS_CID_LENGTH set, records with a connection id are
+ * steered by the shard index in its first byte, see
+ * dtls_set_cid_prefix(), and still reach their shard when the client's
+ * address changes.
+ *
+ * The callback handlers are invoked from the worker thread of the
+ * shard that owns the peer. The handlers are shared by all shards and
+ * must therefore be thread-safe with respect to the application's own
+ * data.
+ * @{
+ */
+
+/** Configuration of a sharded server, passed to dtls_server_new(). */
+typedef struct dtls_server_config_t {
+  session_t listen;		/**< local address and port to bind to */
+  unsigned int shards;		/**< number of shards, 0 for one per online CPU */
+  dtls_handler_t *handler;	/**< callback handlers for all shards */
+  void *app;			/**< application-specific data */
+  /** peer limits of all shards together, which are divided evenly
+   *  among the shards, or NULL for the defaults */
+  const dtls_peer_limits_t *limits;
+} dtls_server_config_t;
+
+typedef struct dtls_server_t dtls_server_t;
+
+/**
+ * Creates a new sharded server for @p config. The sockets of all
+ * shards are bound, but no worker thread is started yet. If
+ * dtls_handler_t::write is @c NULL, dtls_server_write() is used for
+ * sending. dtls_init() must have been called before.
+ *
+ * @param config The server configuration.
+ * @return The new server or @c NULL on error.
+ */
+dtls_server_t *dtls_server_new(const dtls_server_config_t *config);
+
+/**
+ * Starts one worker thread per shard.
+ *
+ * @return @c 0 on success, or less than zero on error. In the latter
+ *   case, all worker threads that were started are stopped again.
+ */
+int dtls_server_start(dtls_server_t *server);
+
+/**
+ * Signals all worker threads to terminate and waits for them. This
+ * function may be called from any thread except the worker threads.
+ */
+void dtls_server_stop(dtls_server_t *server);
+
+/**
+ * Stops @p server if required and releases all resources including
+ * the DTLS contexts of all shards.
+ */
+void dtls_server_free(dtls_server_t *server);
+
+/** Returns the number of shards of @p server. */
+unsigned int dtls_server_get_shards(const dtls_server_t *server);
+
+/**
+ * Returns the application data passed in dtls_server_config_t::app
+ * for a context @p ctx that belongs to a shard of a server.
+ */
+void *dtls_server_get_app(dtls_context_t *ctx);
+
+/**
+ * Returns the index of the shard that owns @p ctx, in the range
+ * from @c 0 to dtls_server_get_shards() - 1.
+ */
+unsigned int dtls_server_get_shard(dtls_context_t *ctx);
+
+/**
+ * Sends @p len bytes from @p buf to @p session through the socket of
+ * the shard that owns @p ctx. This function is suitable as
+ * dtls_handler_t::write.
+ */
+int dtls_server_write(dtls_context_t *ctx, session_t *session,
+                      uint8 *buf, size_t len);
+
+/** @} */
+
+#endif /* _DTLS_SERVER_H_ */
@@ -57,6 +57,15 @@ typedef unsigned char uint48[6];
 #endif /* WITH_CONTIKI || RIOT_VERSION */
 #endif
 
+#ifndef DTLS_RECORD_SIZE_LIMIT
+/** Largest plaintext of a protected record that is accepted,
+ *  announced with the record_size_limit extension (RFC 8449). 0, the
+ *  default, neither sends nor answers the extension. What fits into
+ *  DTLS_MAX_BUF together with the record header, the explicit nonce
+ *  and a MAC of 16 bytes is (DTLS_MAX_BUF - 13 - 8 - 16). */
+#define DTLS_RECORD_SIZE_LIMIT 0
+#endif
+
 /*
  * DTLS send buf is alloctaed on the stack by default
  */
@@ -71,6 +80,194 @@ typedef unsigned char uint48[6];
 #define DTLS_DEFAULT_MAX_RETRANSMIT 7
 #endif
 
+#ifndef DTLS_DEFERRED_RECORDS_MAX
+/** Number of records buffered per peer while a crypto job is pending. */
+#define DTLS_DEFERRED_RECORDS_MAX 4
+#endif
+
+#ifndef DTLS_HANDSHAKE_WINDOW
+/** Number of handshake messages, starting with the next expected
+ *  one, that are buffered per peer for reordering and reassembly. */
+#define DTLS_HANDSHAKE_WINDOW 8
+#endif
+
+#ifndef DTLS_NEXT_EPOCH_RECORDS_MAX
+/** Number of records of the next epoch buffered per peer until its
+ *  ChangeCipherSpec arrives. */
+#define DTLS_NEXT_EPOCH_RECORDS_MAX 2
+#endif
+
+#ifndef DTLS_EARLY_DATA_RECORDS_MAX
+/** Number of application data records buffered per peer that arrive
+ *  before the Finished message completing the handshake. */
+#define DTLS_EARLY_DATA_RECORDS_MAX 2
+#endif
+
+#ifndef DTLS_CACHE_LINE_SIZE
+/** Alignment of peers allocated with malloc on POSIX systems. */
+#define DTLS_CACHE_LINE_SIZE 64
+#endif
+
+#ifndef DTLS_POOL_SLAB
+/**
+ * Number of objects added to a context's pool when it is empty, see
+ * dtls_alloc.h. With 0, all objects are allocated individually.
+ */
+#define DTLS_POOL_SLAB 16
+#endif
+
+#ifndef DTLS_PEERS_LIMIT
+/** Default maximum number of peers per context, 0 for no limit. See
+ *  dtls_set_peer_limits(). */
+#define DTLS_PEERS_LIMIT 0
+#endif
+
+#ifndef DTLS_HANDSHAKES_LIMIT
+/** Default maximum number of peers per context that have not
+ *  completed their first handshake, 0 for no limit. */
+#define DTLS_HANDSHAKES_LIMIT 0
+#endif
+
+#ifndef DTLS_PEER_EVICT_IDLE
+/** Default minimum time in seconds without an authenticated record,
+ *  before an established peer may be evicted for a new one. */
+#define DTLS_PEER_EVICT_IDLE 0
+#endif
+
+#ifndef DTLS_PEER_IDLE_TIMEOUT
+/** Default time in seconds without an authenticated record, after
+ *  which an established peer is removed, 0 to keep it. */
+#define DTLS_PEER_IDLE_TIMEOUT 0
+#endif
+
+#ifndef DTLS_HANDSHAKE_TIMEOUT
+/** Default time in seconds after which a peer is removed if its first
+ *  handshake has not completed, 0 for no deadline. */
+#define DTLS_HANDSHAKE_TIMEOUT 0
+#endif
+
+#ifndef DTLS_RTO_INITIAL
+/** Default retransmission timeout in milliseconds of a flight without
+ *  a round-trip time estimate. See dtls_set_rto_config(). */
+#define DTLS_RTO_INITIAL 2000
+#endif
+
+#ifndef DTLS_RTO_MIN
+/** Default lower bound in milliseconds of the estimated
+ *  retransmission timeout. */
+#define DTLS_RTO_MIN 200
+#endif
+
+#ifndef DTLS_RTO_MAX
+/** Default upper bound in milliseconds of the retransmission
+ *  timeout. */
+#define DTLS_RTO_MAX 60000
+#endif
+
+#ifndef DTLS_DEFAULT_MTU
+/** Default size limit of the datagrams that carry the records of a
+ *  flight, the minimum IPv6 MTU of 1280 bytes less the IPv6 and UDP
+ *  headers. */
+#define DTLS_DEFAULT_MTU (DTLS_MAX_BUF < 1232 ? DTLS_MAX_BUF : 1232)
+#endif
+
+#ifndef DTLS_RTO_JITTER
+/** Default random extension in percent of the timeout of a flight,
+ *  so that flights sent together are not retransmitted together. */
+#define DTLS_RTO_JITTER 25
+#endif
+
+#ifndef DTLS_RETRANSMIT_BYTES_PER_SECOND
+/** Default limit of the bytes retransmitted per second by a context,
+ *  0 for no limit. */
+#define DTLS_RETRANSMIT_BYTES_PER_SECOND 0
+#endif
+
+#ifndef DTLS_RETRANSMIT_DATAGRAMS_PER_SECOND
+/** Default limit of the datagrams retransmitted per second by a
+ *  context, 0 for no limit. */
+#define DTLS_RETRANSMIT_DATAGRAMS_PER_SECOND 0
+#endif
+
+#ifndef DTLS_PEER_TABLE_MIGRATE
+/** Number of slots moved per update while the peer table is resized,
+ *  see DTLS_PEERS_OPENHASH. */
+#define DTLS_PEER_TABLE_MIGRATE 32
+#endif
+
+#ifndef DTLS_TIMER_WHEEL_BITS
+/** Each level of the retransmission timer wheel has 2^bits slots,
+ *  at most 6. See netq_wheel_t. */
+#if (defined(WITH_CONTIKI) || defined(RIOT_VERSION))
+#define DTLS_TIMER_WHEEL_BITS 4
+#else /* WITH_CONTIKI || RIOT_VERSION */
+#define DTLS_TIMER_WHEEL_BITS 6
+#endif /* WITH_CONTIKI || RIOT_VERSION */
+#endif
+
+#ifndef DTLS_TIMER_WHEEL_LEVELS
+/** Number of levels of the retransmission timer wheel. */
+#define DTLS_TIMER_WHEEL_LEVELS 4
+#endif
+
+#ifndef DTLS_SESSION_CACHE_SIZE
+/** Number of sessions per context that may be resumed with an
+ *  abbreviated handshake. The entries are part of dtls_context_t, 0,
+ *  the default, disables the session cache. */
+#define DTLS_SESSION_CACHE_SIZE 0
+#endif
+
+#ifndef DTLS_SESSION_LIFETIME
+/** Default time in seconds after its full handshake, for which a
+ *  session may be resumed. See dtls_set_session_lifetime(). */
+#define DTLS_SESSION_LIFETIME 86400
+#endif
+
+#ifndef DTLS_SESSION_TICKET_LENGTH
+/** Maximum length of a session ticket (RFC 5077) a client keeps for
+ *  a server. The tickets of a tinydtls server have 95 bytes. 0, the
+ *  default, disables session tickets. Clients also need
+ *  DTLS_SESSION_CACHE_SIZE to keep their tickets. */
+#define DTLS_SESSION_TICKET_LENGTH 0
+#endif
+
+#ifndef DTLS_VALIDATED_ADDRESSES
+/** Number of client addresses a server context remembers after their
+ *  cookie exchange, see dtls_set_address_validation(). 0, the default,
+ *  disables it and keeps the addresses out of dtls_context_t. */
+#define DTLS_VALIDATED_ADDRESSES 0
+#endif
+
+#ifndef DTLS_CID_LENGTH
+/** Length of the connection ids (RFC 9146) a context asks its peers
+ *  to send in their records, so that they are found after an address
+ *  change. 0, the default, asks for none and peers are only found by
+ *  their address. */
+#define DTLS_CID_LENGTH 0
+#endif
+
+#ifndef DTLS_MAX_CID_LENGTH
+/** Maximum length of a connection id, of those a peer asks for as
+ *  well as of our own. 0 disables connection ids, and the
+ *  connection_id extension is neither sent nor answered. Defaults to
+ *  16 if DTLS_CID_LENGTH is set. Clients that keep their address, but
+ *  send the connection id of the server, set only this one. */
+#if DTLS_CID_LENGTH > 0
+#define DTLS_MAX_CID_LENGTH 16
+#else /* DTLS_CID_LENGTH > 0 */
+#define DTLS_MAX_CID_LENGTH 0
+#endif /* DTLS_CID_LENGTH > 0 */
+#endif
+
+#if DTLS_CID_LENGTH > DTLS_MAX_CID_LENGTH
+#error "DTLS_CID_LENGTH exceeds DTLS_MAX_CID_LENGTH"
+#endif
+
+#ifndef DTLS_SESSION_LOCKS
+/** Number of lock stripes per context with DTLS_CONCURRENT_PEERS. */
+#define DTLS_SESSION_LOCKS 64
+#endif
+
 /** Known cipher suites.*/
 typedef enum { 
   TLS_NULL_WITH_NULL_NULL = 0x0000,   /**< NULL cipher  */
@@ -93,6 +290,9 @@ typedef enum {
 #define TLS_EXT_SERVER_CERTIFICATE_TYPE	20 /* see RFC 7250 */
 #define TLS_EXT_ENCRYPT_THEN_MAC	22 /* see RFC 7366 */
 #define TLS_EXT_EXTENDED_MASTER_SECRET	23 /* see RFC 7627 */
+#define TLS_EXT_RECORD_SIZE_LIMIT	28 /* see RFC 8449 */
+#define TLS_EXT_SESSION_TICKET		35 /* see RFC 5077 */
+#define TLS_EXT_CONNECTION_ID		54 /* see RFC 9146 */
 #define TLS_EXT_RENEGOTIATION_INFO	65281 /* see RFC 5746 */
 
 #define TLS_CERT_TYPE_RAW_PUBLIC_KEY	2 /* see RFC 7250 */
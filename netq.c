@@ -28,21 +28,22 @@
 #endif
 #endif
 
+/* marks nodes that are not in a netq_wheel_t */
+#define WHEEL_NONE 0xfe
+
 #ifdef WITH_ZEPHYR
 LOG_MODULE_DECLARE(TINYDTLS, CONFIG_TINYDTLS_LOG_LEVEL);
 #endif /* WITH_ZEPHYR */
 
 #if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION))
-#include <stdlib.h>
-
 static inline netq_t *
-netq_malloc_node(size_t size) {
-  return (netq_t *)malloc(sizeof(netq_t) + size);
+netq_malloc_node(dtls_mem_t *mem, size_t size) {
+  return (netq_t *)dtls_mem_alloc(mem, DTLS_POOL_NETQ, sizeof(netq_t) + size);
 }
 
 static inline void
 netq_free_node(netq_t *node) {
-  free(node);
+  dtls_mem_release(node);
 }
 
 #elif defined (WITH_CONTIKI) /* WITH_CONTIKI */
@@ -51,7 +52,8 @@ netq_free_node(netq_t *node) {
 MEMB(netq_storage, netq_t, NETQ_MAXCNT);
 
 static inline netq_t *
-netq_malloc_node(size_t size) {
+netq_malloc_node(dtls_mem_t *mem, size_t size) {
+  (void) mem;
   return (netq_t *)memb_alloc(&netq_storage);
 }
 
@@ -72,7 +74,8 @@ netq_t netq_storage_data[NETQ_MAXCNT];
 memarray_t netq_storage;
 
 static inline netq_t *
-netq_malloc_node(size_t size) {
+netq_malloc_node(dtls_mem_t *mem, size_t size) {
+  (void) mem;
   (void) size;
   return (netq_t *)memarray_alloc(&netq_storage);
 }
@@ -144,12 +147,13 @@ netq_t *netq_pop_first(netq_t **queue) {
 }
 
 netq_t *
-netq_node_new(size_t size) {
+netq_node_new(dtls_mem_t *mem, size_t size) {
   netq_t *node;
-  node = netq_malloc_node(size);
+  node = netq_malloc_node(mem, size);
 
   if (node) {
     memset(node, 0, sizeof(netq_t));
+    node->level = WHEEL_NONE;
   } else {
     dtls_warn("netq_node_new: malloc\n");
   }
@@ -163,6 +167,16 @@ netq_node_free(netq_t *node) {
     netq_free_node(node);
 }
 
+void
+netq_flight_free(netq_t *node) {
+  netq_t *next;
+
+  for (; node; node = next) {
+    next = node->flight_next;
+    netq_free_node(node);
+  }
+}
+
 void 
 netq_delete_all(netq_t **queue) {
   netq_t *p, *tmp;
@@ -174,3 +188,214 @@ netq_delete_all(netq_t **queue) {
     *queue = NULL;
   }
 }
+
+#define WHEEL_MASK ((uint64_t)NETQ_WHEEL_SLOTS - 1)
+#define WHEEL_ALL (NETQ_WHEEL_SLOTS == 64 ? ~(uint64_t)0 : \
+                   ((uint64_t)1 << (NETQ_WHEEL_SLOTS & 63)) - 1)
+#define WHEEL_SPAN ((dtls_tick_t)1 << (DTLS_TIMER_WHEEL_LEVELS * DTLS_TIMER_WHEEL_BITS))
+/* marks nodes in wheel->expired */
+#define WHEEL_EXPIRED 0xff
+
+/* slot index of time-stamp t at level */
+#define wheel_index(T, Level) \
+  ((unsigned int)(((T) >> ((Level) * DTLS_TIMER_WHEEL_BITS)) & WHEEL_MASK))
+
+static inline unsigned int
+wheel_first(uint64_t m) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(m);
+#else /* ! __GNUC__ */
+  unsigned int n = 0;
+
+  while (!(m & 1)) {
+    m >>= 1;
+    n++;
+  }
+  return n;
+#endif /* ! __GNUC__ */
+}
+
+/* rotates the slot bits m right by r */
+static inline uint64_t
+wheel_rotate(uint64_t m, unsigned int r) {
+  return r ? ((m >> r) | (m << (NETQ_WHEEL_SLOTS - r))) & WHEEL_ALL : m;
+}
+
+void
+netq_wheel_init(netq_wheel_t *wheel, dtls_tick_t now) {
+  memset(wheel, 0, sizeof(netq_wheel_t));
+  wheel->now = now;
+}
+
+void
+netq_wheel_insert(netq_wheel_t *wheel, netq_t *node) {
+  dtls_tick_t t = node->t;
+  dtls_tick_t delta;
+  unsigned int level = 0;
+
+  assert(node);
+
+  if (DTLS_IS_BEFORE_TIME(t, wheel->now)) {
+    node->level = WHEEL_EXPIRED;
+    DL_APPEND(wheel->expired, node);
+    return;
+  }
+
+  delta = t - wheel->now;
+  if (delta >= WHEEL_SPAN) {
+    /* re-added when the last slot is reached */
+    delta = WHEEL_SPAN - 1;
+    t = wheel->now + delta;
+  }
+  while (level < DTLS_TIMER_WHEEL_LEVELS - 1 &&
+         (delta >> ((level + 1) * DTLS_TIMER_WHEEL_BITS))) {
+    level++;
+  }
+
+  node->level = level;
+  node->slot = wheel_index(t, level);
+  DL_APPEND(wheel->slots[level][node->slot], node);
+  wheel->pending[level] |= (uint64_t)1 << node->slot;
+}
+
+void
+netq_wheel_remove(netq_wheel_t *wheel, netq_t *node) {
+  assert(node);
+
+  if (node->level == WHEEL_NONE) {
+    return;
+  } else if (node->level == WHEEL_EXPIRED) {
+    DL_DELETE(wheel->expired, node);
+  } else {
+    netq_t **slot = &wheel->slots[node->level][node->slot];
+
+    DL_DELETE(*slot, node);
+    if (!*slot)
+      wheel->pending[node->level] &= ~((uint64_t)1 << node->slot);
+  }
+  node->next = node->prev = NULL;
+  node->level = WHEEL_NONE;
+}
+
+/* Moves the nodes of all slots passed between wheel->now and now to a
+ * lower level, or to the expired list. */
+static void
+wheel_advance(netq_wheel_t *wheel, dtls_tick_t now) {
+  netq_t *todo = NULL, *node, *tmp;
+  dtls_tick_t old = wheel->now;
+  unsigned int level;
+
+  if (old == now || !DTLS_IS_BEFORE_TIME(old, now))
+    return;
+
+  wheel->now = now;
+  for (level = 0; level < DTLS_TIMER_WHEEL_LEVELS; level++) {
+    unsigned int shift = level * DTLS_TIMER_WHEEL_BITS;
+    unsigned int start = (wheel_index(old, level) + 1) & WHEEL_MASK;
+    dtls_tick_t passed = (now >> shift) - (old >> shift);
+    uint64_t m;
+
+    if (!passed)
+      break;                    /* higher levels are unchanged */
+
+    if (passed >= NETQ_WHEEL_SLOTS) {
+      m = WHEEL_ALL;
+    } else {
+      /* the slots after the one of old up to the one of now */
+      m = wheel_rotate(((uint64_t)1 << passed) - 1,
+                       (NETQ_WHEEL_SLOTS - start) & WHEEL_MASK);
+    }
+    m &= wheel->pending[level];
+    wheel->pending[level] &= ~m;
+    /* in the order the slots are reached, so that nodes expire in
+     * the order of their time-stamps */
+    for (m = wheel_rotate(m, start); m; m &= m - 1) {
+      netq_t **slot = &wheel->slots[level][(wheel_first(m) + start) & WHEEL_MASK];
+
+      DL_CONCAT(todo, *slot);
+      *slot = NULL;
+    }
+  }
+
+  DL_FOREACH_SAFE(todo, node, tmp) {
+    node->next = node->prev = NULL;
+    netq_wheel_insert(wheel, node);
+  }
+}
+
+netq_t *
+netq_wheel_peek(netq_wheel_t *wheel, dtls_tick_t now) {
+  wheel_advance(wheel, now);
+  return wheel->expired;
+}
+
+netq_t *
+netq_wheel_pop(netq_wheel_t *wheel, dtls_tick_t now) {
+  netq_t *node;
+
+  node = netq_wheel_peek(wheel, now);
+  if (node) {
+    DL_DELETE(wheel->expired, node);
+    node->next = node->prev = NULL;
+    node->level = WHEEL_NONE;
+  }
+  return node;
+}
+
+int
+netq_wheel_next(const netq_wheel_t *wheel, dtls_tick_t *t) {
+  unsigned int level;
+  int found = 0;
+
+  if (wheel->expired) {
+    *t = wheel->now;
+    return 1;
+  }
+
+  for (level = 0; level < DTLS_TIMER_WHEEL_LEVELS; level++) {
+    /* the slots of a level are reached in order, starting after the
+     * current one */
+    unsigned int shift = level * DTLS_TIMER_WHEEL_BITS;
+    unsigned int start = (wheel_index(wheel->now, level) + 1) & WHEEL_MASK;
+    uint64_t m = wheel_rotate(wheel->pending[level], start);
+    dtls_tick_t reached;
+    netq_t *node;
+
+    if (!m)
+      continue;
+
+    /* nodes beyond the span of the wheel are re-added when their slot
+     * is reached */
+    reached = ((wheel->now >> shift) + wheel_first(m) + 1) << shift;
+    DL_FOREACH(wheel->slots[level][(wheel_first(m) + start) & WHEEL_MASK], node) {
+      dtls_tick_t expires = (node->t >> shift) == (reached >> shift) ?
+        node->t : reached;
+
+      if (!found || DTLS_IS_BEFORE_TIME(expires, *t)) {
+        *t = expires;
+        found = 1;
+      }
+    }
+  }
+  return found;
+}
+
+void
+netq_wheel_delete_all(netq_wheel_t *wheel) {
+  unsigned int level, slot;
+  netq_t *node, *tmp;
+
+  for (level = 0; level < DTLS_TIMER_WHEEL_LEVELS; level++) {
+    for (slot = 0; slot < NETQ_WHEEL_SLOTS; slot++) {
+      DL_FOREACH_SAFE(wheel->slots[level][slot], node, tmp) {
+        netq_flight_free(node);
+      }
+      wheel->slots[level][slot] = NULL;
+    }
+    wheel->pending[level] = 0;
+  }
+  DL_FOREACH_SAFE(wheel->expired, node, tmp) {
+    netq_flight_free(node);
+  }
+  wheel->expired = NULL;
+}
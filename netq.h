@@ -20,7 +20,8 @@
 
 #include "tinydtls.h"
 #include "global.h"
-#include "dtls.h"
+#include "peer.h"
+#include "dtls_alloc.h"
 #include "dtls_time.h"
 
 /**
@@ -44,7 +45,8 @@
  */
 typedef enum netq_job_type_t {
   RESEND, 	/**< resend related message on timeout */
-  TIMEOUT 	/**< timeout of the related alert */
+  TIMEOUT, 	/**< timeout of the related alert */
+  FINISHED	/**< keep the last flight of a handshake until timeout */
 } netq_job_type_t;
 
 /** 
@@ -54,13 +56,22 @@ typedef unsigned char netq_packet_t[DTLS_MAX_BUF];
 
 typedef struct netq_t {
   struct netq_t *next;
+  struct netq_t *prev;		/**< previous node in a slot of a netq_wheel_t */
+  struct netq_t *flight_next;	/**< next node of the same flight, see dtls_peer_t::retransmit */
+  uint8_t level;		/**< level of the node in a netq_wheel_t */
+  uint8_t slot;			/**< slot of the node in a netq_wheel_t */
 
   clock_time_t t;	        /**< when to send PDU for the next time */
+  clock_time_t sent;		/**< when the PDU was sent the last time */
+  size_t flushed;		/**< bytes of a flight that have been sent */
   unsigned int timeout;		/**< randomized timeout value */
 
   netq_job_type_t job;		/**< job to be executed on timeout */
 
   dtls_peer_t *peer;		/**< remote address */
+#ifdef DTLS_CONCURRENT_PEERS
+  session_t session;		/**< session of peer when queued */
+#endif /* DTLS_CONCURRENT_PEERS */
   uint16_t epoch;
   uint8_t type;
   unsigned char retransmit_cnt;	/**< retransmission counter, will be removed when zero */
@@ -95,11 +106,17 @@ int netq_insert_node(netq_t **queue, netq_t *node);
  * for the associated datagram. */
 void netq_node_free(netq_t *node);
 
+/** Frees @p node and the nodes linked to it by netq_t::flight_next. */
+void netq_flight_free(netq_t *node);
+
 /** Removes all items from given queue and frees the allocated storage */
 void netq_delete_all(netq_t **queue);
 
-/** Creates a new node suitable for adding to a netq_t queue. */
-netq_t *netq_node_new(size_t size);
+/**
+ * Creates a new node suitable for adding to a netq_t queue, taken
+ * from the pool @p mem if not @c NULL.
+ */
+netq_t *netq_node_new(dtls_mem_t *mem, size_t size);
 
 /**
  * Returns a pointer to the first item in given queue or NULL if
@@ -117,6 +134,65 @@ void netq_remove(netq_t **queue, netq_t *p);
  */
 netq_t *netq_pop_first(netq_t **queue);
 
+#define NETQ_WHEEL_SLOTS (1 << DTLS_TIMER_WHEEL_BITS)
+
+#if DTLS_TIMER_WHEEL_BITS > 6
+#error "DTLS_TIMER_WHEEL_BITS must not exceed 6"
+#endif
+
+/**
+ * Hashed hierarchical timer wheel that holds netq_t nodes by their
+ * time-stamp t. A node is kept at the level whose slot width matches
+ * the time left until t, and is moved to a lower level once the time
+ * reaches its slot. Adding and removing a node is O(1), independent
+ * of the number of nodes. Nodes that are further in the future than
+ * the wheel spans are kept in the last slot of the highest level and
+ * are re-added when that slot is reached.
+ */
+typedef struct netq_wheel_t {
+  dtls_tick_t now;              /**< time of the last netq_wheel_pop() */
+  uint64_t pending[DTLS_TIMER_WHEEL_LEVELS]; /**< one bit per non-empty slot */
+  netq_t *slots[DTLS_TIMER_WHEEL_LEVELS][NETQ_WHEEL_SLOTS];
+  netq_t *expired;              /**< nodes due at now */
+} netq_wheel_t;
+
+/** Initializes the empty timer wheel @p wheel at time @p now. */
+void netq_wheel_init(netq_wheel_t *wheel, dtls_tick_t now);
+
+/** Adds @p node to @p wheel, to expire at node->t. */
+void netq_wheel_insert(netq_wheel_t *wheel, netq_t *node);
+
+/** Removes @p node from @p wheel. Nothing is done if @p node is not
+ *  in a wheel. */
+void netq_wheel_remove(netq_wheel_t *wheel, netq_t *node);
+
+/**
+ * Advances @p wheel to @p now, and returns one node whose time-stamp
+ * is not after @p now without removing it. This is the node that
+ * netq_wheel_pop() would return. This function returns @c NULL if no
+ * node has expired.
+ */
+netq_t *netq_wheel_peek(netq_wheel_t *wheel, dtls_tick_t now);
+
+/**
+ * Advances @p wheel to @p now, and removes and returns one node whose
+ * time-stamp is not after @p now. This function returns @c NULL if no
+ * node has expired.
+ */
+netq_t *netq_wheel_pop(netq_wheel_t *wheel, dtls_tick_t now);
+
+/**
+ * Sets @p t to the earliest time-stamp of all nodes in @p wheel. If
+ * nodes beyond the span of the wheel are pending, @p t may be the
+ * earlier time at which they are moved. This function returns @c 0 if
+ * @p wheel is empty, and non-zero otherwise.
+ */
+int netq_wheel_next(const netq_wheel_t *wheel, dtls_tick_t *t);
+
+/** Removes all nodes from @p wheel and frees them with
+ *  netq_flight_free(). */
+void netq_wheel_delete_all(netq_wheel_t *wheel);
+
 /**@}*/
 
 #endif /* _DTLS_NETQ_H_ */
@@ -15,6 +15,8 @@
  *
  *******************************************************************************/
 
+#include "tinydtls.h"
+
 #include <string.h>
 
 #include "global.h"
@@ -27,16 +29,15 @@ void peer_init(void)
 }
 
 static inline dtls_peer_t *
-dtls_malloc_peer(void) {
-  return (dtls_peer_t *)malloc(sizeof(dtls_peer_t));
+dtls_malloc_peer(dtls_mem_t *mem) {
+  return (dtls_peer_t *)dtls_mem_alloc(mem, DTLS_POOL_PEER, sizeof(dtls_peer_t));
 }
 
 void
 dtls_free_peer(dtls_peer_t *peer) {
   dtls_handshake_free(peer->handshake_params);
-  dtls_security_free(peer->security_params[0]);
-  dtls_security_free(peer->security_params[1]);
-  free(peer);
+  dtls_security_free(peer->other_security);
+  dtls_mem_release(peer);
 }
 #elif defined (WITH_CONTIKI) /* WITH_CONTIKI */
 
@@ -49,15 +50,15 @@ peer_init(void) {
 }
 
 static inline dtls_peer_t *
-dtls_malloc_peer(void) {
+dtls_malloc_peer(dtls_mem_t *mem) {
+  (void) mem;
   return memb_alloc(&peer_storage);
 }
 
 void
 dtls_free_peer(dtls_peer_t *peer) {
   dtls_handshake_free(peer->handshake_params);
-  dtls_security_free(peer->security_params[0]);
-  dtls_security_free(peer->security_params[1]);
+  dtls_security_free(peer->other_security);
   memb_free(&peer_storage, peer);
 }
 
@@ -73,37 +74,38 @@ peer_init(void) {
 }
 
 static inline dtls_peer_t *
-dtls_malloc_peer(void) {
+dtls_malloc_peer(dtls_mem_t *mem) {
+  (void) mem;
   return memarray_alloc(&peer_storage);
 }
 
 void
 dtls_free_peer(dtls_peer_t *peer) {
   dtls_handshake_free(peer->handshake_params);
-  dtls_security_free(peer->security_params[0]);
-  dtls_security_free(peer->security_params[1]);
+  dtls_security_free(peer->other_security);
   memarray_free(&peer_storage, peer);
 }
 
 #endif /* WITH_CONTIKI */
 
 dtls_peer_t *
-dtls_new_peer(const session_t *session) {
+dtls_alloc_peer(dtls_mem_t *mem, const session_t *session) {
   dtls_peer_t *peer;
 
-  peer = dtls_malloc_peer();
+  peer = dtls_malloc_peer(mem);
   if (peer) {
     memset(peer, 0, sizeof(dtls_peer_t));
     memcpy(&peer->session, session, sizeof(session_t));
-    peer->security_params[0] = dtls_security_new();
-
-    if (!peer->security_params[0]) {
-      dtls_free_peer(peer);
-      return NULL;
-    }
+    dtls_session_key(session, &peer->key);
+    dtls_security_init(&peer->security);
 
     dtls_dsrv_log_addr(DTLS_LOG_DEBUG, "dtls_new_peer", session);
   }
 
   return peer;
 }
+
+dtls_peer_t *
+dtls_new_peer(const session_t *session) {
+  return dtls_alloc_peer(NULL, session);
+}
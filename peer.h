@@ -24,6 +24,7 @@
 #define _DTLS_PEER_H_
 
 #include <sys/types.h>
+#include <string.h>
 
 #include "tinydtls.h"
 #include "global.h"
@@ -31,31 +32,103 @@
 
 #include "state.h"
 #include "crypto.h"
+#include "dtls_time.h"
 
-#ifndef DTLS_PEERS_NOHASH
+#if defined(DTLS_PEERS_NOHASH) && defined(DTLS_PEERS_OPENHASH)
+#error "DTLS_PEERS_NOHASH and DTLS_PEERS_OPENHASH are mutually exclusive"
+#endif /* DTLS_PEERS_NOHASH && DTLS_PEERS_OPENHASH */
+
+#if defined(DTLS_PEERS_OPENHASH)
+#include "peer_table.h"
+#endif /* DTLS_PEERS_OPENHASH */
+#if !defined(DTLS_PEERS_NOHASH)
+/* the peer map, and the index of the connection ids */
 #include "uthash.h"
-#endif /* DTLS_PEERS_NOHASH */
+#endif /* ! DTLS_PEERS_NOHASH */
 
 typedef enum { DTLS_CLIENT=0, DTLS_SERVER } dtls_peer_type;
 
 /** 
  * Holds security parameters, local state and the transport address
- * for each peer. */
+ * for each peer.
+ *
+ * The members are ordered by access frequency. The peer map link,
+ * lookup key, state, LRU link and the security parameters of the
+ * current epoch (keys, sequence numbers and replay window) are used
+ * for every record and form a contiguous block at the start, which is aligned
+ * to DTLS_CACHE_LINE_SIZE if the peer is allocated with malloc on
+ * POSIX systems. The transport address follows; it is only passed to
+ * the callbacks. The security parameters of the next or previous
+ * epoch and the handshake state exist only during and shortly after
+ * a handshake and are allocated separately.
+ *
+ * On a 64-bit POSIX system, a connected peer uses one allocation of
+ * 368 bytes with the default uthash peer map, of which the first 184
+ * bytes (three cache lines) are accessed per record. With
+ * DTLS_PEERS_OPENHASH, the peer takes 320 bytes, of which 136 bytes
+ * are accessed per record, plus 9 bytes per slot of the peer table.
+ * Connection ids add 80 bytes with DTLS_CID_LENGTH 6, 16 with only
+ * DTLS_MAX_CID_LENGTH 16. */
 typedef struct dtls_peer_t {
-#ifdef DTLS_PEERS_NOHASH
+#if defined(DTLS_PEERS_NOHASH)
   struct dtls_peer_t *next;
-#else /* DTLS_PEERS_NOHASH */
+#elif defined(DTLS_PEERS_OPENHASH)
+  uint32_t hash;             /**< hash value of key, see dtls_peer_table_t */
+#else /* ! DTLS_PEERS_NOHASH && ! DTLS_PEERS_OPENHASH */
   UT_hash_handle hh;
-#endif /* DTLS_PEERS_NOHASH */
-
-  session_t session;	     /**< peer address and local interface */
+#endif /* ! DTLS_PEERS_NOHASH && ! DTLS_PEERS_OPENHASH */
+  dtls_session_key_t key;    /**< normalized session, used for lookup */
 
   dtls_peer_type role;       /**< denotes if this host is DTLS_CLIENT or DTLS_SERVER */
   dtls_state_t state;        /**< DTLS engine state */
-  int16_t optional_handshake_message; /**< optional next handshake message, DTLS_HT_NO_OPTIONAL_MESSAGE, if no optional message is expected. */
 
-  dtls_security_parameters_t *security_params[2];
+  /** neighbors in dtls_context_t::lru if established, otherwise in
+   *  dtls_context_t::handshakes */
+  struct dtls_peer_t *lru_prev;
+  struct dtls_peer_t *lru_next;
+  /** time of the last authenticated record if established, otherwise
+   *  the start of the handshake */
+  dtls_tick_t last_seen;
+  uint8_t established;       /**< the first handshake has completed */
+
+  dtls_security_parameters_t security; /**< the current epoch */
+  /** The next epoch during a handshake, or the previous epoch until a
+   *  record of the current epoch has been received. */
+  dtls_security_parameters_t *other_security;
   dtls_handshake_parameters_t *handshake_params;
+  /** The last flight sent to this peer, retransmitted as a whole from
+   *  dtls_context_t::sendqueue until the peer's next flight arrives.
+   *  Its messages are stored in the nodes linked by
+   *  netq_t::flight_next. Instead of a flight, a sent alert may be
+   *  pending here. */
+  struct netq_t *retransmit;
+  /** smoothed round-trip time of the flights in ticks, 0 if not
+   *  measured yet, see dtls_set_rto_config() */
+  dtls_tick_t srtt;
+  dtls_tick_t rttvar;        /**< round-trip time variation in ticks */
+
+  int16_t optional_handshake_message; /**< optional next handshake message, DTLS_HT_NO_OPTIONAL_MESSAGE, if no optional message is expected. */
+  /** size limit of the datagrams to this peer, 0 for
+   *  dtls_context_t::mtu, see dtls_set_peer_mtu() */
+  uint16_t mtu;
+  /** the largest plaintext of a protected record the peer accepts,
+   *  0 if it has not sent the record_size_limit extension */
+  uint16_t record_size_limit;
+#if DTLS_MAX_CID_LENGTH > 0
+  /** the length of the connection id the peer has asked for, which
+   *  is sent in the records of the negotiated epochs, see RFC 9146 */
+  uint8_t write_cid_length;
+  uint8_t write_cid[DTLS_MAX_CID_LENGTH];
+#endif /* DTLS_MAX_CID_LENGTH > 0 */
+#if DTLS_CID_LENGTH > 0
+  /** DTLS_CID_LENGTH if the peer has been given read_cid, 0 otherwise */
+  uint8_t read_cid_length;
+  uint8_t read_cid[DTLS_CID_LENGTH];
+#ifndef DTLS_PEERS_NOHASH
+  UT_hash_handle cid_hh;     /**< link in dtls_context_t::cid_peers */
+#endif /* ! DTLS_PEERS_NOHASH */
+#endif /* DTLS_CID_LENGTH > 0 */
+  session_t session;	     /**< peer address and local interface */
 } dtls_peer_t;
 
 /**
@@ -68,10 +141,10 @@ typedef struct dtls_ephemeral_peer_t {
 
 static inline dtls_security_parameters_t *dtls_security_params_epoch(dtls_peer_t *peer, uint16_t epoch)
 {
-  if (peer->security_params[0] && peer->security_params[0]->epoch == epoch) {
-    return peer->security_params[0];
-  } else if (peer->security_params[1] && peer->security_params[1]->epoch == epoch) {
-    return peer->security_params[1];
+  if (peer->security.epoch == epoch) {
+    return &peer->security;
+  } else if (peer->other_security && peer->other_security->epoch == epoch) {
+    return peer->other_security;
   } else {
     return NULL;
   }
@@ -90,48 +163,57 @@ static inline dtls_security_parameters_t *dtls_security_params_read_epoch(dtls_p
     if (peer->handshake_params->hs_state.read_epoch == epoch) {
     	return dtls_security_params_epoch(peer, epoch);
     }
-  } else if (peer->security_params[0] && peer->security_params[0]->epoch == epoch) {
-    return peer->security_params[0];
+  } else if (peer->security.epoch == epoch) {
+    return &peer->security;
   }
   return NULL;
 }
 
 static inline dtls_security_parameters_t *dtls_security_params(dtls_peer_t *peer)
 {
-  return peer->security_params[0];
+  return &peer->security;
 }
 
 static inline dtls_security_parameters_t *dtls_security_params_next(dtls_peer_t *peer)
 {
-  if (peer->security_params[1])
-    dtls_security_free(peer->security_params[1]);
+  if (peer->other_security)
+    dtls_security_free(peer->other_security);
 
-  peer->security_params[1] = dtls_security_new();
-  if (!peer->security_params[1]) {
+  peer->other_security = dtls_security_new(dtls_mem_owner(peer));
+  if (!peer->other_security) {
     return NULL;
   }
-  peer->security_params[1]->epoch = peer->security_params[0]->epoch + 1;
-  return peer->security_params[1];
+  peer->other_security->epoch = peer->security.epoch + 1;
+  return peer->other_security;
 }
 
 static inline void dtls_security_params_free_other(dtls_peer_t *peer)
 {
-  dtls_security_parameters_t * security0 = peer->security_params[0];
-  dtls_security_parameters_t * security1 = peer->security_params[1];
+  dtls_security_parameters_t * other = peer->other_security;
 
-  if (!security0 || !security1 || security0->epoch < security1->epoch)
+  if (!other || peer->security.epoch < other->epoch)
     return;
 
-  dtls_security_free(security1);
-  peer->security_params[1] = NULL;
+  dtls_security_free(other);
+  peer->other_security = NULL;
 }
 
+/**
+ * Makes the next epoch the current one. The contents are exchanged,
+ * so the current epoch stays inline and the previous epoch is kept
+ * in other_security.
+ */
 static inline void dtls_security_params_switch(dtls_peer_t *peer)
 {
-  dtls_security_parameters_t * security = peer->security_params[1];
+  dtls_security_parameters_t security;
 
-  peer->security_params[1] = peer->security_params[0];
-  peer->security_params[0] = security;
+  if (!peer->other_security)
+    return;
+
+  memcpy(&security, &peer->security, sizeof(security));
+  memcpy(&peer->security, peer->other_security, sizeof(security));
+  memcpy(peer->other_security, &security, sizeof(security));
+  memset(&security, 0, sizeof(security));
 }
 
 void peer_init(void);
@@ -149,6 +231,13 @@ void peer_init(void);
  */
 dtls_peer_t *dtls_new_peer(const session_t *session);
 
+/**
+ * Creates a new peer like dtls_new_peer(), allocated from the pool
+ * @p mem of a context. The peer's security and handshake parameters
+ * are taken from the same pool.
+ */
+dtls_peer_t *dtls_alloc_peer(dtls_mem_t *mem, const session_t *session);
+
 /** Releases the storage allocated to @p peer. */
 void dtls_free_peer(dtls_peer_t *peer);
 
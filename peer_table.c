@@ -0,0 +1,357 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinydtls.h"
+#include "peer.h"
+#include "peer_table.h"
+
+/*
+ * Each slot has a control byte: a full slot holds the lower seven
+ * bits of the peer's hash value, otherwise the most significant bit is
+ * set. Slots are probed in groups, starting at a group selected by the
+ * remaining bits of the hash value and continuing with triangular
+ * steps, which visit all groups as their number is a power of two. A
+ * lookup ends at the first group that has an empty slot, so removed
+ * peers leave a deleted marker unless their group has an empty slot.
+ */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+
+#define ctrl_is_full(C) (((C) & 0x80) == 0)
+#define hash_tag(H)     ((uint8_t)((H) & 0x7f))
+#define hash_group(H)   ((H) >> 7)
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+#define GROUP_SIZE 16
+
+/* one bit per slot */
+typedef uint32_t group_mask_t;
+
+static inline group_mask_t
+group_match(const uint8_t *ctrl, uint8_t c) {
+  __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+  return (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+}
+
+static inline group_mask_t
+group_match_empty(const uint8_t *ctrl) {
+  return group_match(ctrl, CTRL_EMPTY);
+}
+
+static inline group_mask_t
+group_match_free(const uint8_t *ctrl) {
+  return (group_mask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#define GROUP_SHIFT 0
+#else /* ! __SSE2__ */
+
+#define GROUP_SIZE 8
+
+/* the most significant bit of one byte per slot */
+typedef uint64_t group_mask_t;
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static inline uint64_t
+group_load(const uint8_t *ctrl) {
+  uint64_t w = 0;
+  int i;
+
+  for (i = GROUP_SIZE - 1; i >= 0; i--) {
+    w = (w << 8) | ctrl[i];
+  }
+  return w;
+}
+
+/* May also report full slots directly above a match, so the peer
+ * must be checked for each result. */
+static inline group_mask_t
+group_match(const uint8_t *ctrl, uint8_t c) {
+  uint64_t x = group_load(ctrl) ^ (LSBS * c);
+  return (x - LSBS) & ~x & MSBS;
+}
+
+static inline group_mask_t
+group_match_empty(const uint8_t *ctrl) {
+  uint64_t w = group_load(ctrl);
+  return w & ~(w << 6) & MSBS;
+}
+
+static inline group_mask_t
+group_match_free(const uint8_t *ctrl) {
+  return group_load(ctrl) & MSBS;
+}
+
+#define GROUP_SHIFT 3
+#endif /* ! __SSE2__ */
+
+#define MIN_CAPACITY (2 * GROUP_SIZE)
+#define MAX_LOAD(Capacity) ((Capacity) - (Capacity) / 8)
+#define NOT_FOUND ((size_t)-1)
+
+static inline unsigned int
+group_first(group_mask_t m) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(m) >> GROUP_SHIFT;
+#else /* ! __GNUC__ */
+  unsigned int n = 0;
+
+  while (!(m & 1)) {
+    m >>= 1;
+    n++;
+  }
+  return n >> GROUP_SHIFT;
+#endif /* ! __GNUC__ */
+}
+
+static int
+array_alloc(dtls_peer_array_t *a, size_t capacity) {
+  a->ctrl = (uint8_t *)malloc(capacity);
+  a->slots = (dtls_peer_t **)malloc(capacity * sizeof(dtls_peer_t *));
+  if (!a->ctrl || !a->slots) {
+    free(a->ctrl);
+    free(a->slots);
+    memset(a, 0, sizeof(dtls_peer_array_t));
+    return -1;
+  }
+  memset(a->ctrl, CTRL_EMPTY, capacity);
+  a->capacity = capacity;
+  a->used = 0;
+  a->count = 0;
+  return 0;
+}
+
+static void
+array_release(dtls_peer_array_t *a) {
+  free(a->ctrl);
+  free(a->slots);
+  memset(a, 0, sizeof(dtls_peer_array_t));
+}
+
+/* Returns the slot of @p peer if not NULL, or of the peer with @p key
+ * otherwise. */
+static size_t
+array_lookup(const dtls_peer_array_t *a, const dtls_session_key_t *key,
+             uint32_t hash, const dtls_peer_t *peer) {
+  size_t mask, group, i;
+
+  if (!a->count)
+    return NOT_FOUND;
+
+  mask = a->capacity / GROUP_SIZE - 1;
+  group = hash_group(hash) & mask;
+  for (i = 0; i <= mask; ) {
+    const uint8_t *ctrl = a->ctrl + group * GROUP_SIZE;
+    group_mask_t m = group_match(ctrl, hash_tag(hash));
+
+    for (; m; m &= m - 1) {
+      size_t slot = group * GROUP_SIZE + group_first(m);
+      const dtls_peer_t *p = a->slots[slot];
+
+      if (peer ? p == peer :
+          (p->hash == hash &&
+           memcmp(&p->key, key, sizeof(dtls_session_key_t)) == 0))
+        return slot;
+    }
+    if (group_match_empty(ctrl))
+      return NOT_FOUND;
+    group = (group + ++i) & mask;
+  }
+  return NOT_FOUND;
+}
+
+/* The caller must ensure that a->used < a->capacity. */
+static void
+array_insert(dtls_peer_array_t *a, dtls_peer_t *peer, uint32_t hash) {
+  size_t mask, group, i;
+
+  mask = a->capacity / GROUP_SIZE - 1;
+  group = hash_group(hash) & mask;
+  for (i = 0; i <= mask; ) {
+    group_mask_t m = group_match_free(a->ctrl + group * GROUP_SIZE);
+
+    if (m) {
+      size_t slot = group * GROUP_SIZE + group_first(m);
+
+      if (a->ctrl[slot] == CTRL_EMPTY)
+        a->used++;
+      a->ctrl[slot] = hash_tag(hash);
+      a->slots[slot] = peer;
+      a->count++;
+      return;
+    }
+    group = (group + ++i) & mask;
+  }
+}
+
+static void
+array_erase(dtls_peer_array_t *a, size_t slot) {
+  if (group_match_empty(a->ctrl + (slot - slot % GROUP_SIZE))) {
+    a->ctrl[slot] = CTRL_EMPTY;
+    a->used--;
+  } else {
+    a->ctrl[slot] = CTRL_DELETED;
+  }
+  a->count--;
+}
+
+/* Moves the peers of up to @p n slots of the previous array. */
+static void
+migrate(dtls_peer_table_t *table, size_t n) {
+  dtls_peer_array_t *old = &table->old;
+
+  while (old->capacity && n--) {
+    size_t slot = table->migrate_pos++;
+
+    if (ctrl_is_full(old->ctrl[slot])) {
+      dtls_peer_t *peer = old->slots[slot];
+      array_erase(old, slot);
+      array_insert(&table->cur, peer, peer->hash);
+    }
+    if (table->migrate_pos == old->capacity) {
+      array_release(old);
+      table->migrate_pos = 0;
+    }
+  }
+}
+
+static int
+resize(dtls_peer_table_t *table, size_t capacity) {
+  dtls_peer_array_t a;
+
+  /* only one migration at a time */
+  migrate(table, table->old.capacity);
+
+  if (array_alloc(&a, capacity) < 0)
+    return -1;
+
+  if (table->cur.count) {
+    table->old = table->cur;
+    table->migrate_pos = 0;
+  } else {
+    array_release(&table->cur);
+  }
+  table->cur = a;
+  migrate(table, DTLS_PEER_TABLE_MIGRATE);
+  return 0;
+}
+
+void
+dtls_peer_table_init(dtls_peer_table_t *table) {
+  memset(table, 0, sizeof(dtls_peer_table_t));
+}
+
+void
+dtls_peer_table_free(dtls_peer_table_t *table) {
+  array_release(&table->cur);
+  array_release(&table->old);
+  dtls_peer_table_init(table);
+}
+
+size_t
+dtls_peer_table_count(const dtls_peer_table_t *table) {
+  return table->cur.count + table->old.count;
+}
+
+dtls_peer_t *
+dtls_peer_table_find(const dtls_peer_table_t *table,
+                     const dtls_session_key_t *key, uint32_t hash) {
+  size_t slot;
+
+  slot = array_lookup(&table->cur, key, hash, NULL);
+  if (slot != NOT_FOUND)
+    return table->cur.slots[slot];
+
+  slot = array_lookup(&table->old, key, hash, NULL);
+  if (slot != NOT_FOUND)
+    return table->old.slots[slot];
+
+  return NULL;
+}
+
+int
+dtls_peer_table_add(dtls_peer_table_t *table, dtls_peer_t *peer,
+                    uint32_t hash) {
+  peer->hash = hash;
+  migrate(table, DTLS_PEER_TABLE_MIGRATE);
+
+  if (table->cur.used + 1 > MAX_LOAD(table->cur.capacity)) {
+    size_t capacity = table->cur.capacity;
+
+    if (!capacity) {
+      capacity = MIN_CAPACITY;
+    } else if (dtls_peer_table_count(table) + 1 > capacity / 2) {
+      capacity *= 2;
+    } /* else only remove the deleted markers */
+
+    if (resize(table, capacity) < 0 &&
+        table->cur.used == table->cur.capacity)
+      return -1;
+  }
+
+  array_insert(&table->cur, peer, hash);
+  return 0;
+}
+
+void
+dtls_peer_table_remove(dtls_peer_table_t *table, dtls_peer_t *peer) {
+  size_t slot;
+
+  slot = array_lookup(&table->cur, NULL, peer->hash, peer);
+  if (slot != NOT_FOUND) {
+    array_erase(&table->cur, slot);
+  } else {
+    slot = array_lookup(&table->old, NULL, peer->hash, peer);
+    if (slot == NOT_FOUND)
+      return;
+    array_erase(&table->old, slot);
+  }
+
+  if (table->iterating)
+    return;
+
+  migrate(table, DTLS_PEER_TABLE_MIGRATE);
+  if (!table->old.capacity && table->cur.capacity > MIN_CAPACITY &&
+      table->cur.count < table->cur.capacity / 8) {
+    /* failure is not critical, the table just stays larger */
+    (void)resize(table, table->cur.capacity / 2);
+  }
+}
+
+dtls_peer_t *
+dtls_peer_table_next(dtls_peer_table_t *table, size_t *pos) {
+  table->iterating = 1;
+
+  while (*pos < table->cur.capacity) {
+    size_t slot = (*pos)++;
+
+    if (ctrl_is_full(table->cur.ctrl[slot]))
+      return table->cur.slots[slot];
+  }
+  while (*pos - table->cur.capacity < table->old.capacity) {
+    size_t slot = (*pos)++ - table->cur.capacity;
+
+    if (ctrl_is_full(table->old.ctrl[slot]))
+      return table->old.slots[slot];
+  }
+
+  table->iterating = 0;
+  return NULL;
+}
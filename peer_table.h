@@ -0,0 +1,106 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/**
+ * @file peer_table.h
+ * @brief Open addressing peer table
+ */
+
+#ifndef _DTLS_PEER_TABLE_H_
+#define _DTLS_PEER_TABLE_H_
+
+#include <stddef.h>
+
+#include "tinydtls.h"
+#include "global.h"
+#include "session.h"
+
+/**
+ * @defgroup peer_table Open addressing peer table
+ *
+ * Alternative to the uthash based peer map, enabled with
+ * DTLS_PEERS_OPENHASH. Peers are stored as pointers in an array of
+ * slots, indexed by dtls_peer_t::key. Each slot has a control byte
+ * that holds seven bits of the hash value, so that a whole group of
+ * slots is probed with a few instructions and the peer itself is
+ * only accessed on a likely match.
+ *
+ * The table grows and shrinks incrementally: a new array is allocated
+ * and each subsequent update moves a few entries from the previous
+ * one, so no single operation rehashes all peers. Lookups do not
+ * modify the table.
+ * @{
+ */
+
+struct dtls_peer_t;
+
+/** One array of slots, see dtls_peer_table_t. */
+typedef struct dtls_peer_array_t {
+  uint8_t *ctrl;                /**< control byte per slot */
+  struct dtls_peer_t **slots;   /**< the peers */
+  size_t capacity;              /**< number of slots, 0 if not allocated */
+  size_t used;                  /**< slots not empty, including deleted */
+  size_t count;                 /**< number of peers */
+} dtls_peer_array_t;
+
+typedef struct dtls_peer_table_t {
+  dtls_peer_array_t cur;        /**< new peers are added here */
+  dtls_peer_array_t old;        /**< array being migrated during resize */
+  size_t migrate_pos;           /**< next slot of old to migrate */
+  int iterating;                /**< resizing is suspended while set */
+} dtls_peer_table_t;
+
+/** Initializes an empty @p table. No memory is allocated. */
+void dtls_peer_table_init(dtls_peer_table_t *table);
+
+/** Releases the slot arrays of @p table. The peers are not released. */
+void dtls_peer_table_free(dtls_peer_table_t *table);
+
+/** Returns the number of peers in @p table. */
+size_t dtls_peer_table_count(const dtls_peer_table_t *table);
+
+/**
+ * Returns the peer with session key @p key from @p table, or @c NULL
+ * if not found. @p hash must be dtls_session_key_hash() of @p key.
+ */
+struct dtls_peer_t *dtls_peer_table_find(const dtls_peer_table_t *table,
+                                         const dtls_session_key_t *key,
+                                         uint32_t hash);
+
+/**
+ * Adds @p peer to @p table. The peer's key must not be present in
+ * the table. @p hash must be dtls_session_key_hash() of the peer's
+ * key.
+ *
+ * @return @c 0 on success, or less than zero if no memory is
+ *   available.
+ */
+int dtls_peer_table_add(dtls_peer_table_t *table, struct dtls_peer_t *peer,
+                        uint32_t hash);
+
+/** Removes @p peer from @p table, if present. */
+void dtls_peer_table_remove(dtls_peer_table_t *table, struct dtls_peer_t *peer);
+
+/**
+ * Iterates over all peers of @p table. @p pos must be @c 0 for the
+ * first call. Returns @c NULL after the last peer. The returned peer
+ * may be removed before the next call, other updates are not
+ * permitted. The iteration must be continued until @c NULL is
+ * returned, as the table is not resized until then.
+ */
+struct dtls_peer_t *dtls_peer_table_next(dtls_peer_table_t *table,
+                                         size_t *pos);
+
+/** @} */
+
+#endif /* _DTLS_PEER_TABLE_H_ */
@@ -58,8 +58,14 @@
 #endif
 
 #ifndef DTLS_SECURITY_MAX
-/** The maximum number of concurrently used cipher keys */
-#  define DTLS_SECURITY_MAX (DTLS_PEER_MAX + DTLS_HANDSHAKE_MAX)
+/** The maximum number of concurrently used cipher keys of the next or
+ *  previous epoch. The keys of the current epoch are part of the peer. */
+#  define DTLS_SECURITY_MAX DTLS_PEER_MAX
+#endif
+
+#ifndef DTLS_CRYPTO_JOB_MAX
+/** The maximum number of concurrently offloaded crypto operations. */
+#  define DTLS_CRYPTO_JOB_MAX DTLS_HANDSHAKE_MAX
 #endif
 
 #ifndef DTLS_HASH_MAX
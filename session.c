@@ -163,3 +163,79 @@ dtls_session_equals(const session_t *a, const session_t *b) {
   return _dtls_address_equals_impl(a, b);
 #endif /* RIOT_VERSION */
 }
+
+void
+dtls_session_key(const session_t *session, dtls_session_key_t *key) {
+  assert(session); assert(key);
+  memset(key, 0, sizeof(dtls_session_key_t));
+  key->ifindex = session->ifindex;
+#if defined(WITH_CONTIKI)
+  key->port = session->port;
+  memcpy(key->addr, &session->addr, sizeof(uip_ipaddr_t));
+#elif defined(WITH_RIOT_SOCK)
+  key->family = session->addr.family;
+  key->port = session->addr.port;
+  switch (session->addr.family) {
+#ifdef SOCK_HAS_IPV4
+  case AF_INET:
+    memcpy(key->addr, &session->addr.ipv4, sizeof(ipv4_addr_t));
+    break;
+#endif
+#ifdef SOCK_HAS_IPV6
+  case AF_INET6:
+    memcpy(key->addr, &session->addr.ipv6, sizeof(ipv6_addr_t));
+    break;
+#endif
+  default:
+    ;
+  }
+#elif defined(WITH_LWIP_NO_SOCKET)
+  key->port = session->port;
+#if LWIP_IPV6
+  if (IP_IS_V6(&session->addr)) {
+    key->family = 6;
+    memcpy(key->addr, ip_2_ip6(&session->addr)->addr, 16);
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  if (IP_IS_V4(&session->addr)) {
+    key->family = 4;
+    memcpy(key->addr, &ip_2_ip4(&session->addr)->addr, 4);
+  }
+#endif /* LWIP_IPV4 */
+#else /* ! WITH_CONTIKI && ! WITH_RIOT_SOCK && ! WITH_LWIP_NO_SOCKET */
+  key->family = session->addr.sa.sa_family;
+  switch (session->addr.sa.sa_family) {
+  case AF_INET:
+    key->port = session->addr.sin.sin_port;
+    memcpy(key->addr, &session->addr.sin.sin_addr, sizeof(struct in_addr));
+    break;
+  case AF_INET6:
+    key->port = session->addr.sin6.sin6_port;
+    memcpy(key->addr, &session->addr.sin6.sin6_addr, sizeof(struct in6_addr));
+    break;
+  default:
+    ;
+  }
+#endif /* ! WITH_CONTIKI && ! WITH_RIOT_SOCK && ! WITH_LWIP_NO_SOCKET */
+}
+
+uint32_t
+dtls_session_key_hash(const dtls_session_key_t *key) {
+  const uint8_t *p = (const uint8_t *)key;
+  uint32_t hash = 0x9e3779b9;
+  uint32_t w;
+  size_t i;
+
+  /* multiplicative mixing of the key's 32-bit words, then finalized
+   * as in MurmurHash3 */
+  for (i = 0; i < sizeof(dtls_session_key_t); i += sizeof(w)) {
+    memcpy(&w, p + i, sizeof(w));
+    hash = (hash ^ w) * 0x85ebca6b;
+    hash ^= hash >> 13;
+  }
+  hash ^= hash >> 16;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
@@ -144,4 +144,28 @@ struct sockaddr* dtls_session_addr(session_t *sess, socklen_t *addrlen);
  */
 int dtls_session_equals(const session_t *a, const session_t *b);
 
+/**
+ * Compact, normalized representation of the fields of a session_t
+ * that identify a peer. Unused bytes are always zero, so keys can be
+ * compared with memcmp() and hashed as a whole, regardless of the
+ * padding and unused parts of the underlying address structure.
+ */
+typedef struct {
+  uint16_t family;        /**< address family, 0 if not applicable */
+  uint16_t port;          /**< transport layer port */
+  int32_t ifindex;        /**< network interface index */
+  uint8_t addr[16];       /**< IP address, IPv4 left aligned */
+} dtls_session_key_t;
+
+/**
+ * Fills @p key with the normalized key of @p session. Two sessions
+ * that are equal according to dtls_session_equals() have the same
+ * key, with the exception that the key does not depend on the size of
+ * the address structure.
+ */
+void dtls_session_key(const session_t *session, dtls_session_key_t *key);
+
+/** Returns a hash value for @p key. */
+uint32_t dtls_session_key_hash(const dtls_session_key_t *key);
+
 #endif /* _DTLS_SESSION_H_ */
@@ -69,6 +69,7 @@ static dtls_context_t *orig_dtls_context = NULL;
 static const dtls_cipher_t* ciphers = NULL;
 static unsigned int force_extended_master_secret = 0;
 static unsigned int force_renegotiation_info = 0;
+static int false_start = 0;
 
 
 #ifdef DTLS_ECC
@@ -361,15 +362,17 @@ usage( const char *program, const char *version) {
   fprintf(stderr, "%s v%s -- DTLS client implementation\n"
           "(c) 2011-2024 Olaf Bergmann <bergmann@tzi.org>\n\n"
 #ifdef DTLS_PSK
-          "usage: %s [-c cipher suites] [-e] [-i file] [-k file] [-o file]\n"
-          "       %*s [-p port] [-r] [-v num] addr [port]\n",
+          "usage: %s [-c cipher suites] [-e] [-f] [-i file] [-k file]\n"
+          "       %*s [-o file] [-p port] [-r] [-v num] addr [port]\n",
 #else /*  DTLS_PSK */
-          "usage: %s [-c cipher suites] [-e] [-o file] [-p port] [-r]\n"
-          "       %*s [-v num] addr [port]\n",
+          "usage: %s [-c cipher suites] [-e] [-f] [-o file] [-p port]\n"
+          "       %*s [-r] [-v num] addr [port]\n",
 #endif /* DTLS_PSK */
           program, version, program, (int)strlen(program), "");
   cipher_suites_usage(stderr, "\t");
   fprintf(stderr, "\t-e\t\tforce extended master secret (RFC7627)\n"
+          "\t-f\t\tsend data before the handshake has finished\n"
+          "\t  \t\t(False Start, RFC7918)\n"
 #ifdef DTLS_PSK
           "\t-i file\t\tread PSK identity from file\n"
           "\t-k file\t\tread pre-shared key from file\n"
@@ -439,7 +442,7 @@ main(int argc, char **argv) {
 #endif /* DTLS_PSK */
 
   while (optind < argc) {
-    opt = getopt(argc, argv, "c:eo:p:rv:z" PSK_OPTIONS);
+    opt = getopt(argc, argv, "c:efo:p:rv:z" PSK_OPTIONS);
     switch (opt) {
 #ifdef DTLS_PSK
     case 'i' :
@@ -465,6 +468,9 @@ main(int argc, char **argv) {
     case 'e' :
       force_extended_master_secret = 1;
       break;
+    case 'f' :
+      false_start = 1;
+      break;
     case 'o' :
       output_file.length = strlen(optarg);
       output_file.s = (unsigned char *)malloc(output_file.length + 1);
@@ -593,6 +599,7 @@ main(int argc, char **argv) {
   }
 
   dtls_set_handler(dtls_context, &cb);
+  dtls_set_false_start(dtls_context, false_start);
 
   dtls_connect(dtls_context, &dst);
 
@@ -0,0 +1,353 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Echo server like dtls-server, but running one DTLS context per
+ * shard on a number of worker threads. See dtls_server.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#include "tinydtls.h"
+#include "dtls_debug.h"
+#include "dtls_ciphers_util.h"
+#include "dtls.h"
+#include "dtls_server.h"
+
+#define DEFAULT_PORT 20220
+
+static const dtls_cipher_t* ciphers = NULL;
+static unsigned int force_extended_master_secret = 0;
+static unsigned int force_renegotiation_info = 0;
+
+#ifdef DTLS_ECC
+static const unsigned char ecdsa_priv_key[] = {
+            0xD9, 0xE2, 0x70, 0x7A, 0x72, 0xDA, 0x6A, 0x05,
+            0x04, 0x99, 0x5C, 0x86, 0xED, 0xDB, 0xE3, 0xEF,
+            0xC7, 0xF1, 0xCD, 0x74, 0x83, 0x8F, 0x75, 0x70,
+            0xC8, 0x07, 0x2D, 0x0A, 0x76, 0x26, 0x1B, 0xD4};
+
+static const unsigned char ecdsa_pub_key_x[] = {
+            0xD0, 0x55, 0xEE, 0x14, 0x08, 0x4D, 0x6E, 0x06,
+            0x15, 0x59, 0x9D, 0xB5, 0x83, 0x91, 0x3E, 0x4A,
+            0x3E, 0x45, 0x26, 0xA2, 0x70, 0x4D, 0x61, 0xF2,
+            0x7A, 0x4C, 0xCF, 0xBA, 0x97, 0x58, 0xEF, 0x9A};
+
+static const unsigned char ecdsa_pub_key_y[] = {
+            0xB4, 0x18, 0xB6, 0x4A, 0xFE, 0x80, 0x30, 0xDA,
+            0x1D, 0xDC, 0xF4, 0xF4, 0x2E, 0x2F, 0x26, 0x31,
+            0xD0, 0x43, 0xB1, 0xFB, 0x03, 0xE2, 0x2F, 0x4D,
+            0x17, 0xDE, 0x43, 0xF9, 0xF9, 0xAD, 0xEE, 0x70};
+#endif /* DTLS_ECC */
+
+#ifdef DTLS_PSK
+static int
+get_psk_info(struct dtls_context_t *ctx, const session_t *session,
+             dtls_credentials_type_t type,
+             const unsigned char *id, size_t id_len,
+             unsigned char *result, size_t result_length) {
+
+  struct keymap_t {
+    unsigned char *id;
+    size_t id_length;
+    unsigned char *key;
+    size_t key_length;
+  } psk[3] = {
+    { (unsigned char *)"Client_identity", 15,
+      (unsigned char *)"secretPSK", 9 },
+    { (unsigned char *)"default identity", 16,
+      (unsigned char *)"\x11\x22\x33", 3 },
+    { (unsigned char *)"\0", 2,
+      (unsigned char *)"", 1 }
+  };
+  (void)ctx;
+  (void)session;
+
+  if (type != DTLS_PSK_KEY) {
+    return 0;
+  }
+
+  if (id) {
+    size_t i;
+    for (i = 0; i < sizeof(psk)/sizeof(struct keymap_t); i++) {
+      if (id_len == psk[i].id_length && memcmp(id, psk[i].id, id_len) == 0) {
+        if (result_length < psk[i].key_length) {
+          dtls_warn("buffer too small for PSK");
+          return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+        }
+
+        memcpy(result, psk[i].key, psk[i].key_length);
+        return psk[i].key_length;
+      }
+    }
+  }
+
+  return dtls_alert_fatal_create(DTLS_ALERT_DECRYPT_ERROR);
+}
+#endif /* DTLS_PSK */
+
+#ifdef DTLS_ECC
+static int
+get_ecdsa_key(struct dtls_context_t *ctx,
+              const session_t *session,
+              const dtls_ecdsa_key_t **result) {
+  static const dtls_ecdsa_key_t ecdsa_key = {
+    .curve = DTLS_ECDH_CURVE_SECP256R1,
+    .priv_key = ecdsa_priv_key,
+    .pub_key_x = ecdsa_pub_key_x,
+    .pub_key_y = ecdsa_pub_key_y
+  };
+  (void)ctx;
+  (void)session;
+
+  *result = &ecdsa_key;
+  return 0;
+}
+
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx,
+                 const session_t *session,
+                 const unsigned char *other_pub_x,
+                 const unsigned char *other_pub_y,
+                 size_t key_size) {
+  (void)ctx;
+  (void)session;
+  (void)other_pub_x;
+  (void)other_pub_y;
+  (void)key_size;
+  return 0;
+}
+#endif /* DTLS_ECC */
+
+#define DTLS_SERVER_CMD_CLOSE "server:close"
+#define DTLS_SERVER_CMD_EXIT "server:exit"
+
+static int
+is_command(const char* cmd, const uint8 *data, size_t len) {
+  size_t cmd_len = strlen(cmd);
+  if (len >= cmd_len && memcmp(cmd, data, cmd_len) == 0) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+static int
+read_from_peer(struct dtls_context_t *ctx,
+               session_t *session, uint8 *data, size_t len) {
+  dtls_info("shard %u: %zu bytes\n", dtls_server_get_shard(ctx), len);
+  if (is_command(DTLS_SERVER_CMD_CLOSE, data, len)) {
+    printf("server: closing connection\n");
+    dtls_close(ctx, session);
+    return len;
+  } else if (is_command(DTLS_SERVER_CMD_EXIT, data, len)) {
+    printf("server: exit\n");
+    /* picked up by sigwait() in main() */
+    kill(getpid(), SIGTERM);
+    return len;
+  }
+
+  /* send it back */
+  return dtls_write(ctx, session, data, len);
+}
+
+static void
+get_user_parameters(struct dtls_context_t *ctx,
+                    session_t *session, dtls_user_parameters_t *user_parameters) {
+  (void) ctx;
+  (void) session;
+  user_parameters->force_extended_master_secret = force_extended_master_secret;
+  user_parameters->force_renegotiation_info = force_renegotiation_info;
+  if (ciphers) {
+    int i = 0;
+    while (i < DTLS_MAX_CIPHER_SUITES) {
+      user_parameters->cipher_suites[i] = ciphers[i];
+      if (ciphers[i] == TLS_NULL_WITH_NULL_NULL) {
+        break;
+      }
+      ++i;
+    }
+    if (i == DTLS_MAX_CIPHER_SUITES) {
+      user_parameters->cipher_suites[i] = TLS_NULL_WITH_NULL_NULL;
+    }
+  }
+}
+
+static int
+resolve_address(const char *server, struct sockaddr *dst) {
+
+  struct addrinfo *res, *ainfo;
+  struct addrinfo hints;
+  int error, len=-1;
+
+  memset ((char *)&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_family = AF_UNSPEC;
+
+  error = getaddrinfo(server && *server ? server : "localhost", NULL,
+                      &hints, &res);
+
+  if (error != 0) {
+    fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(error));
+    return -1;
+  }
+
+  for (ainfo = res; ainfo != NULL; ainfo = ainfo->ai_next) {
+    switch (ainfo->ai_family) {
+    case AF_INET6:
+    case AF_INET:
+      len = (int)ainfo->ai_addrlen;
+      memcpy(dst, ainfo->ai_addr, len);
+      goto finish;
+    default:
+      ;
+    }
+  }
+
+finish:
+  freeaddrinfo(res);
+  return len;
+}
+
+static void
+usage(const char *program, const char *version) {
+  const char *p;
+
+  p = strrchr( program, '/' );
+  if ( p )
+    program = ++p;
+
+  fprintf(stderr, "%s v%s -- sharded DTLS server implementation\n"
+         "(c) 2026 Contributors to the Eclipse Foundation\n\n"
+         "usage: %s [-A address] [-c cipher suites] [-e] [-n shards] [-p port] [-r] [-v num]\n"
+         "\t-A address\t\tlisten on specified address (default is ::)\n",
+         program, version, program);
+  cipher_suites_usage(stderr, "\t");
+  fprintf(stderr, "\t-e\t\tforce extended master secret (RFC7627)\n"
+         "\t-n shards\tnumber of worker threads (default: one per CPU)\n"
+         "\t-p port\t\tlisten on specified port (default is %d)\n"
+         "\t-r\t\tforce renegotiation info (RFC5746)\n"
+         "\t-v num\t\tverbosity level (default: 3)\n",
+         DEFAULT_PORT);
+}
+
+static dtls_handler_t cb = {
+  .write = NULL, /* use dtls_server_write() */
+  .read  = read_from_peer,
+  .get_user_parameters = get_user_parameters,
+  .event = NULL,
+#ifdef DTLS_PSK
+  .get_psk_info = get_psk_info,
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  .get_ecdsa_key = get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key
+#endif /* DTLS_ECC */
+};
+
+int
+main(int argc, char **argv) {
+  log_t log_level = DTLS_LOG_WARN;
+  dtls_server_config_t config;
+  dtls_server_t *server;
+  sigset_t signals;
+  int opt, sig;
+  uint16_t port = htons(DEFAULT_PORT);
+
+  memset(&config, 0, sizeof(config));
+  config.handler = &cb;
+  config.listen.size = sizeof(struct sockaddr_in6);
+  config.listen.addr.sin6.sin6_family = AF_INET6;
+  config.listen.addr.sin6.sin6_addr = in6addr_any;
+
+  while ((opt = getopt(argc, argv, "A:c:en:p:rv:")) != -1) {
+    switch (opt) {
+    case 'A' :
+      opt = resolve_address(optarg, &config.listen.addr.sa);
+      if (opt < 0) {
+        fprintf(stderr, "cannot resolve address\n");
+        exit(-1);
+      }
+      config.listen.size = opt;
+      break;
+    case 'c' :
+      ciphers = init_cipher_suites(optarg);
+      break;
+    case 'e' :
+      force_extended_master_secret = 1;
+      break;
+    case 'n' :
+      config.shards = atoi(optarg);
+      break;
+    case 'p' :
+      port = htons(atoi(optarg));
+      break;
+    case 'r' :
+      force_renegotiation_info = 1;
+      break;
+    case 'v' :
+      log_level = strtol(optarg, NULL, 10);
+      break;
+    default:
+      usage(argv[0], dtls_package_version());
+      exit(1);
+    }
+  }
+  if (argc != optind) {
+    dtls_warn("no arguments supported!\n");
+    usage(argv[0], dtls_package_version());
+    exit(1);
+  }
+  /* sin_port and sin6_port share the same offset */
+  config.listen.addr.sin6.sin6_port = port;
+
+  dtls_set_log_level(log_level);
+
+  /* Block the termination signals in all threads, they are handled
+   * synchronously by the main thread. */
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  dtls_init();
+
+  server = dtls_server_new(&config);
+  if (!server) {
+    dtls_alert("cannot create server\n");
+    exit(1);
+  }
+
+  if (dtls_server_start(server) < 0) {
+    dtls_server_free(server);
+    exit(1);
+  }
+  printf("server: %u shards\n", dtls_server_get_shards(server));
+
+  sigwait(&signals, &sig);
+
+  dtls_server_free(server);
+  exit(0);
+}
@@ -25,7 +25,7 @@ int main(int argc, char **argv) {
   clock_time_t timestamps[] = { 300, 100, 200, 400, 500 };
 
   for (i = 0; i < sizeof(timestamps)/sizeof(clock_time_t); i++) {
-    node = netq_node_new(0);
+    node = netq_node_new(NULL, 0);
 
     if (!node) {
       fprintf(stderr, "E: cannot create node #%d\n", i);
@@ -78,7 +78,7 @@ int main(int argc, char **argv) {
 
   printf("------------------------------------------------------------------------\n");
   printf("insert new item (timeout 50):\n");
-  node = netq_node_new(0);
+  node = netq_node_new(NULL, 0);
 
   assert(node);
   node->t = 50;
@@ -88,7 +88,7 @@ int main(int argc, char **argv) {
 
   printf("------------------------------------------------------------------------\n");
   printf("insert new item (timeout 350):\n");
-  node = netq_node_new(0);
+  node = netq_node_new(NULL, 0);
 
   assert(node);
   node->t = 350;
@@ -98,7 +98,7 @@ int main(int argc, char **argv) {
 
   printf("------------------------------------------------------------------------\n");
   printf("insert new item (timeout 1000):\n");
-  node = netq_node_new(0);
+  node = netq_node_new(NULL, 0);
 
   assert(node);
   node->t = 1000;
@@ -0,0 +1,225 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_alloc.h"
+
+#include "tinydtls.h"
+#include "global.h"
+#include "dtls_alloc.h"
+#include "peer.h"
+
+/* objects allocated per test, more than fit into one slab */
+#define OBJECTS (2 * DTLS_POOL_SLAB + 3)
+
+/* An allocator that fails after a given number of allocations. */
+typedef struct {
+  size_t budget;                /**< allocations that will succeed */
+  size_t allocs;
+  size_t frees;
+} t_allocator_state_t;
+
+static void *
+t_alloc(void *arg, size_t size) {
+  t_allocator_state_t *state = arg;
+
+  if (!state->budget)
+    return NULL;
+  state->budget--;
+  state->allocs++;
+  return malloc(size);
+}
+
+static void
+t_free(void *arg, void *ptr) {
+  t_allocator_state_t *state = arg;
+
+  state->frees++;
+  free(ptr);
+}
+
+static dtls_mem_t *
+new_mem(t_allocator_state_t *state, size_t budget) {
+  dtls_allocator_t allocator = { t_alloc, t_free, NULL };
+  dtls_mem_t *mem;
+
+  memset(state, 0, sizeof(*state));
+  state->budget = budget;
+  allocator.arg = state;
+
+  mem = dtls_mem_new();
+  if (mem && dtls_mem_set_allocator(mem, &allocator) < 0) {
+    dtls_mem_free(mem);
+    mem = NULL;
+  }
+  return mem;
+}
+
+/* Objects are aligned, belong to their context and do not overlap. */
+static void
+t_alloc_objects(void) {
+  t_allocator_state_t state;
+  dtls_allocator_t allocator = { t_alloc, t_free, NULL };
+  uint8_t *obj[OBJECTS];
+  dtls_mem_t *mem;
+  size_t i, j;
+
+  mem = new_mem(&state, (size_t)-1);
+  CU_ASSERT_FATAL(mem != NULL);
+
+  for (i = 0; i < OBJECTS; i++) {
+    obj[i] = dtls_mem_alloc(mem, DTLS_POOL_PEER, sizeof(dtls_peer_t));
+    CU_ASSERT_FATAL(obj[i] != NULL);
+    CU_ASSERT((uintptr_t)obj[i] % DTLS_CACHE_LINE_SIZE == 0);
+    CU_ASSERT(dtls_mem_owner(obj[i]) == mem);
+    memset(obj[i], (int)i, sizeof(dtls_peer_t));
+  }
+  for (i = 0; i < OBJECTS; i++) {
+    for (j = 0; j < sizeof(dtls_peer_t); j++) {
+      if (obj[i][j] != (uint8_t)i)
+        break;
+    }
+    CU_ASSERT_EQUAL(j, sizeof(dtls_peer_t));
+  }
+
+  /* the allocator cannot be changed anymore */
+  CU_ASSERT(dtls_mem_set_allocator(mem, &allocator) < 0);
+
+  for (i = 0; i < OBJECTS; i++) {
+    dtls_mem_release(obj[i]);
+  }
+  dtls_mem_free(mem);
+  CU_ASSERT_EQUAL(state.allocs, state.frees);
+}
+
+/* Released objects are reused before the allocator is called again,
+ * and an exhausted allocator makes the allocation fail. */
+static void
+t_alloc_exhaustion(void) {
+  t_allocator_state_t state;
+  void *obj[DTLS_POOL_SLAB + 1];
+  const size_t slab = DTLS_POOL_SLAB;
+  void *last;
+  dtls_mem_t *mem;
+  size_t i;
+
+#if DTLS_POOL_SLAB > 0
+  /* one slab */
+  mem = new_mem(&state, 1);
+#else /* DTLS_POOL_SLAB > 0 */
+  mem = new_mem(&state, 0);
+#endif /* DTLS_POOL_SLAB > 0 */
+  CU_ASSERT_FATAL(mem != NULL);
+
+  for (i = 0; i < slab; i++) {
+    obj[i] = dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100);
+    CU_ASSERT_FATAL(obj[i] != NULL);
+  }
+  CU_ASSERT(dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100) == NULL);
+  /* other pools have their own slabs */
+  CU_ASSERT(dtls_mem_alloc(mem, DTLS_POOL_SECURITY, 1) == NULL);
+
+#if DTLS_POOL_SLAB > 0
+  CU_ASSERT_EQUAL(state.allocs, 1);
+  last = obj[DTLS_POOL_SLAB - 1];
+  dtls_mem_release(last);
+  obj[DTLS_POOL_SLAB - 1] = dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100);
+  CU_ASSERT(obj[DTLS_POOL_SLAB - 1] == last);
+  CU_ASSERT_EQUAL(state.allocs, 1);
+  CU_ASSERT_EQUAL(state.frees, 0);
+
+  /* a reserved slab makes room again */
+  state.budget = 1;
+  CU_ASSERT(dtls_mem_reserve(mem, DTLS_POOL_NETQ, 1) == 0);
+  obj[DTLS_POOL_SLAB] = dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100);
+  CU_ASSERT(obj[DTLS_POOL_SLAB] != NULL);
+  CU_ASSERT(dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100) == NULL);
+  dtls_mem_release(obj[DTLS_POOL_SLAB]);
+#else /* DTLS_POOL_SLAB > 0 */
+  /* without slabs, each object is allocated and freed on its own */
+  (void)last;
+  state.budget = 1;
+  obj[0] = dtls_mem_alloc(mem, DTLS_POOL_NETQ, 100);
+  CU_ASSERT_FATAL(obj[0] != NULL);
+  CU_ASSERT_EQUAL(state.allocs, 1);
+  dtls_mem_release(obj[0]);
+  CU_ASSERT_EQUAL(state.frees, 1);
+#endif /* DTLS_POOL_SLAB > 0 */
+
+  for (i = 0; i < slab; i++) {
+    dtls_mem_release(obj[i]);
+  }
+  dtls_mem_free(mem);
+  CU_ASSERT_EQUAL(state.allocs, state.frees);
+}
+
+/* Objects larger than their pool and objects without a context are
+ * allocated individually and freed on release. */
+static void
+t_alloc_individual(void) {
+  t_allocator_state_t state;
+  dtls_mem_t *mem;
+  uint8_t *obj;
+
+  mem = new_mem(&state, (size_t)-1);
+  CU_ASSERT_FATAL(mem != NULL);
+
+  obj = dtls_mem_alloc(mem, DTLS_POOL_NETQ, 4 * DTLS_MAX_BUF);
+  CU_ASSERT_FATAL(obj != NULL);
+  CU_ASSERT_EQUAL(state.allocs, 1);
+  CU_ASSERT(dtls_mem_owner(obj) == mem);
+  memset(obj, 0xa5, 4 * DTLS_MAX_BUF);
+  dtls_mem_release(obj);
+  CU_ASSERT_EQUAL(state.frees, 1);
+
+  state.budget = 0;
+  CU_ASSERT(dtls_mem_alloc(mem, DTLS_POOL_NETQ, 4 * DTLS_MAX_BUF) == NULL);
+
+  obj = dtls_mem_alloc(NULL, DTLS_POOL_PEER, sizeof(dtls_peer_t));
+  CU_ASSERT_FATAL(obj != NULL);
+  CU_ASSERT((uintptr_t)obj % DTLS_CACHE_LINE_SIZE == 0);
+  CU_ASSERT(dtls_mem_owner(obj) == NULL);
+  dtls_mem_release(obj);
+
+  dtls_mem_free(mem);
+  CU_ASSERT_EQUAL(state.allocs, state.frees);
+}
+
+CU_pSuite
+t_init_alloc_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("object pools", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add object pool test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define ALLOC_TEST(s,t)                                                 \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for object pools (%s)\n",       \
+            CU_get_error_msg());                                        \
+  }
+
+  ALLOC_TEST(suite, t_alloc_objects);
+  ALLOC_TEST(suite, t_alloc_exhaustion);
+  ALLOC_TEST(suite, t_alloc_individual);
+
+  return suite;
+}
@@ -0,0 +1,146 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_cid.h"
+#include "test_loopback.h"
+
+#include "peer.h"
+
+#if defined(DTLS_PSK) && DTLS_CID_LENGTH > 0
+
+static t_loopback_endpoint_t server, client, other;
+
+/* Each test starts with fresh contexts. */
+static int
+t_cid_setup(void) {
+  if (t_loopback_init(&server, 20250, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&client, 20251, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&other, 20252, TLS_PSK_WITH_AES_128_CCM_8) < 0)
+    return -1;
+  return 0;
+}
+
+static void
+t_cid_teardown(void) {
+  t_loopback_free(&other);
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/* Sets the port the client sends from, as after a NAT rebinding. */
+static void
+set_client_port(unsigned short port) {
+  client.addr.addr.sin.sin_port = htons(port);
+}
+
+/* The client's records carry the connection id of the server, so that
+ * they reach its peer after the address has changed. The peer follows
+ * the authentic records. */
+static void
+t_cid_address_change(void) {
+  dtls_peer_t *peer;
+
+  CU_ASSERT_FATAL(t_cid_setup() == 0);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(client.connected == 1);
+
+  peer = t_loopback_peer(&server, &client);
+  CU_ASSERT_FATAL(peer != NULL);
+  CU_ASSERT_EQUAL(peer->read_cid_length, DTLS_CID_LENGTH);
+  /* the client is found by its address, and asks for none */
+  CU_ASSERT_EQUAL(peer->write_cid_length, 0);
+
+  set_client_port(20261);
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"abc", 3) == 3);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 3);
+  CU_ASSERT_EQUAL(server.last_event, DTLS_EVENT_ADDRESS_CHANGED);
+  CU_ASSERT(t_loopback_peer(&server, &client) == peer);
+
+  /* the server answers at the new address */
+  CU_ASSERT(dtls_write(server.ctx, &client.addr, (uint8 *)"de", 2) == 2);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.received, 2);
+
+  /* moving back to the first address */
+  set_client_port(20251);
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"f", 1) == 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 4);
+  CU_ASSERT(t_loopback_peer(&server, &client) == peer);
+
+  t_cid_teardown();
+}
+
+/* A peer is not moved to an address that another peer has. */
+static void
+t_cid_address_taken(void) {
+  dtls_peer_t *peer;
+
+  CU_ASSERT_FATAL(t_cid_setup() == 0);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  CU_ASSERT(t_loopback_connect(&other, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(server.connected == 2);
+  peer = t_loopback_peer(&server, &client);
+
+  /* the client now sends from the address of the other client */
+  set_client_port(20252);
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"abc", 3) == 3);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 0);
+  set_client_port(20251);
+  CU_ASSERT(t_loopback_peer(&server, &client) == peer);
+  CU_ASSERT(t_loopback_peer(&server, &other) != peer);
+  CU_ASSERT(t_loopback_peer(&server, &other) != NULL);
+
+  t_cid_teardown();
+}
+
+CU_pSuite
+t_init_cid_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("connection id", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add connection id test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define CID_TEST(s,t)                                                   \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for connection id (%s)\n",      \
+            CU_get_error_msg());                                        \
+  }
+
+  CID_TEST(suite, t_cid_address_change);
+  CID_TEST(suite, t_cid_address_taken);
+
+  return suite;
+}
+
+#else /* DTLS_PSK && DTLS_CID_LENGTH > 0 */
+
+CU_pSuite
+t_init_cid_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_PSK && DTLS_CID_LENGTH > 0 */
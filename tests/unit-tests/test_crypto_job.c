@@ -0,0 +1,229 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+
+#include "dtls_config.h"
+#include "test_crypto_job.h"
+#include "test_loopback.h"
+
+#ifdef DTLS_ECC
+
+#define T_JOBS_MAX 16
+
+/*
+ * A minimal executor: crypto_submit() only queues the job, the test
+ * runs and completes the queued jobs later in an order of its choice.
+ * A real executor would call dtls_crypto_job_run() on a worker thread
+ * and hand the job back to the thread that uses the context.
+ */
+static struct {
+  dtls_context_t *ctx;
+  dtls_crypto_job_t *job;
+} jobs[T_JOBS_MAX];
+static size_t num_jobs;
+
+static int
+crypto_submit(struct dtls_context_t *ctx, dtls_crypto_job_t *job) {
+  if (num_jobs == T_JOBS_MAX)
+    return -1;                  /* run synchronously */
+
+  job->state = DTLS_CRYPTO_JOB_PENDING;
+  jobs[num_jobs].ctx = ctx;
+  jobs[num_jobs].job = job;
+  num_jobs++;
+  return 0;
+}
+
+/* Runs and completes the job at position i of the queue. */
+static int
+complete_job(size_t i) {
+  dtls_context_t *ctx = jobs[i].ctx;
+  dtls_crypto_job_t *job = jobs[i].job;
+
+  jobs[i] = jobs[--num_jobs];
+  dtls_crypto_job_run(job);
+  return dtls_crypto_job_complete(ctx, job);
+}
+
+/* Completes all queued jobs, the most recent first, and delivers the
+ * records until neither records nor jobs are left. */
+static void
+run_lifo(void) {
+  int rounds = 0;
+
+  do {
+    while (num_jobs)
+      complete_job(num_jobs - 1);
+  } while ((t_loopback_flush() || num_jobs) && ++rounds < 100);
+}
+
+static int
+init_endpoint(t_loopback_endpoint_t *ep, unsigned short port) {
+  if (t_loopback_init(ep, port, TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) < 0)
+    return -1;
+  ep->handler.crypto_submit = crypto_submit;
+  return 0;
+}
+
+static void
+t_crypto_job_out_of_order(void) {
+  t_loopback_endpoint_t server, client1, client2;
+
+  CU_ASSERT_FATAL(init_endpoint(&server, 20220) == 0);
+  CU_ASSERT_FATAL(init_endpoint(&client1, 20221) == 0);
+  CU_ASSERT_FATAL(init_endpoint(&client2, 20222) == 0);
+
+  CU_ASSERT(t_loopback_connect(&client1, &server) > 0);
+  CU_ASSERT(t_loopback_connect(&client2, &server) > 0);
+  t_loopback_flush();
+
+  /* both handshakes wait for the server's ServerKeyExchange */
+  CU_ASSERT_EQUAL(num_jobs, 2);
+  CU_ASSERT(jobs[0].ctx == server.ctx && jobs[1].ctx == server.ctx);
+  CU_ASSERT_EQUAL(server.connected, 0);
+
+  run_lifo();
+
+  CU_ASSERT_EQUAL(num_jobs, 0);
+  CU_ASSERT_EQUAL(server.connected, 2);
+  CU_ASSERT_EQUAL(client1.connected, 1);
+  CU_ASSERT_EQUAL(client2.connected, 1);
+  CU_ASSERT_EQUAL(server.fatal + client1.fatal + client2.fatal, 0);
+
+  CU_ASSERT(dtls_write(client1.ctx, &server.addr, (uint8 *)"ping", 4) == 4);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 4);
+
+  t_loopback_free(&client2);
+  t_loopback_free(&client1);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+static void
+t_crypto_job_peer_removed(void) {
+  t_loopback_endpoint_t server, client;
+  dtls_crypto_job_t *stale;
+  dtls_peer_t *peer;
+
+  CU_ASSERT_FATAL(init_endpoint(&server, 20220) == 0);
+  CU_ASSERT_FATAL(init_endpoint(&client, 20221) == 0);
+
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(num_jobs == 1);
+  stale = jobs[0].job;
+
+  /* remove the server's peer while its job is pending */
+  peer = t_loopback_peer(&server, &client);
+  CU_ASSERT_FATAL(peer != NULL);
+  dtls_reset_peer(server.ctx, peer);
+  t_loopback_discard();
+
+  /* a new handshake from the same address submits a new job */
+  peer = t_loopback_peer(&client, &server);
+  CU_ASSERT_FATAL(peer != NULL);
+  dtls_reset_peer(client.ctx, peer);
+  t_loopback_discard();
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(num_jobs == 2);
+  CU_ASSERT(jobs[0].job == stale);
+
+  /* the stale job is discarded and must not touch the new handshake */
+  CU_ASSERT_EQUAL(complete_job(0), 0);
+  CU_ASSERT_EQUAL(num_jobs, 1);
+  CU_ASSERT(t_loopback_peer(&server, &client) != NULL);
+  CU_ASSERT_EQUAL(t_loopback_flush(), 0);
+
+  run_lifo();
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client.connected, 1);
+
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/* Records that arrive while a job is pending are handled when it
+ * completes, also those behind the Finished that completes the
+ * handshake. */
+static void
+t_crypto_job_deferred_records(void) {
+  t_loopback_endpoint_t server, client;
+
+  CU_ASSERT_FATAL(init_endpoint(&server, 20220) == 0);
+  CU_ASSERT_FATAL(t_loopback_init(&client, 20221,
+                                  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  dtls_set_false_start(client.ctx, 1);
+
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(num_jobs == 1);
+  complete_job(0);
+  t_loopback_flush();
+
+  /* the server computes the key block of the client's flight */
+  CU_ASSERT_FATAL(num_jobs == 1);
+  CU_ASSERT_EQUAL(jobs[0].job->type, DTLS_CRYPTO_JOB_KEY_BLOCK);
+  CU_ASSERT_EQUAL(client.last_event, DTLS_EVENT_FALSE_START);
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"early", 5) == 5);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 0);
+
+  /* ChangeCipherSpec, Finished and the application data follow */
+  complete_job(0);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(num_jobs, 0);
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.received, 5);
+
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+CU_pSuite
+t_init_crypto_job_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("crypto jobs", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add crypto job test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define CRYPTO_JOB_TEST(s,t)                                            \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for crypto jobs (%s)\n",        \
+            CU_get_error_msg());                                        \
+  }
+
+  CRYPTO_JOB_TEST(suite, t_crypto_job_out_of_order);
+  CRYPTO_JOB_TEST(suite, t_crypto_job_peer_removed);
+  CRYPTO_JOB_TEST(suite, t_crypto_job_deferred_records);
+
+  return suite;
+}
+
+#else /* DTLS_ECC */
+
+CU_pSuite
+t_init_crypto_job_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_ECC */
@@ -0,0 +1,230 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_false_start.h"
+#include "test_loopback.h"
+
+#ifdef DTLS_ECC
+
+static t_loopback_endpoint_t server, client;
+
+static int (*loopback_event)(struct dtls_context_t *ctx, session_t *session,
+                             dtls_alert_level_t level, unsigned short code);
+static int false_starts;        /* number of DTLS_EVENT_FALSE_START */
+static int connected_at_read;   /* server.connected when data was read */
+
+static int
+count_event(struct dtls_context_t *ctx, session_t *session,
+            dtls_alert_level_t level, unsigned short code) {
+  if (level == 0 && code == DTLS_EVENT_FALSE_START)
+    false_starts++;
+  return loopback_event(ctx, session, level, code);
+}
+
+static int
+read_data(struct dtls_context_t *ctx,
+          session_t *session, uint8 *data, size_t len) {
+  t_loopback_endpoint_t *ep = dtls_get_app_data(ctx);
+  (void)session;
+  (void)data;
+
+  ep->received += len;
+  connected_at_read = ep->connected;
+  return 0;
+}
+
+/* Each test starts with fresh contexts, the client uses False Start. */
+static int
+t_false_start_setup(dtls_cipher_t cipher) {
+  if (t_loopback_init(&server, 20280, cipher) < 0 ||
+      t_loopback_init(&client, 20281, cipher) < 0)
+    return -1;
+  dtls_set_false_start(client.ctx, 1);
+  loopback_event = client.handler.event;
+  client.handler.event = count_event;
+  server.handler.read = read_data;
+  false_starts = 0;
+  connected_at_read = -1;
+  return 0;
+}
+
+static void
+t_false_start_teardown(void) {
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/* Delivers the datagrams queued now, but not those sent in response. */
+static void
+deliver_queued(void) {
+  size_t i, count = t_loopback_queued();
+
+  for (i = 0; i < count; i++)
+    t_loopback_step();
+}
+
+/* Runs the handshake up to the client's last flight, lets the client
+ * write "early" in False Start and queues the Finished of the flight
+ * behind that data. */
+static void
+early_data_before_finished(void) {
+  uint8 finished[DTLS_MAX_BUF], *data;
+  size_t length;
+  int records;
+
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  deliver_queued();             /* ClientHello */
+  deliver_queued();             /* HelloVerifyRequest */
+  deliver_queued();             /* ClientHello with cookie */
+  deliver_queued();             /* ServerHello ... ServerHelloDone */
+  CU_ASSERT_EQUAL(false_starts, 1);
+  CU_ASSERT_EQUAL(client.connected, 0);
+
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"early", 5) == 5);
+  CU_ASSERT_FATAL(t_loopback_queued() == 2);
+
+  records = t_loopback_split(0);
+  CU_ASSERT_FATAL(records > 2);
+  data = t_loopback_datagram(records - 1, &length);
+  CU_ASSERT_FATAL(data != NULL && length <= sizeof(finished));
+  memcpy(finished, data, length);
+  t_loopback_drop(records - 1);
+  CU_ASSERT(t_loopback_send(&client, &server, finished, length) > 0);
+}
+
+/* The server reads the data of a client in False Start once the
+ * client's Finished has been verified. */
+static void
+t_false_start_early_data(void) {
+  CU_ASSERT_FATAL(t_false_start_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  early_data_before_finished();
+  while (t_loopback_queued() > 1)
+    t_loopback_step();
+  CU_ASSERT_EQUAL(server.received, 0);
+  CU_ASSERT_EQUAL(server.connected, 0);
+
+  t_loopback_step();            /* Finished */
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(server.received, 5);
+  CU_ASSERT_EQUAL(connected_at_read, 1);
+
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(false_starts, 1);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+
+  t_false_start_teardown();
+}
+
+/* The data is dropped with the handshake if the client's Finished
+ * does not match the server's view of the handshake. */
+static void
+t_false_start_bad_finished(void) {
+  dtls_peer_t *peer;
+
+  CU_ASSERT_FATAL(t_false_start_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  early_data_before_finished();
+  while (t_loopback_queued() > 1)
+    t_loopback_step();
+  peer = t_loopback_peer(&server, &client);
+  CU_ASSERT_FATAL(peer != NULL && peer->handshake_params != NULL);
+  CU_ASSERT(peer->handshake_params->early_data != NULL);
+  dtls_hash_update(&peer->handshake_params->hs_state.hs_hash,
+                   (const unsigned char *)"x", 1);
+
+  t_loopback_step();            /* Finished */
+  CU_ASSERT_EQUAL(server.connected, 0);
+  CU_ASSERT_EQUAL(server.received, 0);
+  CU_ASSERT(t_loopback_peer(&server, &client) == NULL);
+
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 0);
+  CU_ASSERT_EQUAL(client.fatal, 1);
+
+  t_false_start_teardown();
+}
+
+/* Without forward secrecy or in an abbreviated handshake, the client
+ * waits for the server's Finished. */
+static void
+t_false_start_not_signaled(void) {
+#ifdef DTLS_PSK
+  CU_ASSERT_FATAL(t_false_start_setup(TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(false_starts, 0);
+  t_false_start_teardown();
+#endif /* DTLS_PSK */
+
+#if DTLS_SESSION_CACHE_SIZE > 0
+  {
+    int full;
+
+    CU_ASSERT_FATAL(t_false_start_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+    CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+    full = t_loopback_flush();
+    CU_ASSERT_EQUAL(client.connected, 1);
+    CU_ASSERT_EQUAL(false_starts, 1);
+
+    CU_ASSERT(dtls_close(client.ctx, &server.addr) == 0);
+    t_loopback_flush();
+    CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+    /* abbreviated, with fewer records */
+    CU_ASSERT(t_loopback_flush() < full);
+    CU_ASSERT_EQUAL(client.connected, 2);
+    CU_ASSERT_EQUAL(false_starts, 1);
+    t_false_start_teardown();
+  }
+#endif /* DTLS_SESSION_CACHE_SIZE > 0 */
+}
+
+CU_pSuite
+t_init_false_start_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("false start", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add false start test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define FALSE_START_TEST(s,t)                                           \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for false start (%s)\n",        \
+            CU_get_error_msg());                                        \
+  }
+
+  FALSE_START_TEST(suite, t_false_start_early_data);
+  FALSE_START_TEST(suite, t_false_start_bad_finished);
+  FALSE_START_TEST(suite, t_false_start_not_signaled);
+
+  return suite;
+}
+
+#else /* DTLS_ECC */
+
+CU_pSuite
+t_init_false_start_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_ECC */
@@ -0,0 +1,565 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_flight.h"
+#include "test_loopback.h"
+
+#include "dtls_time.h"
+#include "numeric.h"
+
+/* The flights of ECDHE_ECDSA handshakes are large enough to need
+ * several datagrams, the PSK handshakes are the faster ones. */
+#if defined(DTLS_ECC) && defined(DTLS_PSK)
+
+static t_loopback_endpoint_t server, client;
+
+/* Each test starts with fresh contexts, the handshakes are always
+ * full ones. */
+static int
+t_flight_setup(dtls_cipher_t cipher) {
+  if (t_loopback_init(&server, 20260, cipher) < 0 ||
+      t_loopback_init(&client, 20261, cipher) < 0)
+    return -1;
+  dtls_set_session_lifetime(server.ctx, 0);
+  dtls_set_session_lifetime(client.ctx, 0);
+  return 0;
+}
+
+static void
+t_flight_teardown(void) {
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/* Delivers the datagrams queued now, but not those sent in response.
+ * Returns the number of datagrams delivered. */
+static size_t
+deliver_queued(void) {
+  size_t i, count = t_loopback_queued();
+
+  for (i = 0; i < count; i++)
+    t_loopback_step();
+  return count;
+}
+
+/* Runs the handshake of @p ep up to the flight of the server that
+ * starts with the ServerHello, and returns the number of its
+ * datagrams. */
+static size_t
+server_hello_flight(t_loopback_endpoint_t *ep) {
+  CU_ASSERT(t_loopback_connect(ep, &server) > 0);
+  deliver_queued();             /* ClientHello */
+  deliver_queued();             /* HelloVerifyRequest */
+  deliver_queued();             /* ClientHello with cookie */
+  return t_loopback_queued();
+}
+
+/* A lost datagram of a flight makes the whole flight be retransmitted
+ * once its timeout has expired. */
+static void
+t_flight_retransmit(void) {
+  size_t datagrams;
+  int sent;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  /* the server's flight needs several datagrams */
+  dtls_set_mtu(server.ctx, 200);
+
+  datagrams = server_hello_flight(&client);
+  CU_ASSERT_FATAL(datagrams > 2);
+  sent = server.datagrams;
+
+  t_loopback_drop(1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+  CU_ASSERT_EQUAL(client.connected, 0);
+
+  /* not before the timeout */
+  dtls_check_retransmit(server.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+
+  /* beyond DTLS_RTO_INITIAL with its jitter */
+  t_loopback_advance(3);
+  dtls_check_retransmit(server.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), datagrams);
+  CU_ASSERT_EQUAL(server.datagrams, sent + (int)datagrams);
+
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+
+  t_flight_teardown();
+}
+
+/* Runs a handshake of the client and closes it again, so that the
+ * next one starts anew. */
+static void
+handshake_and_close(void) {
+  int connected = client.connected;
+
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, connected + 1);
+  CU_ASSERT(dtls_close(client.ctx, &server.addr) == 0);
+  t_loopback_flush();
+}
+
+/* The round-trip time estimate of the context converges on the delay
+ * of the network. */
+static void
+t_flight_rtt(void) {
+  dtls_rtt_t rtt, last;
+  int i;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_PSK_WITH_AES_128_CCM_8) == 0);
+
+  CU_ASSERT(dtls_get_rtt(client.ctx, NULL, &rtt) == 0);
+  CU_ASSERT_EQUAL(rtt.srtt, 0);
+  CU_ASSERT_EQUAL(rtt.rto, DTLS_RTO_INITIAL);
+  CU_ASSERT(dtls_get_rtt(client.ctx, &server.addr, &rtt) < 0);
+
+  /* without delay, each round trip takes a few milliseconds */
+  handshake_and_close();
+  CU_ASSERT(dtls_get_rtt(client.ctx, NULL, &last) == 0);
+  CU_ASSERT(last.srtt < 500);
+  CU_ASSERT(last.rto >= DTLS_RTO_MIN);
+
+  /* a round trip takes two seconds now */
+  t_loopback_set_delay(1);
+  for (i = 0; i < 10; i++) {
+    handshake_and_close();
+    CU_ASSERT(dtls_get_rtt(client.ctx, NULL, &rtt) == 0);
+    CU_ASSERT(rtt.srtt > last.srtt);
+    last = rtt;
+  }
+  CU_ASSERT(rtt.srtt >= 1900);
+  CU_ASSERT(rtt.srtt < 2500);
+  CU_ASSERT(rtt.rto >= rtt.srtt + 4 * rtt.rttvar);
+
+  /* a peer has its own estimate, from its first sample on */
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT(dtls_get_rtt(client.ctx, &server.addr, &rtt) == 0);
+  CU_ASSERT(rtt.srtt >= 2000);
+  CU_ASSERT(rtt.srtt < 2500);
+  t_loopback_set_delay(0);
+
+  t_flight_teardown();
+}
+
+/* Once the retransmission budget is used up, due flights wait until
+ * it has been refilled, and dtls_check_retransmit() reports when. */
+static void
+t_flight_pacing(void) {
+  static const dtls_pacing_t pacing = { 0, 2 };
+  static const dtls_rto_config_t rto = {
+    DTLS_RTO_INITIAL, DTLS_RTO_MIN, DTLS_RTO_MAX, 0
+  };
+  t_loopback_endpoint_t other;
+  size_t datagrams;
+  clock_time_t next;
+  dtls_tick_t now, wait;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT_FATAL(t_loopback_init(&other, 20262,
+                                  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  dtls_set_mtu(server.ctx, 200);
+  dtls_set_retransmit_pacing(server.ctx, &pacing);
+  dtls_set_rto_config(server.ctx, &rto);
+
+  /* the flights to both clients are lost */
+  datagrams = server_hello_flight(&client);
+  CU_ASSERT_FATAL(datagrams > pacing.datagrams_per_second);
+  t_loopback_discard();
+  CU_ASSERT_EQUAL(server_hello_flight(&other), datagrams);
+  t_loopback_discard();
+
+  /* the first flight is sent as a whole and overdraws the budget */
+  t_loopback_advance(3);
+  dtls_ticks(&now);
+  dtls_check_retransmit(server.ctx, &next);
+  CU_ASSERT_EQUAL(t_loopback_queued(), datagrams);
+  wait = (datagrams - pacing.datagrams_per_second) * DTLS_TICKS_PER_SECOND /
+    pacing.datagrams_per_second;
+  CU_ASSERT(next > now + wait);
+  CU_ASSERT(next <= now + wait + DTLS_TICKS_PER_SECOND / 10);
+  t_loopback_discard();
+
+  /* the second flight is due, but postponed */
+  dtls_check_retransmit(server.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+
+  t_loopback_advance((wait + DTLS_TICKS_PER_SECOND) / DTLS_TICKS_PER_SECOND);
+  dtls_check_retransmit(server.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), datagrams);
+
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(other.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+
+  t_loopback_free(&other);
+  t_flight_teardown();
+}
+
+/* Sets the retransmission timeout of @p ep to its minimum. */
+static void
+set_short_timeout(t_loopback_endpoint_t *ep) {
+  static const dtls_rto_config_t rto = {
+    DTLS_RTO_MIN, DTLS_RTO_MIN, DTLS_RTO_MAX, 0
+  };
+
+  dtls_set_rto_config(ep->ctx, &rto);
+}
+
+/* A ClientHello sent again means that our flight has been lost, it
+ * is sent again at once, but not within one round trip of its last
+ * transmission. */
+static void
+t_flight_resend_on_duplicate(void) {
+  t_loopback_endpoint_t other;
+  size_t datagrams;
+  int sent;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT_FATAL(t_loopback_init(&other, 20262,
+                                  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  set_short_timeout(&client);
+  set_short_timeout(&other);
+
+  datagrams = server_hello_flight(&client);
+  t_loopback_discard();
+  sent = server.datagrams;
+
+  /* the client's timeout expires before the server's */
+  t_loopback_advance(1);
+  dtls_check_retransmit(client.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(t_loopback_queued(), datagrams);
+  CU_ASSERT_EQUAL(server.datagrams, sent + (int)datagrams);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+
+  /* a round trip takes two seconds now */
+  CU_ASSERT(dtls_close(client.ctx, &server.addr) == 0);
+  t_loopback_flush();
+  t_loopback_set_delay(1);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 2);
+  t_loopback_set_delay(0);
+
+  /* the ClientHello of the new peer has crossed the flight */
+  CU_ASSERT_EQUAL(server_hello_flight(&other), datagrams);
+  t_loopback_discard();
+  sent = server.datagrams;
+  t_loopback_advance(1);
+  dtls_check_retransmit(other.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+  CU_ASSERT_EQUAL(server.datagrams, sent);
+
+  /* but not the next one */
+  t_loopback_advance(2);
+  dtls_check_retransmit(other.ctx, NULL);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(t_loopback_queued(), datagrams);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(other.connected, 1);
+
+  t_loopback_free(&other);
+  t_flight_teardown();
+}
+
+/* The server's last flight is kept after the handshake, a Finished
+ * sent again by the client makes the server send it again. */
+static void
+t_flight_resend_finished(void) {
+  int sent;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  server_hello_flight(&client);
+  deliver_queued();             /* ServerHello ... ServerHelloDone */
+  deliver_queued();             /* Certificate ... Finished */
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_FATAL(t_loopback_queued() > 0);
+  t_loopback_discard();
+  sent = server.datagrams;
+
+  t_loopback_advance(3);
+  dtls_check_retransmit(client.ctx, NULL);
+  CU_ASSERT(t_loopback_queued() > 0);
+  deliver_queued();
+  CU_ASSERT(server.datagrams > sent);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+
+  t_flight_teardown();
+}
+
+/* A Finished that arrives before the ChangeCipherSpec is kept until
+ * the epoch has been changed, and then completes the handshake. */
+static void
+t_flight_finished_before_ccs(void) {
+  uint8 ccs[DTLS_MAX_BUF], *data;
+  size_t length;
+  dtls_peer_t *peer;
+  int records;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  server_hello_flight(&client);
+  deliver_queued();
+  CU_ASSERT_FATAL(t_loopback_queued() == 1);
+
+  /* the ChangeCipherSpec is the last but one record of the flight */
+  records = t_loopback_split(0);
+  CU_ASSERT_FATAL(records >= 3);
+  data = t_loopback_datagram(records - 2, &length);
+  CU_ASSERT_FATAL(data != NULL && length <= sizeof(ccs));
+  CU_ASSERT_EQUAL(data[0], DTLS_CT_CHANGE_CIPHER_SPEC);
+  memcpy(ccs, data, length);
+  t_loopback_drop(records - 2);
+
+  deliver_queued();
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+  CU_ASSERT_EQUAL(server.connected, 0);
+  peer = t_loopback_peer(&server, &client);
+  CU_ASSERT_FATAL(peer != NULL && peer->handshake_params != NULL);
+  CU_ASSERT(peer->handshake_params->next_epoch_records != NULL);
+
+  CU_ASSERT(t_loopback_send(&client, &server, ccs, length) > 0);
+  deliver_queued();
+  CU_ASSERT_EQUAL(server.connected, 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+
+  t_flight_teardown();
+}
+
+/* Checks that each queued datagram fits @p mtu, and that the first
+ * record of the next datagram would not have fit in as well. Returns
+ * the number of datagrams. */
+static size_t
+check_packed(size_t mtu) {
+  size_t i, length, next_length, count = t_loopback_queued();
+  uint8 *next;
+
+  for (i = 0; i < count; i++) {
+    CU_ASSERT_FATAL(t_loopback_datagram(i, &length) != NULL);
+    CU_ASSERT(length <= mtu);
+    next = t_loopback_datagram(i + 1, &next_length);
+    if (next)
+      CU_ASSERT(length + t_loopback_record_length(next, NULL) > mtu);
+  }
+  return count;
+}
+
+/* The records of a flight are packed into as few datagrams as the
+ * MTU permits. */
+static void
+t_flight_packing(void) {
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  /* a flight of the handshake fits into one datagram */
+  server_hello_flight(&client);
+  CU_ASSERT_EQUAL(check_packed(DTLS_DEFAULT_MTU), 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(check_packed(DTLS_DEFAULT_MTU), 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(check_packed(DTLS_DEFAULT_MTU), 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  t_flight_teardown();
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  dtls_set_mtu(server.ctx, 200);
+  dtls_set_mtu(client.ctx, 200);
+
+  server_hello_flight(&client);
+  CU_ASSERT(check_packed(200) > 1);
+  deliver_queued();
+  CU_ASSERT(check_packed(200) > 1);
+  deliver_queued();
+  CU_ASSERT_EQUAL(check_packed(200), 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+
+  t_flight_teardown();
+}
+
+/* A path MTU reported while a flight is lost applies to its
+ * retransmission. */
+static void
+t_flight_path_mtu(void) {
+  CU_ASSERT_FATAL(t_flight_setup(TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+
+  CU_ASSERT_EQUAL(server_hello_flight(&client), 1);
+  t_loopback_discard();
+  CU_ASSERT(dtls_report_path_mtu(server.ctx, &client.addr, 200) == 0);
+  /* the limit is never raised */
+  CU_ASSERT(dtls_report_path_mtu(server.ctx, &client.addr, 1000) == 0);
+
+  t_loopback_advance(3);
+  dtls_check_retransmit(server.ctx, NULL);
+  CU_ASSERT(check_packed(200) > 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+
+  t_flight_teardown();
+}
+
+#if DTLS_RECORD_SIZE_LIMIT > 0
+/* the limit a context announces, as in dtls.c */
+#define OWN_RECORD_SIZE_LIMIT min(max(DTLS_RECORD_SIZE_LIMIT, 64), 16384)
+
+/* Application data beyond the record size limit the peer has
+ * announced is not sent. */
+static void
+t_flight_record_size_limit(void) {
+  uint8 data[OWN_RECORD_SIZE_LIMIT + 1], *record;
+  size_t length, header;
+  dtls_peer_t *peer;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(server.connected == 1);
+  peer = t_loopback_peer(&server, &client);
+  CU_ASSERT_FATAL(peer != NULL);
+  CU_ASSERT_EQUAL(peer->record_size_limit, OWN_RECORD_SIZE_LIMIT);
+
+  memset(data, 'x', sizeof(data));
+  CU_ASSERT(dtls_write(server.ctx, &client.addr, data,
+                       OWN_RECORD_SIZE_LIMIT) == OWN_RECORD_SIZE_LIMIT);
+  record = t_loopback_datagram(0, &length);
+  CU_ASSERT_FATAL(record != NULL);
+  CU_ASSERT_EQUAL(t_loopback_record_length(record, &header), length);
+  /* explicit nonce and MAC of AES_128_CCM_8 */
+  CU_ASSERT_EQUAL(length - header, OWN_RECORD_SIZE_LIMIT + 8 + 8);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.received, OWN_RECORD_SIZE_LIMIT);
+
+  CU_ASSERT(dtls_write(server.ctx, &client.addr, data, sizeof(data)) < 0);
+  CU_ASSERT_EQUAL(t_loopback_queued(), 0);
+
+  t_flight_teardown();
+}
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+
+#if DTLS_VALIDATED_ADDRESSES > 0
+/* Returns the handshake type of the first record of the queued
+ * datagram @p i. */
+static uint8
+handshake_type(size_t i) {
+  size_t length;
+  uint8 *data = t_loopback_datagram(i, &length);
+
+  CU_ASSERT_FATAL(data != NULL && length > sizeof(dtls_record_header_t));
+  return data[sizeof(dtls_record_header_t)];
+}
+
+/* After a cookie exchange, further clients from the same address get
+ * the ServerHello right away, but not if they arrive too fast. */
+static void
+t_flight_validated_address(void) {
+  static const dtls_address_validation_t validation = { 60, 1 };
+  t_loopback_endpoint_t other;
+
+  CU_ASSERT_FATAL(t_flight_setup(TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT_FATAL(t_loopback_init(&other, 20262,
+                                  TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT(dtls_set_address_validation(server.ctx, &validation) == 0);
+
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  deliver_queued();
+  CU_ASSERT_EQUAL(handshake_type(0), DTLS_HT_HELLO_VERIFY_REQUEST);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+
+  /* the address is known, but two ClientHellos within a second exceed
+   * the rate */
+  CU_ASSERT(t_loopback_connect(&other, &server) > 0);
+  deliver_queued();
+  CU_ASSERT_EQUAL(handshake_type(0), DTLS_HT_HELLO_VERIFY_REQUEST);
+  t_loopback_discard();
+
+  t_loopback_advance(3);
+  dtls_check_retransmit(other.ctx, NULL);
+  deliver_queued();
+  CU_ASSERT_EQUAL(handshake_type(0), DTLS_HT_SERVER_HELLO);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(other.connected, 1);
+
+  t_loopback_free(&other);
+  t_flight_teardown();
+}
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+
+CU_pSuite
+t_init_flight_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("flights", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add flight test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define FLIGHT_TEST(s,t)                                                \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for flights (%s)\n",            \
+            CU_get_error_msg());                                        \
+  }
+
+  FLIGHT_TEST(suite, t_flight_retransmit);
+  FLIGHT_TEST(suite, t_flight_rtt);
+  FLIGHT_TEST(suite, t_flight_pacing);
+  FLIGHT_TEST(suite, t_flight_resend_on_duplicate);
+  FLIGHT_TEST(suite, t_flight_resend_finished);
+  FLIGHT_TEST(suite, t_flight_finished_before_ccs);
+  FLIGHT_TEST(suite, t_flight_packing);
+  FLIGHT_TEST(suite, t_flight_path_mtu);
+#if DTLS_RECORD_SIZE_LIMIT > 0
+  FLIGHT_TEST(suite, t_flight_record_size_limit);
+#endif /* DTLS_RECORD_SIZE_LIMIT > 0 */
+#if DTLS_VALIDATED_ADDRESSES > 0
+  FLIGHT_TEST(suite, t_flight_validated_address);
+#endif /* DTLS_VALIDATED_ADDRESSES > 0 */
+
+  return suite;
+}
+
+#else /* DTLS_ECC && DTLS_PSK */
+
+CU_pSuite
+t_init_flight_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_ECC && DTLS_PSK */
@@ -0,0 +1,234 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_fragment.h"
+#include "test_loopback.h"
+
+#include "numeric.h"
+
+#ifdef DTLS_ECC
+
+#define RH_LENGTH sizeof(dtls_record_header_t)
+#define HS_LENGTH sizeof(dtls_handshake_header_t)
+
+static t_loopback_endpoint_t server, client;
+
+/* the server's Certificate in a single record */
+static uint8 certificate[DTLS_MAX_BUF];
+static size_t certificate_length;
+/* the records that follow it in the server's flight */
+static uint8 remaining[DTLS_MAX_BUF];
+static size_t remaining_length;
+/* sequence number of the next fragment, beyond those of the server */
+static uint64_t sequence_number;
+
+/* Runs the handshake up to the server's flight with the ServerHello,
+ * delivers the ServerHello and keeps the Certificate and the records
+ * after it. */
+static void
+t_fragment_setup(void) {
+  size_t i, length;
+  uint8 *data;
+  int records;
+
+  CU_ASSERT_FATAL(t_loopback_init(&server, 20270,
+                                  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT_FATAL(t_loopback_init(&client, 20271,
+                                  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT(t_loopback_connect(&client, &server) > 0);
+  for (i = 0; i < 3; i++)       /* up to the ClientHello with cookie */
+    t_loopback_step();
+  CU_ASSERT_FATAL(t_loopback_queued() == 1);
+
+  records = t_loopback_split(0);
+  CU_ASSERT_FATAL(records > 2);
+  t_loopback_step();            /* ServerHello */
+
+  data = t_loopback_datagram(0, &certificate_length);
+  CU_ASSERT_FATAL(data != NULL);
+  CU_ASSERT_FATAL(data[RH_LENGTH] == DTLS_HT_CERTIFICATE);
+  memcpy(certificate, data, certificate_length);
+  t_loopback_drop(0);
+
+  sequence_number = 0;
+  remaining_length = 0;
+  while ((data = t_loopback_datagram(0, &length))) {
+    CU_ASSERT_FATAL(remaining_length + length <= sizeof(remaining));
+    memcpy(remaining + remaining_length, data, length);
+    remaining_length += length;
+    sequence_number = max(sequence_number, dtls_uint48_to_int(data + 5));
+    t_loopback_drop(0);
+  }
+  /* the next ones are left to the server's last records of epoch 0,
+   * e.g. NewSessionTicket and ChangeCipherSpec */
+  sequence_number += 16;
+}
+
+static void
+t_fragment_teardown(void) {
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/* Returns the length of the Certificate message without header. */
+static size_t
+message_length(void) {
+  return dtls_uint24_to_int(certificate + RH_LENGTH + 1);
+}
+
+/* Sends the fragment of the Certificate at @p offset with @p length
+ * bytes to the client, in a handshake header with @p type and the
+ * message length @p total. */
+static void
+send_fragment_as(uint8 type, size_t total, size_t offset, size_t length) {
+  uint8 record[DTLS_MAX_BUF];
+
+  CU_ASSERT_FATAL(RH_LENGTH + HS_LENGTH + length <= sizeof(record));
+  CU_ASSERT_FATAL(offset + length <= message_length());
+
+  memcpy(record, certificate, RH_LENGTH + HS_LENGTH);
+  dtls_int_to_uint48(record + 5, sequence_number++);
+  dtls_int_to_uint16(record + 11, HS_LENGTH + length);
+  record[RH_LENGTH] = type;
+  dtls_int_to_uint24(record + RH_LENGTH + 1, total);
+  dtls_int_to_uint24(record + RH_LENGTH + 6, offset);
+  dtls_int_to_uint24(record + RH_LENGTH + 9, length);
+  memcpy(record + RH_LENGTH + HS_LENGTH,
+         certificate + RH_LENGTH + HS_LENGTH + offset, length);
+  CU_ASSERT(t_loopback_send(&server, &client, record,
+                            RH_LENGTH + HS_LENGTH + length) > 0);
+}
+
+static void
+send_fragment(size_t offset, size_t length) {
+  send_fragment_as(DTLS_HT_CERTIFICATE, message_length(), offset, length);
+}
+
+/* Delivers the rest of the server's flight and completes the
+ * handshake. */
+static void
+finish_handshake(void) {
+  CU_ASSERT(t_loopback_send(&server, &client,
+                            remaining, remaining_length) > 0);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.connected, 1);
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+}
+
+static void
+t_fragment_reordered(void) {
+  size_t third;
+
+  t_fragment_setup();
+  third = message_length() / 3;
+
+  send_fragment(2 * third, message_length() - 2 * third);
+  send_fragment(0, third);
+  send_fragment(third, third);
+  finish_handshake();
+
+  t_fragment_teardown();
+}
+
+static void
+t_fragment_overlapping(void) {
+  size_t half;
+
+  t_fragment_setup();
+  half = message_length() / 2;
+
+  send_fragment(0, half + 10);
+  send_fragment(half - 10, message_length() - half + 10);
+  finish_handshake();
+
+  t_fragment_teardown();
+}
+
+static void
+t_fragment_duplicate(void) {
+  size_t half;
+
+  t_fragment_setup();
+  half = message_length() / 2;
+
+  send_fragment(0, half);
+  send_fragment(0, half);
+  send_fragment(half, message_length() - half);
+  send_fragment(half, message_length() - half);
+  finish_handshake();
+
+  t_fragment_teardown();
+}
+
+/* Fragments that do not match the message buffered for their message
+ * sequence number are ignored. */
+static void
+t_fragment_conflicting(void) {
+  size_t half;
+
+  t_fragment_setup();
+  half = message_length() / 2;
+
+  send_fragment(0, half);
+  send_fragment_as(DTLS_HT_CERTIFICATE, message_length() + 1,
+                   half, message_length() - half);
+  send_fragment_as(DTLS_HT_SERVER_KEY_EXCHANGE, message_length(),
+                   half, message_length() - half);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client.fatal, 0);
+
+  send_fragment(half, message_length() - half);
+  finish_handshake();
+
+  t_fragment_teardown();
+}
+
+CU_pSuite
+t_init_fragment_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("fragments", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add fragment test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define FRAGMENT_TEST(s,t)                                              \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for fragments (%s)\n",          \
+            CU_get_error_msg());                                        \
+  }
+
+  FRAGMENT_TEST(suite, t_fragment_reordered);
+  FRAGMENT_TEST(suite, t_fragment_overlapping);
+  FRAGMENT_TEST(suite, t_fragment_duplicate);
+  FRAGMENT_TEST(suite, t_fragment_conflicting);
+
+  return suite;
+}
+
+#else /* DTLS_ECC */
+
+CU_pSuite
+t_init_fragment_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_ECC */
@@ -0,0 +1,271 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_limits.h"
+#include "test_loopback.h"
+
+#include "dtls_time.h"
+#include "peer.h"
+
+#ifdef DTLS_PSK
+
+static t_loopback_endpoint_t server, client_a, client_b, client_c;
+
+/* Each test starts with fresh contexts. */
+static int
+t_limits_setup(void) {
+  if (t_loopback_init(&server, 20220, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&client_a, 20221, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&client_b, 20222, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&client_c, 20223, TLS_PSK_WITH_AES_128_CCM_8) < 0)
+    return -1;
+  return 0;
+}
+
+static void
+t_limits_teardown(void) {
+  t_loopback_free(&client_c);
+  t_loopback_free(&client_b);
+  t_loopback_free(&client_a);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+static void
+set_limits(t_loopback_endpoint_t *ep, unsigned int max_peers,
+           unsigned int max_handshakes, unsigned int evict_idle) {
+  dtls_peer_limits_t limits;
+
+  memset(&limits, 0, sizeof(limits));
+  limits.max_peers = max_peers;
+  limits.max_handshakes = max_handshakes;
+  limits.evict_idle = evict_idle;
+  limits.evict_close_notify = 1;
+  limits.reject = DTLS_REJECT_ALERT;
+  dtls_set_peer_limits(ep->ctx, &limits);
+}
+
+static int
+connect_and_flush(t_loopback_endpoint_t *client) {
+  int res = t_loopback_connect(client, &server);
+
+  t_loopback_flush();
+  return res;
+}
+
+/* At max_peers, the least recently used established peer is evicted
+ * and receives a close_notify. */
+static void
+t_limits_lru_eviction(void) {
+  CU_ASSERT_FATAL(t_limits_setup() == 0);
+  set_limits(&server, 2, 0, 0);
+
+  CU_ASSERT(connect_and_flush(&client_a) > 0);
+  CU_ASSERT(connect_and_flush(&client_b) > 0);
+  CU_ASSERT_EQUAL(server.connected, 2);
+
+  /* a record from a makes b the least recently used peer */
+  CU_ASSERT(dtls_write(client_a.ctx, &server.addr, (uint8 *)"a", 1) == 1);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 1);
+
+  CU_ASSERT(connect_and_flush(&client_c) > 0);
+  CU_ASSERT_EQUAL(server.connected, 3);
+  CU_ASSERT_EQUAL(client_c.connected, 1);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) != NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_b) == NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_c) != NULL);
+  CU_ASSERT_EQUAL(client_b.closed, 1);
+  CU_ASSERT_EQUAL(client_a.closed + client_c.closed, 0);
+
+  t_limits_teardown();
+}
+
+/* Peers that have not been idle for evict_idle seconds are kept, the
+ * new peer is rejected instead. */
+static void
+t_limits_reject(void) {
+  t_loopback_endpoint_t other;
+
+  CU_ASSERT_FATAL(t_limits_setup() == 0);
+  set_limits(&server, 1, 0, 3600);
+
+  CU_ASSERT(connect_and_flush(&client_a) > 0);
+  CU_ASSERT(connect_and_flush(&client_b) > 0);
+  CU_ASSERT_EQUAL(server.connected, 1);
+  CU_ASSERT_EQUAL(client_b.connected, 0);
+  CU_ASSERT_EQUAL(client_b.fatal, 1);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) != NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_b) == NULL);
+  CU_ASSERT_EQUAL(client_a.closed, 0);
+
+  /* the limits of a client make dtls_connect() fail */
+  CU_ASSERT_FATAL(t_loopback_init(&other, 20230, TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  set_limits(&client_a, 1, 0, 3600);
+  CU_ASSERT(t_loopback_connect(&client_a, &other) < 0);
+  t_loopback_free(&other);
+
+  t_limits_teardown();
+}
+
+/* Peers without a completed handshake count against max_handshakes,
+ * established ones do not. */
+static void
+t_limits_handshakes(void) {
+  CU_ASSERT_FATAL(t_limits_setup() == 0);
+  set_limits(&server, 0, 1, 0);
+
+  CU_ASSERT(connect_and_flush(&client_a) > 0);
+  CU_ASSERT_EQUAL(server.connected, 1);
+
+  /* stall the handshake of b after the server has created its peer */
+  CU_ASSERT(t_loopback_connect(&client_b, &server) > 0);
+  while (!t_loopback_peer(&server, &client_b) && t_loopback_step())
+    ;
+  CU_ASSERT_FATAL(t_loopback_peer(&server, &client_b) != NULL);
+  t_loopback_discard();
+
+  CU_ASSERT(connect_and_flush(&client_c) > 0);
+  CU_ASSERT_EQUAL(client_c.fatal, 1);
+  CU_ASSERT(t_loopback_peer(&server, &client_c) == NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) != NULL);
+
+  t_limits_teardown();
+}
+
+/* Moves the start of the handshake or the last record of the peer of
+ * @p remote in the server @p seconds into the past. */
+static void
+age_peer(t_loopback_endpoint_t *remote, unsigned int seconds) {
+  dtls_peer_t *peer = t_loopback_peer(&server, remote);
+
+  CU_ASSERT_FATAL(peer != NULL);
+  peer->last_seen -= seconds * DTLS_TICKS_PER_SECOND;
+}
+
+static void
+set_timeouts(t_loopback_endpoint_t *ep, unsigned int idle_timeout,
+             unsigned int handshake_timeout) {
+  dtls_peer_limits_t limits;
+
+  memset(&limits, 0, sizeof(limits));
+  limits.evict_close_notify = 1;
+  limits.idle_timeout = idle_timeout;
+  limits.handshake_timeout = handshake_timeout;
+  dtls_set_peer_limits(ep->ctx, &limits);
+}
+
+/* dtls_check_retransmit() removes peers that exceeded their timeout,
+ * the oldest first, and reports the next timeout. */
+static void
+t_limits_idle_timeout(void) {
+  clock_time_t next;
+  dtls_tick_t now;
+
+  CU_ASSERT_FATAL(t_limits_setup() == 0);
+  set_timeouts(&server, 60, 10);
+
+  CU_ASSERT(connect_and_flush(&client_a) > 0);
+  CU_ASSERT(connect_and_flush(&client_b) > 0);
+  CU_ASSERT_EQUAL(server.connected, 2);
+
+  dtls_ticks(&now);
+  dtls_check_retransmit(server.ctx, &next);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) != NULL);
+  CU_ASSERT(next > now + 59 * DTLS_TICKS_PER_SECOND);
+  CU_ASSERT(next <= now + 60 * DTLS_TICKS_PER_SECOND);
+
+  age_peer(&client_a, 61);
+  dtls_check_retransmit(server.ctx, &next);
+  CU_ASSERT_EQUAL(server.last_event, DTLS_EVENT_IDLE_TIMEOUT);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) == NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_b) != NULL);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client_a.closed, 1);
+  CU_ASSERT_EQUAL(client_b.closed, 0);
+
+  /* a record keeps the session alive */
+  age_peer(&client_b, 50);
+  CU_ASSERT(dtls_write(client_b.ctx, &server.addr, (uint8 *)"b", 1) == 1);
+  t_loopback_flush();
+  age_peer(&client_b, 50);
+  dtls_check_retransmit(server.ctx, &next);
+  CU_ASSERT(t_loopback_peer(&server, &client_b) != NULL);
+
+  t_limits_teardown();
+}
+
+static void
+t_limits_handshake_timeout(void) {
+  clock_time_t next;
+
+  CU_ASSERT_FATAL(t_limits_setup() == 0);
+  set_timeouts(&server, 60, 10);
+
+  CU_ASSERT(connect_and_flush(&client_a) > 0);
+
+  CU_ASSERT(t_loopback_connect(&client_b, &server) > 0);
+  while (!t_loopback_peer(&server, &client_b) && t_loopback_step())
+    ;
+  t_loopback_discard();
+
+  age_peer(&client_b, 11);
+  dtls_check_retransmit(server.ctx, &next);
+  CU_ASSERT_EQUAL(server.last_event, DTLS_EVENT_HANDSHAKE_TIMEOUT);
+  CU_ASSERT(t_loopback_peer(&server, &client_b) == NULL);
+  CU_ASSERT(t_loopback_peer(&server, &client_a) != NULL);
+  /* no close_notify without a session */
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(client_b.closed, 0);
+
+  t_limits_teardown();
+}
+
+CU_pSuite
+t_init_limits_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("peer limits", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add peer limits test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define LIMITS_TEST(s,t)                                                \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for peer limits (%s)\n",        \
+            CU_get_error_msg());                                        \
+  }
+
+  LIMITS_TEST(suite, t_limits_lru_eviction);
+  LIMITS_TEST(suite, t_limits_reject);
+  LIMITS_TEST(suite, t_limits_handshakes);
+  LIMITS_TEST(suite, t_limits_idle_timeout);
+  LIMITS_TEST(suite, t_limits_handshake_timeout);
+
+  return suite;
+}
+
+#else /* DTLS_PSK */
+
+CU_pSuite
+t_init_limits_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_PSK */
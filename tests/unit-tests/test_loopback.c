@@ -0,0 +1,394 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <string.h>
+
+#include "test_loopback.h"
+#include "dtls_time.h"
+#include "numeric.h"
+
+#define T_LOOPBACK_ENDPOINTS 16
+#define T_LOOPBACK_QUEUE 64
+
+typedef struct {
+  session_t from;
+  session_t to;
+  dtls_tick_t sent;
+  size_t length;
+  uint8 data[DTLS_MAX_BUF];
+} t_datagram_t;
+
+static t_loopback_endpoint_t *endpoints[T_LOOPBACK_ENDPOINTS];
+static t_datagram_t queue[T_LOOPBACK_QUEUE];
+static size_t queue_head, queue_count;
+static unsigned int delay;
+
+/* the clock of dtls_ticks() starts at this time */
+extern time_t dtls_clock_offset;
+
+#ifdef DTLS_PSK
+static const unsigned char psk_id[] = "Client_identity";
+static const unsigned char psk_key[] = "secretPSK";
+#endif /* DTLS_PSK */
+
+#ifdef DTLS_ECC
+static const unsigned char ecdsa_priv_key[] = {
+  0xD9, 0xE2, 0x70, 0x7A, 0x72, 0xDA, 0x6A, 0x05,
+  0x04, 0x99, 0x5C, 0x86, 0xED, 0xDB, 0xE3, 0xEF,
+  0xC7, 0xF1, 0xCD, 0x74, 0x83, 0x8F, 0x75, 0x70,
+  0xC8, 0x07, 0x2D, 0x0A, 0x76, 0x26, 0x1B, 0xD4};
+
+static const unsigned char ecdsa_pub_key_x[] = {
+  0xD0, 0x55, 0xEE, 0x14, 0x08, 0x4D, 0x6E, 0x06,
+  0x15, 0x59, 0x9D, 0xB5, 0x83, 0x91, 0x3E, 0x4A,
+  0x3E, 0x45, 0x26, 0xA2, 0x70, 0x4D, 0x61, 0xF2,
+  0x7A, 0x4C, 0xCF, 0xBA, 0x97, 0x58, 0xEF, 0x9A};
+
+static const unsigned char ecdsa_pub_key_y[] = {
+  0xB4, 0x18, 0xB6, 0x4A, 0xFE, 0x80, 0x30, 0xDA,
+  0x1D, 0xDC, 0xF4, 0xF4, 0x2E, 0x2F, 0x26, 0x31,
+  0xD0, 0x43, 0xB1, 0xFB, 0x03, 0xE2, 0x2F, 0x4D,
+  0x17, 0xDE, 0x43, 0xF9, 0xF9, 0xAD, 0xEE, 0x70};
+#endif /* DTLS_ECC */
+
+static t_loopback_endpoint_t *
+find_endpoint(const session_t *addr) {
+  size_t i;
+
+  for (i = 0; i < T_LOOPBACK_ENDPOINTS; i++) {
+    if (endpoints[i] && dtls_session_equals(&endpoints[i]->addr, addr))
+      return endpoints[i];
+  }
+  return NULL;
+}
+
+static int
+queue_datagram(const session_t *from, const session_t *to,
+               const uint8 *data, size_t len) {
+  t_datagram_t *d;
+
+  if (queue_count == T_LOOPBACK_QUEUE || len > sizeof(d->data))
+    return -1;
+
+  d = &queue[(queue_head + queue_count) % T_LOOPBACK_QUEUE];
+  d->from = *from;
+  d->to = *to;
+  dtls_ticks(&d->sent);
+  d->length = len;
+  memcpy(d->data, data, len);
+  queue_count++;
+  return len;
+}
+
+static int
+send_to_peer(struct dtls_context_t *ctx,
+             session_t *session, uint8 *data, size_t len) {
+  t_loopback_endpoint_t *ep = dtls_get_app_data(ctx);
+
+  ep->datagrams++;
+  return queue_datagram(&ep->addr, session, data, len);
+}
+
+static int
+read_from_peer(struct dtls_context_t *ctx,
+               session_t *session, uint8 *data, size_t len) {
+  t_loopback_endpoint_t *ep = dtls_get_app_data(ctx);
+  (void)session;
+  (void)data;
+
+  ep->received += len;
+  return 0;
+}
+
+static int
+handle_event(struct dtls_context_t *ctx, session_t *session,
+             dtls_alert_level_t level, unsigned short code) {
+  t_loopback_endpoint_t *ep = dtls_get_app_data(ctx);
+  (void)session;
+
+  ep->last_event = code;
+  if (level == DTLS_ALERT_LEVEL_FATAL)
+    ep->fatal++;
+  else if (level != 0 && code == DTLS_ALERT_CLOSE_NOTIFY)
+    ep->closed++;
+  else if (level == 0 && code == DTLS_EVENT_CONNECTED)
+    ep->connected++;
+  return 0;
+}
+
+static void
+get_user_parameters(struct dtls_context_t *ctx, session_t *session,
+                    dtls_user_parameters_t *parameters) {
+  t_loopback_endpoint_t *ep = dtls_get_app_data(ctx);
+  (void)session;
+
+  parameters->cipher_suites[0] = ep->cipher;
+  parameters->cipher_suites[1] = TLS_NULL_WITH_NULL_NULL;
+}
+
+#ifdef DTLS_PSK
+static int
+get_psk_info(struct dtls_context_t *ctx,
+             const session_t *session,
+             dtls_credentials_type_t type,
+             const unsigned char *id, size_t id_len,
+             unsigned char *result, size_t result_length) {
+  (void)ctx;
+  (void)session;
+
+  switch (type) {
+  case DTLS_PSK_IDENTITY:
+    if (result_length < sizeof(psk_id) - 1)
+      break;
+    memcpy(result, psk_id, sizeof(psk_id) - 1);
+    return sizeof(psk_id) - 1;
+  case DTLS_PSK_KEY:
+    if (id_len != sizeof(psk_id) - 1 || memcmp(psk_id, id, id_len) != 0)
+      return dtls_alert_fatal_create(DTLS_ALERT_ILLEGAL_PARAMETER);
+    if (result_length < sizeof(psk_key) - 1)
+      break;
+    memcpy(result, psk_key, sizeof(psk_key) - 1);
+    return sizeof(psk_key) - 1;
+  case DTLS_PSK_HINT:
+    return 0;
+  default:
+    break;
+  }
+  return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+}
+#endif /* DTLS_PSK */
+
+#ifdef DTLS_ECC
+static int
+get_ecdsa_key(struct dtls_context_t *ctx,
+              const session_t *session,
+              const dtls_ecdsa_key_t **result) {
+  static const dtls_ecdsa_key_t ecdsa_key = {
+    .curve = DTLS_ECDH_CURVE_SECP256R1,
+    .priv_key = ecdsa_priv_key,
+    .pub_key_x = ecdsa_pub_key_x,
+    .pub_key_y = ecdsa_pub_key_y
+  };
+  (void)ctx;
+  (void)session;
+
+  *result = &ecdsa_key;
+  return 0;
+}
+
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx,
+                 const session_t *session,
+                 const unsigned char *other_pub_x,
+                 const unsigned char *other_pub_y,
+                 size_t key_size) {
+  (void)ctx;
+  (void)session;
+
+  if (key_size != sizeof(ecdsa_pub_key_x) ||
+      memcmp(other_pub_x, ecdsa_pub_key_x, key_size) != 0 ||
+      memcmp(other_pub_y, ecdsa_pub_key_y, key_size) != 0)
+    return dtls_alert_fatal_create(DTLS_ALERT_BAD_CERTIFICATE);
+  return 0;
+}
+#endif /* DTLS_ECC */
+
+int
+t_loopback_init(t_loopback_endpoint_t *ep, unsigned short port,
+                dtls_cipher_t cipher) {
+  static int initialized = 0;
+  size_t i;
+
+  if (!initialized) {
+    dtls_init();
+    initialized = 1;
+  }
+
+  memset(ep, 0, sizeof(*ep));
+  dtls_session_init(&ep->addr);
+  ep->addr.size = sizeof(ep->addr.addr.sin);
+  ep->addr.addr.sin.sin_family = AF_INET;
+  ep->addr.addr.sin.sin_port = htons(port);
+  ep->addr.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ep->cipher = cipher;
+
+  ep->handler.write = send_to_peer;
+  ep->handler.read = read_from_peer;
+  ep->handler.event = handle_event;
+  ep->handler.get_user_parameters = get_user_parameters;
+#ifdef DTLS_PSK
+  ep->handler.get_psk_info = get_psk_info;
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  ep->handler.get_ecdsa_key = get_ecdsa_key;
+  ep->handler.verify_ecdsa_key = verify_ecdsa_key;
+#endif /* DTLS_ECC */
+
+  for (i = 0; i < T_LOOPBACK_ENDPOINTS; i++) {
+    if (!endpoints[i])
+      break;
+  }
+  if (i == T_LOOPBACK_ENDPOINTS)
+    return -1;
+
+  ep->ctx = dtls_new_context(ep);
+  if (!ep->ctx)
+    return -1;
+  dtls_set_handler(ep->ctx, &ep->handler);
+  endpoints[i] = ep;
+  return 0;
+}
+
+void
+t_loopback_free(t_loopback_endpoint_t *ep) {
+  size_t i;
+
+  for (i = 0; i < T_LOOPBACK_ENDPOINTS; i++) {
+    if (endpoints[i] == ep)
+      endpoints[i] = NULL;
+  }
+  dtls_free_context(ep->ctx);
+  ep->ctx = NULL;
+}
+
+int
+t_loopback_connect(t_loopback_endpoint_t *client,
+                   t_loopback_endpoint_t *server) {
+  return dtls_connect(client->ctx, &server->addr);
+}
+
+int
+t_loopback_step(void) {
+  t_loopback_endpoint_t *ep;
+  t_datagram_t d;
+  dtls_tick_t now;
+
+  while (queue_count) {
+    /* copy, delivering may queue the next records */
+    d = queue[queue_head];
+    queue_head = (queue_head + 1) % T_LOOPBACK_QUEUE;
+    queue_count--;
+
+    ep = find_endpoint(&d.to);
+    if (ep) {
+      dtls_ticks(&now);
+      if (now - d.sent < delay * DTLS_TICKS_PER_SECOND)
+        t_loopback_advance(delay - (now - d.sent) / DTLS_TICKS_PER_SECOND);
+      dtls_handle_message(ep->ctx, &d.from, d.data, d.length);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+t_loopback_flush(void) {
+  int count = 0;
+
+  while (t_loopback_step())
+    count++;
+  return count;
+}
+
+void
+t_loopback_discard(void) {
+  queue_head = queue_count = 0;
+}
+
+size_t
+t_loopback_queued(void) {
+  return queue_count;
+}
+
+uint8 *
+t_loopback_datagram(size_t i, size_t *length) {
+  t_datagram_t *d;
+
+  if (i >= queue_count)
+    return NULL;
+  d = &queue[(queue_head + i) % T_LOOPBACK_QUEUE];
+  *length = d->length;
+  return d->data;
+}
+
+void
+t_loopback_drop(size_t i) {
+  for (; i + 1 < queue_count; i++) {
+    queue[(queue_head + i) % T_LOOPBACK_QUEUE] =
+      queue[(queue_head + i + 1) % T_LOOPBACK_QUEUE];
+  }
+  if (i < queue_count)
+    queue_count--;
+}
+
+size_t
+t_loopback_record_length(const uint8 *record, size_t *header) {
+  size_t header_length = sizeof(dtls_record_header_t);
+
+  if (record[0] == DTLS_CT_TLS12_CID)
+    header_length += DTLS_CID_LENGTH;
+  if (header)
+    *header = header_length;
+  return header_length + dtls_uint16_to_int(record + header_length - 2);
+}
+
+int
+t_loopback_split(size_t i) {
+  t_datagram_t d;
+  size_t offset, length, after;
+  int count = 0;
+
+  if (i >= queue_count)
+    return -1;
+  d = queue[(queue_head + i) % T_LOOPBACK_QUEUE];
+  t_loopback_drop(i);
+  after = queue_count - i;
+
+  /* append the records, then move the datagrams that followed d
+   * behind them */
+  for (offset = 0; offset + sizeof(dtls_record_header_t) <= d.length;
+       offset += length) {
+    length = t_loopback_record_length(d.data + offset, NULL);
+    if (offset + length > d.length ||
+        queue_datagram(&d.from, &d.to, d.data + offset, length) < 0)
+      return -1;
+    count++;
+  }
+  for (; after; after--) {
+    d = queue[(queue_head + i) % T_LOOPBACK_QUEUE];
+    t_loopback_drop(i);
+    queue[(queue_head + queue_count) % T_LOOPBACK_QUEUE] = d;
+    queue_count++;
+  }
+  return count;
+}
+
+int
+t_loopback_send(t_loopback_endpoint_t *from, t_loopback_endpoint_t *to,
+                const uint8 *data, size_t length) {
+  return queue_datagram(&from->addr, &to->addr, data, length);
+}
+
+void
+t_loopback_advance(unsigned int seconds) {
+  dtls_clock_offset -= seconds;
+}
+
+void
+t_loopback_set_delay(unsigned int seconds) {
+  delay = seconds;
+}
+
+dtls_peer_t *
+t_loopback_peer(t_loopback_endpoint_t *ep, t_loopback_endpoint_t *remote) {
+  return dtls_get_peer(ep->ctx, &remote->addr);
+}
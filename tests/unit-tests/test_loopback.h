@@ -0,0 +1,119 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+/*
+ * In-memory network for tests that run handshakes between several
+ * contexts. Records written by an endpoint are queued and delivered
+ * to the endpoint with the destination address by t_loopback_flush().
+ */
+
+#ifndef _TEST_LOOPBACK_H_
+#define _TEST_LOOPBACK_H_
+
+#include "tinydtls.h"
+#include "dtls.h"
+
+typedef struct t_loopback_endpoint_t {
+  dtls_context_t *ctx;
+  session_t addr;		/**< own address */
+  dtls_handler_t handler;	/**< may be changed by the test */
+  dtls_cipher_t cipher;		/**< the only cipher suite offered */
+  int connected;		/**< number of DTLS_EVENT_CONNECTED */
+  int closed;			/**< number of close_notify alerts received */
+  int fatal;			/**< number of fatal alerts received */
+  size_t received;		/**< bytes of application data received */
+  int datagrams;		/**< number of datagrams sent */
+  unsigned short last_event;	/**< code of the last event or alert */
+} t_loopback_endpoint_t;
+
+/**
+ * Creates the context of @p ep with the address 127.0.0.1:@p port.
+ * @p cipher must be TLS_PSK_WITH_AES_128_CCM_8 or
+ * TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8.
+ *
+ * @return @c 0 on success, less than zero on error.
+ */
+int t_loopback_init(t_loopback_endpoint_t *ep, unsigned short port,
+                    dtls_cipher_t cipher);
+
+/** Releases the context of @p ep and drops records sent to it. */
+void t_loopback_free(t_loopback_endpoint_t *ep);
+
+/** Starts a handshake of @p client with @p server. */
+int t_loopback_connect(t_loopback_endpoint_t *client,
+                       t_loopback_endpoint_t *server);
+
+/**
+ * Delivers the queued records, including those sent while
+ * delivering, until no record is left.
+ *
+ * @return The number of records delivered.
+ */
+int t_loopback_flush(void);
+
+/**
+ * Delivers the oldest queued record.
+ *
+ * @return @c 1 if a record was delivered, @c 0 if none was queued.
+ */
+int t_loopback_step(void);
+
+/** Drops all queued records. */
+void t_loopback_discard(void);
+
+/** Returns the number of queued datagrams. */
+size_t t_loopback_queued(void);
+
+/**
+ * Returns the queued datagram @p i, the oldest first, and sets
+ * @p length to its length.
+ *
+ * @return The datagram, or NULL if fewer datagrams are queued.
+ */
+uint8 *t_loopback_datagram(size_t i, size_t *length);
+
+/** Drops the queued datagram @p i. */
+void t_loopback_drop(size_t i);
+
+/**
+ * Returns the length of @p record and sets @p header to the length of
+ * its header, unless it is NULL. A connection id in the record is
+ * expected to have DTLS_CID_LENGTH bytes, as all endpoints ask for.
+ */
+size_t t_loopback_record_length(const uint8 *record, size_t *header);
+
+/**
+ * Replaces the queued datagram @p i by one datagram per record.
+ *
+ * @return The number of records, or less than zero on error.
+ */
+int t_loopback_split(size_t i);
+
+/** Queues @p length bytes of @p data as datagram from @p from to @p to. */
+int t_loopback_send(t_loopback_endpoint_t *from, t_loopback_endpoint_t *to,
+                    const uint8 *data, size_t length);
+
+/** Moves the clock of dtls_ticks() @p seconds forward. */
+void t_loopback_advance(unsigned int seconds);
+
+/**
+ * Delays the delivery of each datagram to @p seconds after it has
+ * been sent, by moving the clock forward when needed. The default
+ * is no delay.
+ */
+void t_loopback_set_delay(unsigned int seconds);
+
+/** Returns the peer of @p remote in the context of @p ep, or NULL. */
+dtls_peer_t *t_loopback_peer(t_loopback_endpoint_t *ep,
+                             t_loopback_endpoint_t *remote);
+
+#endif /* _TEST_LOOPBACK_H_ */
@@ -0,0 +1,242 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_netq.h"
+
+#include "tinydtls.h"
+#include "global.h"
+#include "netq.h"
+
+#define SLOT_TICKS(Level) ((dtls_tick_t)1 << ((Level) * DTLS_TIMER_WHEEL_BITS))
+/* ticks spanned by the wheel */
+#define SPAN SLOT_TICKS(DTLS_TIMER_WHEEL_LEVELS)
+
+#define NODES 64
+
+static netq_t *nodes[NODES];
+static int queued[NODES];
+
+static uint32_t rnd_state;
+
+/* deterministic xorshift PRNG, so failures are reproducible */
+static uint32_t
+rnd(void) {
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 17;
+  rnd_state ^= rnd_state << 5;
+  return rnd_state;
+}
+
+static int
+node_index(const netq_t *node) {
+  int i;
+
+  for (i = 0; i < NODES; i++) {
+    if (nodes[i] == node)
+      return i;
+  }
+  return -1;
+}
+
+/*
+ * Inserts nodes at @p base + deltas[i], then repeatedly moves the time
+ * to netq_wheel_next() and pops the nodes due. Each node must be
+ * returned exactly at its time-stamp, in the order of the time-stamps.
+ */
+static void
+check_deltas(dtls_tick_t base, const dtls_tick_t *deltas, int count) {
+  netq_wheel_t wheel;
+  dtls_tick_t now = base, last = base, t;
+  netq_t *node;
+  int popped = 0, rounds = 0;
+  int i;
+
+  netq_wheel_init(&wheel, base);
+  for (i = 0; i < count; i++) {
+    nodes[i]->t = base + deltas[i];
+    netq_wheel_insert(&wheel, nodes[i]);
+  }
+
+  while (netq_wheel_next(&wheel, &t) && rounds++ < 10 * count) {
+    /* DTLS_IS_BEFORE_TIME(a, b) means a is not after b */
+    CU_ASSERT(DTLS_IS_BEFORE_TIME(now, t));
+    now = t;
+    while ((node = netq_wheel_pop(&wheel, now))) {
+      i = node_index(node);
+      CU_ASSERT_FATAL(i >= 0 && i < count);
+      CU_ASSERT_EQUAL(node->t, now);
+      CU_ASSERT(DTLS_IS_BEFORE_TIME(last, node->t));
+      last = node->t;
+      popped++;
+    }
+  }
+  CU_ASSERT_EQUAL(popped, count);
+}
+
+/* Time-stamps around the boundaries of each level, and beyond the
+ * span of the wheel. */
+static void
+t_wheel_level_boundaries(void) {
+  dtls_tick_t deltas[NODES];
+  int count = 0, level;
+
+  deltas[count++] = 0;
+  deltas[count++] = 1;
+  for (level = 1; level < DTLS_TIMER_WHEEL_LEVELS; level++) {
+    deltas[count++] = SLOT_TICKS(level) - 1;
+    deltas[count++] = SLOT_TICKS(level);
+    deltas[count++] = SLOT_TICKS(level) + 1;
+    deltas[count++] = 3 * SLOT_TICKS(level) - 1;
+  }
+  deltas[count++] = SPAN - 1;
+  deltas[count++] = SPAN;
+  deltas[count++] = SPAN + 1;
+  deltas[count++] = 3 * SPAN + 5;
+
+  check_deltas(0, deltas, count);
+  /* the slot of the current time is not at the start of a level */
+  check_deltas(SLOT_TICKS(DTLS_TIMER_WHEEL_LEVELS - 1) - 3, deltas, count);
+}
+
+/* The time-stamps wrap around while the nodes are in the wheel. */
+static void
+t_wheel_wrap_around(void) {
+  dtls_tick_t deltas[NODES];
+  int i;
+
+  for (i = 0; i < NODES; i++) {
+    deltas[i] = (i * 997u) % (2 * SPAN);
+  }
+  check_deltas((dtls_tick_t)0 - SPAN / 2, deltas, NODES);
+  check_deltas((dtls_tick_t)0 - 7, deltas, NODES);
+}
+
+/* Random inserts, removals and time steps, checked against the list
+ * of queued nodes. */
+static void
+t_wheel_model(void) {
+  netq_wheel_t wheel;
+  dtls_tick_t now = (dtls_tick_t)0 - 1000, t;
+  netq_t *node;
+  int failures = 0;
+  int step, i;
+
+  rnd_state = 0x2545f491;
+  memset(queued, 0, sizeof(queued));
+  netq_wheel_init(&wheel, now);
+
+  for (step = 0; step < 20000; step++) {
+    i = rnd() % NODES;
+    switch (rnd() % 4) {
+    case 0:
+    case 1:
+      if (queued[i])
+        netq_wheel_remove(&wheel, nodes[i]);
+      /* mostly short timeouts, some beyond the span */
+      nodes[i]->t = now + (rnd() % 8 ? rnd() % 4000 : rnd() % (3 * SPAN));
+      netq_wheel_insert(&wheel, nodes[i]);
+      queued[i] = 1;
+      break;
+    case 2:
+      if (queued[i]) {
+        netq_wheel_remove(&wheel, nodes[i]);
+        queued[i] = 0;
+      }
+      break;
+    default:
+      now += rnd() % (rnd() % 16 ? 64 : SPAN);
+      while ((node = netq_wheel_pop(&wheel, now))) {
+        i = node_index(node);
+        if (i < 0 || !queued[i] || !DTLS_IS_BEFORE_TIME(node->t, now))
+          failures++;
+        else
+          queued[i] = 0;
+      }
+      /* all due nodes have been returned */
+      for (i = 0; i < NODES; i++) {
+        if (queued[i] && DTLS_IS_BEFORE_TIME(nodes[i]->t, now))
+          failures++;
+      }
+    }
+
+    /* netq_wheel_next() is not after any queued node */
+    if (netq_wheel_next(&wheel, &t)) {
+      for (i = 0; i < NODES; i++) {
+        if (queued[i] && !DTLS_IS_BEFORE_TIME(t, nodes[i]->t))
+          failures++;
+      }
+    } else {
+      for (i = 0; i < NODES; i++) {
+        if (queued[i])
+          failures++;
+      }
+    }
+  }
+  CU_ASSERT_EQUAL(failures, 0);
+
+  for (i = 0; i < NODES; i++) {
+    if (queued[i])
+      netq_wheel_remove(&wheel, nodes[i]);
+  }
+}
+
+static int
+t_netq_init(void) {
+  int i;
+
+  for (i = 0; i < NODES; i++) {
+    nodes[i] = netq_node_new(NULL, 0);
+    if (!nodes[i])
+      return -1;
+  }
+  return 0;
+}
+
+static int
+t_netq_cleanup(void) {
+  int i;
+
+  for (i = 0; i < NODES; i++) {
+    netq_node_free(nodes[i]);
+    nodes[i] = NULL;
+  }
+  return 0;
+}
+
+CU_pSuite
+t_init_netq_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("timer wheel", t_netq_init, t_netq_cleanup);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add timer wheel test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define NETQ_TEST(s,t)                                                  \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for timer wheel (%s)\n",        \
+            CU_get_error_msg());                                        \
+  }
+
+  NETQ_TEST(suite, t_wheel_level_boundaries);
+  NETQ_TEST(suite, t_wheel_wrap_around);
+  NETQ_TEST(suite, t_wheel_model);
+
+  return suite;
+}
@@ -0,0 +1,246 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_peer_table.h"
+
+#ifdef DTLS_PEERS_OPENHASH
+
+#include "tinydtls.h"
+#include "peer.h"
+#include "peer_table.h"
+
+/* number of distinct keys, and of random operations per run */
+#define KEYS 1000
+#define STEPS 50000
+
+/*
+ * The table is checked against a reference map, a flag per key. Each
+ * run performs random inserts and deletes, drawn such that the number
+ * of peers rises and falls several times. This causes the table to
+ * grow and to shrink, with and without pending migrations, and to
+ * accumulate deleted markers.
+ */
+static dtls_peer_t *peers;
+static unsigned char present[KEYS];
+static size_t present_count;
+
+static uint32_t rnd_state;
+
+/* deterministic xorshift PRNG, so failures are reproducible */
+static uint32_t
+rnd(void) {
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 17;
+  rnd_state ^= rnd_state << 5;
+  return rnd_state;
+}
+
+/* A weak hash: few distinct values, so that most peers share their
+ * group and control byte with others. */
+static uint32_t
+weak_hash(const dtls_session_key_t *key) {
+  return (key->port % 13) * 0x81;
+}
+
+static void
+init_peers(uint32_t (*hash)(const dtls_session_key_t *)) {
+  size_t i;
+
+  memset(peers, 0, KEYS * sizeof(dtls_peer_t));
+  memset(present, 0, sizeof(present));
+  present_count = 0;
+  for (i = 0; i < KEYS; i++) {
+    peers[i].key.family = AF_INET;
+    peers[i].key.port = (uint16_t)i;
+    peers[i].key.addr[0] = 10;
+    peers[i].key.addr[3] = (uint8_t)(i >> 8);
+    peers[i].hash = hash(&peers[i].key);
+  }
+}
+
+/* Compares every key, present or not, and the iteration with the
+ * reference map. */
+static int
+check_table(dtls_peer_table_t *table) {
+  unsigned char seen[KEYS];
+  dtls_peer_t *p;
+  size_t i, pos = 0;
+  int ok = 1;
+
+  if (dtls_peer_table_count(table) != present_count)
+    ok = 0;
+
+  for (i = 0; i < KEYS; i++) {
+    p = dtls_peer_table_find(table, &peers[i].key, peers[i].hash);
+    if (p != (present[i] ? &peers[i] : NULL))
+      ok = 0;
+  }
+
+  memset(seen, 0, sizeof(seen));
+  while ((p = dtls_peer_table_next(table, &pos))) {
+    i = p - peers;
+    if (i >= KEYS || !present[i] || seen[i])
+      ok = 0;
+    else
+      seen[i] = 1;
+  }
+  if (memcmp(seen, present, sizeof(seen)) != 0)
+    ok = 0;
+
+  return ok;
+}
+
+static void
+run_model(uint32_t (*hash)(const dtls_session_key_t *), uint32_t seed) {
+  dtls_peer_table_t table;
+  size_t target = KEYS / 2;
+  int failures = 0;
+  size_t step;
+
+  rnd_state = seed;
+  init_peers(hash);
+  dtls_peer_table_init(&table);
+
+  for (step = 0; step < STEPS; step++) {
+    size_t i = rnd() % KEYS;
+    dtls_peer_t *p;
+
+    /* move the target size every 2000 steps, between 0 and KEYS */
+    if (step % 2000 == 0)
+      target = rnd() % (KEYS + 1);
+
+    p = dtls_peer_table_find(&table, &peers[i].key, peers[i].hash);
+    if (p != (present[i] ? &peers[i] : NULL))
+      failures++;
+
+    if (!present[i] && (present_count < target || rnd() % 8 == 0)) {
+      if (dtls_peer_table_add(&table, &peers[i], peers[i].hash) < 0) {
+        failures++;
+      } else {
+        present[i] = 1;
+        present_count++;
+      }
+    } else if (present[i] && (present_count > target || rnd() % 8 == 0)) {
+      dtls_peer_table_remove(&table, &peers[i]);
+      present[i] = 0;
+      present_count--;
+    }
+
+    if (step % 997 == 0 && !check_table(&table))
+      failures++;
+  }
+  CU_ASSERT_EQUAL(failures, 0);
+  CU_ASSERT(check_table(&table));
+
+  dtls_peer_table_free(&table);
+}
+
+static void
+t_peer_table_model(void) {
+  run_model(dtls_session_key_hash, 0x2545f491);
+  run_model(dtls_session_key_hash, 0x9e3779b9);
+}
+
+static void
+t_peer_table_model_collisions(void) {
+  run_model(weak_hash, 0x2545f491);
+}
+
+/* Peers may be removed while iterating, the table is resized only
+ * after the iteration. */
+static void
+t_peer_table_remove_iterating(void) {
+  dtls_peer_table_t table;
+  dtls_peer_t *p;
+  size_t i, pos = 0;
+
+  init_peers(dtls_session_key_hash);
+  dtls_peer_table_init(&table);
+  for (i = 0; i < KEYS; i++) {
+    CU_ASSERT_FATAL(dtls_peer_table_add(&table, &peers[i], peers[i].hash) == 0);
+    present[i] = 1;
+  }
+  present_count = KEYS;
+
+  while ((p = dtls_peer_table_next(&table, &pos))) {
+    i = p - peers;
+    if (i % 10) {
+      dtls_peer_table_remove(&table, p);
+      present[i] = 0;
+      present_count--;
+    }
+  }
+  CU_ASSERT(check_table(&table));
+
+  /* shrinks again */
+  for (i = 0; i < KEYS; i += 10) {
+    dtls_peer_table_remove(&table, &peers[i]);
+    present[i] = 0;
+    present_count--;
+  }
+  CU_ASSERT_EQUAL(present_count, 0);
+  CU_ASSERT(check_table(&table));
+
+  dtls_peer_table_free(&table);
+}
+
+static int
+t_peer_table_init(void) {
+  peers = calloc(KEYS, sizeof(dtls_peer_t));
+  return peers ? 0 : -1;
+}
+
+static int
+t_peer_table_cleanup(void) {
+  free(peers);
+  peers = NULL;
+  return 0;
+}
+
+CU_pSuite
+t_init_peer_table_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("peer table", t_peer_table_init, t_peer_table_cleanup);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add peer table test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define PEER_TABLE_TEST(s,t)                                            \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for peer table (%s)\n",         \
+            CU_get_error_msg());                                        \
+  }
+
+  PEER_TABLE_TEST(suite, t_peer_table_model);
+  PEER_TABLE_TEST(suite, t_peer_table_model_collisions);
+  PEER_TABLE_TEST(suite, t_peer_table_remove_iterating);
+
+  return suite;
+}
+
+#else /* DTLS_PEERS_OPENHASH */
+
+CU_pSuite
+t_init_peer_table_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_PEERS_OPENHASH */
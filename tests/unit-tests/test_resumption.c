@@ -0,0 +1,391 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_resumption.h"
+#include "test_loopback.h"
+
+#include "dtls_time.h"
+
+/* A client keeps its sessions in the cache, also those of tickets. */
+#if defined(DTLS_PSK) && DTLS_SESSION_CACHE_SIZE > 0
+
+static t_loopback_endpoint_t server, client;
+
+/* Each test starts with fresh contexts. */
+static int
+t_resumption_setup(void) {
+  if (t_loopback_init(&server, 20240, TLS_PSK_WITH_AES_128_CCM_8) < 0 ||
+      t_loopback_init(&client, 20241, TLS_PSK_WITH_AES_128_CCM_8) < 0)
+    return -1;
+  dtls_set_session_lifetime(server.ctx, 60);
+  dtls_set_session_lifetime(client.ctx, 60);
+  return 0;
+}
+
+static void
+t_resumption_teardown(void) {
+  t_loopback_free(&client);
+  t_loopback_free(&server);
+  t_loopback_discard();
+}
+
+/*
+ * Runs a handshake of the client with the server.
+ *
+ * @return The number of records delivered, or @c -1 if the client
+ *   has not been connected.
+ */
+static int
+handshake(void) {
+  int connected = client.connected;
+  int count;
+
+  if (t_loopback_connect(&client, &server) <= 0)
+    return -1;
+  count = t_loopback_flush();
+  return client.connected == connected + 1 ? count : -1;
+}
+
+/* Closes the connection, so that the next handshake starts anew. */
+static void
+close_session(void) {
+  CU_ASSERT(dtls_close(client.ctx, &server.addr) == 0);
+  t_loopback_flush();
+  CU_ASSERT_FATAL(t_loopback_peer(&client, &server) == NULL);
+  CU_ASSERT_FATAL(t_loopback_peer(&server, &client) == NULL);
+}
+
+/* Moves the sessions in the cache of @p ep @p seconds into the past. */
+static void
+age_sessions(t_loopback_endpoint_t *ep, unsigned int seconds) {
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    ep->ctx->sessions[i].created -= seconds * DTLS_TICKS_PER_SECOND;
+  }
+}
+
+/* Returns the number of sessions of @p role in the cache of @p ep. */
+static int
+count_sessions(t_loopback_endpoint_t *ep, dtls_peer_type role) {
+  int count = 0;
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    if (ep->ctx->sessions[i].id_length && ep->ctx->sessions[i].role == role)
+      count++;
+  }
+  return count;
+}
+
+/* The second handshake is abbreviated, and the keys of the resumed
+ * session protect application data. */
+static void
+t_resumption_abbreviated(void) {
+  int full, resumed;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  CU_ASSERT_EQUAL(count_sessions(&client, DTLS_CLIENT), 1);
+  close_session();
+
+  resumed = handshake();
+  CU_ASSERT(resumed > 0);
+  CU_ASSERT(resumed < full);
+  CU_ASSERT_EQUAL(server.connected, 2);
+
+  CU_ASSERT(dtls_write(client.ctx, &server.addr, (uint8 *)"abc", 3) == 3);
+  t_loopback_flush();
+  CU_ASSERT_EQUAL(server.received, 3);
+
+  /* a resumed session may be resumed again */
+  close_session();
+  CU_ASSERT_EQUAL(handshake(), resumed);
+
+  t_resumption_teardown();
+}
+
+/* A lifetime of 0 disables resumption on either side. */
+static void
+t_resumption_disabled(void) {
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+  dtls_set_session_lifetime(server.ctx, 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  close_session();
+  CU_ASSERT_EQUAL(handshake(), full);
+  t_resumption_teardown();
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+  dtls_set_session_lifetime(client.ctx, 0);
+
+  CU_ASSERT_EQUAL(handshake(), full);
+  CU_ASSERT_EQUAL(count_sessions(&client, DTLS_CLIENT), 0);
+  close_session();
+  CU_ASSERT_EQUAL(handshake(), full);
+  t_resumption_teardown();
+}
+
+/* Sessions are not offered after their lifetime, and servers that do
+ * not know the offered session fall back to a full handshake. */
+static void
+t_resumption_full_fallback(void) {
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  close_session();
+  age_sessions(&client, 61);
+  CU_ASSERT_EQUAL(handshake(), full);
+  close_session();
+
+  /* a new server context */
+  t_loopback_free(&server);
+  CU_ASSERT_FATAL(t_loopback_init(&server, 20240, TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  CU_ASSERT_EQUAL(handshake(), full);
+  CU_ASSERT_EQUAL(server.connected, 1);
+
+  t_resumption_teardown();
+}
+
+#if DTLS_SESSION_TICKET_LENGTH == 0
+/* Without tickets, the server keeps the session in its cache, until
+ * the lifetime has passed. */
+static void
+t_resumption_server_cache(void) {
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  CU_ASSERT_EQUAL(count_sessions(&server, DTLS_SERVER), 1);
+  close_session();
+  CU_ASSERT(handshake() < full);
+  CU_ASSERT_EQUAL(count_sessions(&server, DTLS_SERVER), 1);
+  close_session();
+
+  age_sessions(&server, 61);
+  CU_ASSERT_EQUAL(handshake(), full);
+  /* the expired session has been replaced */
+  CU_ASSERT_EQUAL(count_sessions(&server, DTLS_SERVER), 1);
+
+  t_resumption_teardown();
+}
+#endif /* DTLS_SESSION_TICKET_LENGTH == 0 */
+
+#if DTLS_SESSION_TICKET_LENGTH > 0
+/* Returns the session of the client with the server, or NULL. */
+static dtls_session_cache_entry_t *
+client_session(void) {
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    if (client.ctx->sessions[i].id_length &&
+        client.ctx->sessions[i].role == DTLS_CLIENT &&
+        dtls_session_equals(&client.ctx->sessions[i].remote, &server.addr))
+      return &client.ctx->sessions[i];
+  }
+  return NULL;
+}
+
+static void
+make_key(dtls_ticket_key_t *key, uint8 n) {
+  memset(key->name, n, sizeof(key->name));
+  memset(key->key, 0x80 | n, sizeof(key->key));
+}
+
+/* Returns non-zero if the ticket of the client was issued with the
+ * key @p n of make_key(). */
+static int
+ticket_of_key(uint8 n) {
+  dtls_session_cache_entry_t *session = client_session();
+  dtls_ticket_key_t key;
+
+  make_key(&key, n);
+  return session && session->ticket_length > DTLS_TICKET_KEY_NAME_LENGTH &&
+    memcmp(session->ticket, key.name, DTLS_TICKET_KEY_NAME_LENGTH) == 0;
+}
+
+/* The server issues a ticket instead of keeping the session, and
+ * resumes it from the ticket. */
+static void
+t_ticket_stateless(void) {
+  dtls_session_cache_entry_t *session;
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  CU_ASSERT_EQUAL(count_sessions(&server, DTLS_SERVER), 0);
+  session = client_session();
+  CU_ASSERT_FATAL(session != NULL);
+  CU_ASSERT(session->ticket_length > 0);
+  CU_ASSERT(session->ticket_length <= DTLS_SESSION_TICKET_LENGTH);
+  close_session();
+
+  CU_ASSERT(handshake() < full);
+  CU_ASSERT_EQUAL(count_sessions(&server, DTLS_SERVER), 0);
+
+  t_resumption_teardown();
+}
+
+/* Servers that share their keys resume the tickets of each other. */
+static void
+t_ticket_shared_keys(void) {
+  dtls_ticket_key_t key;
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+  make_key(&key, 1);
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, &key, 1) == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  CU_ASSERT(ticket_of_key(1));
+  close_session();
+
+  t_loopback_free(&server);
+  CU_ASSERT_FATAL(t_loopback_init(&server, 20240, TLS_PSK_WITH_AES_128_CCM_8) == 0);
+  dtls_set_session_lifetime(server.ctx, 60);
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, &key, 1) == 0);
+  CU_ASSERT(handshake() < full);
+
+  t_resumption_teardown();
+}
+
+/* Tickets of the previous key are accepted and replaced by one of the
+ * new key, tickets of removed keys are not. */
+static void
+t_ticket_key_rotation(void) {
+  dtls_ticket_key_t keys[DTLS_TICKET_KEYS + 1];
+  int full, resumed;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+  make_key(&keys[0], 2);
+  make_key(&keys[1], 1);
+  make_key(&keys[2], 3);
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, keys, DTLS_TICKET_KEYS + 1) < 0);
+
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, &keys[1], 1) == 0);
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  CU_ASSERT(ticket_of_key(1));
+  close_session();
+
+  /* the new key first, followed by the previous one */
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, keys, 2) == 0);
+  resumed = handshake();
+  CU_ASSERT(resumed > 0 && resumed < full);
+  CU_ASSERT(ticket_of_key(2));
+  close_session();
+
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, keys, 1) == 0);
+  resumed = handshake();
+  CU_ASSERT(resumed > 0 && resumed < full);
+  CU_ASSERT(ticket_of_key(2));
+  close_session();
+
+  CU_ASSERT(dtls_set_ticket_keys(server.ctx, &keys[2], 1) == 0);
+  CU_ASSERT_EQUAL(handshake(), full);
+  CU_ASSERT(ticket_of_key(3));
+
+  t_resumption_teardown();
+}
+
+/* A modified ticket is rejected, and the server continues with a full
+ * handshake. */
+static void
+t_ticket_modified(void) {
+  dtls_session_cache_entry_t *session;
+  size_t i;
+  int full;
+
+  CU_ASSERT_FATAL(t_resumption_setup() == 0);
+
+  full = handshake();
+  CU_ASSERT_FATAL(full > 0);
+  close_session();
+
+  /* the key name, the nonce, the encrypted state and the MAC */
+  for (i = 0; i < 4; i++) {
+    static const size_t offset[] = { 0, 16, 28, 94 };
+
+    session = client_session();
+    CU_ASSERT_FATAL(session != NULL);
+    CU_ASSERT_FATAL(session->ticket_length > offset[i]);
+    session->ticket[offset[i]] ^= 0x01;
+    CU_ASSERT_EQUAL(handshake(), full);
+    CU_ASSERT(session->ticket_length > 0);
+    close_session();
+  }
+  CU_ASSERT(handshake() < full);
+  CU_ASSERT_EQUAL(client.fatal + server.fatal, 0);
+
+  t_resumption_teardown();
+}
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+CU_pSuite
+t_init_resumption_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("session resumption", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add session resumption test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define RESUMPTION_TEST(s,t)                                            \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for session resumption (%s)\n", \
+            CU_get_error_msg());                                        \
+  }
+
+  RESUMPTION_TEST(suite, t_resumption_abbreviated);
+  RESUMPTION_TEST(suite, t_resumption_disabled);
+  RESUMPTION_TEST(suite, t_resumption_full_fallback);
+#if DTLS_SESSION_TICKET_LENGTH == 0
+  RESUMPTION_TEST(suite, t_resumption_server_cache);
+#endif /* DTLS_SESSION_TICKET_LENGTH == 0 */
+#if DTLS_SESSION_TICKET_LENGTH > 0
+  RESUMPTION_TEST(suite, t_ticket_stateless);
+  RESUMPTION_TEST(suite, t_ticket_shared_keys);
+  RESUMPTION_TEST(suite, t_ticket_key_rotation);
+  RESUMPTION_TEST(suite, t_ticket_modified);
+#endif /* DTLS_SESSION_TICKET_LENGTH > 0 */
+
+  return suite;
+}
+
+#else /* DTLS_PSK && DTLS_SESSION_CACHE_SIZE > 0 */
+
+CU_pSuite
+t_init_resumption_tests(void) {
+  return NULL;
+}
+
+#endif /* DTLS_PSK && DTLS_SESSION_CACHE_SIZE > 0 */
@@ -0,0 +1,189 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Contributors to the Eclipse Foundation.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dtls_config.h"
+#include "test_session.h"
+
+#include "tinydtls.h"
+#include "session.h"
+
+#define BUCKETS 256
+#define KEYS (16 * BUCKETS)
+
+static void
+set_ipv4(session_t *s, uint32_t addr, uint16_t port) {
+  dtls_session_init(s);
+  s->size = sizeof(s->addr.sin);
+  s->addr.sin.sin_family = AF_INET;
+  s->addr.sin.sin_port = htons(port);
+  s->addr.sin.sin_addr.s_addr = htonl(addr);
+}
+
+static void
+set_ipv6(session_t *s, uint8_t last, uint16_t port) {
+  dtls_session_init(s);
+  s->size = sizeof(s->addr.sin6);
+  s->addr.sin6.sin6_family = AF_INET6;
+  s->addr.sin6.sin6_port = htons(port);
+  s->addr.sin6.sin6_addr.s6_addr[0] = 0x20;
+  s->addr.sin6.sin6_addr.s6_addr[1] = 0x01;
+  s->addr.sin6.sin6_addr.s6_addr[15] = last;
+}
+
+static int
+key_equals(const session_t *a, const session_t *b) {
+  dtls_session_key_t ka, kb;
+
+  dtls_session_key(a, &ka);
+  dtls_session_key(b, &kb);
+  return memcmp(&ka, &kb, sizeof(ka)) == 0;
+}
+
+static uint32_t
+hash_of(const session_t *s) {
+  dtls_session_key_t key;
+
+  dtls_session_key(s, &key);
+  return dtls_session_key_hash(&key);
+}
+
+/* Unused parts of the address structure must not leak into the key. */
+static void
+t_session_key_normalized(void) {
+  session_t a, b;
+
+  set_ipv4(&a, 0xc0a80001, 5684);
+  memset(&b, 0xa5, sizeof(b));
+  b.size = sizeof(b.addr);
+  b.ifindex = a.ifindex;
+  b.addr.sin.sin_family = AF_INET;
+  b.addr.sin.sin_port = a.addr.sin.sin_port;
+  b.addr.sin.sin_addr = a.addr.sin.sin_addr;
+
+  CU_ASSERT(key_equals(&a, &b));
+  CU_ASSERT_EQUAL(hash_of(&a), hash_of(&b));
+
+  set_ipv6(&a, 1, 5684);
+  memset(&b, 0x5a, sizeof(b));
+  b.size = sizeof(b.addr.sin6);
+  b.ifindex = a.ifindex;
+  b.addr.sin6.sin6_family = AF_INET6;
+  b.addr.sin6.sin6_port = a.addr.sin6.sin6_port;
+  b.addr.sin6.sin6_addr = a.addr.sin6.sin6_addr;
+
+  CU_ASSERT(key_equals(&a, &b));
+  CU_ASSERT_EQUAL(hash_of(&a), hash_of(&b));
+}
+
+/* Each field that identifies a peer is part of the key. */
+static void
+t_session_key_fields(void) {
+  session_t a, b;
+
+  set_ipv4(&a, 0xc0a80001, 5684);
+
+  set_ipv4(&b, 0xc0a80001, 5685);
+  CU_ASSERT(!key_equals(&a, &b));
+
+  set_ipv4(&b, 0xc0a80002, 5684);
+  CU_ASSERT(!key_equals(&a, &b));
+
+  set_ipv4(&b, 0xc0a80001, 5684);
+  b.ifindex = 2;
+  CU_ASSERT(!key_equals(&a, &b));
+
+  /* the IPv6 address with the same leading bytes */
+  set_ipv6(&b, 0, 5684);
+  memset(&b.addr.sin6.sin6_addr, 0, sizeof(b.addr.sin6.sin6_addr));
+  memcpy(&b.addr.sin6.sin6_addr, &a.addr.sin.sin_addr,
+         sizeof(a.addr.sin.sin_addr));
+  CU_ASSERT(!key_equals(&a, &b));
+}
+
+/* Chi-squared test of the bucket counts against a uniform
+ * distribution. With 255 degrees of freedom, a good hash stays well
+ * below 400, while a hash that ignores some input bits exceeds it by
+ * far. */
+static void
+check_buckets(const unsigned int *count) {
+  const unsigned int expected = KEYS / BUCKETS;
+  unsigned int chi2 = 0;
+  size_t i;
+
+  for (i = 0; i < BUCKETS; i++) {
+    int d = (int)count[i] - (int)expected;
+    chi2 += d * d;
+  }
+  chi2 /= expected;
+  CU_ASSERT(chi2 < 400);
+}
+
+/* Clients behind a NAT differ in the port only, clients of a subnet
+ * in the last bytes of the address. Both must be spread over the low
+ * bits used by hash tables as well as over the high bits. */
+static void
+t_session_key_hash_distribution(void) {
+  unsigned int low[BUCKETS], high[BUCKETS];
+  session_t s;
+  uint32_t h;
+  size_t i;
+
+  memset(low, 0, sizeof(low));
+  memset(high, 0, sizeof(high));
+  for (i = 0; i < KEYS; i++) {
+    set_ipv4(&s, 0x0a000001, 40000 + i);
+    h = hash_of(&s);
+    low[h % BUCKETS]++;
+    high[h >> 24]++;
+  }
+  check_buckets(low);
+  check_buckets(high);
+
+  memset(low, 0, sizeof(low));
+  memset(high, 0, sizeof(high));
+  for (i = 0; i < KEYS; i++) {
+    set_ipv4(&s, 0x0a000000 + i, 5684);
+    h = hash_of(&s);
+    low[h % BUCKETS]++;
+    high[h >> 24]++;
+  }
+  check_buckets(low);
+  check_buckets(high);
+}
+
+CU_pSuite
+t_init_session_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("session", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add session test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define SESSION_TEST(s,t)                                               \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for session (%s)\n",            \
+            CU_get_error_msg());                                        \
+  }
+
+  SESSION_TEST(suite, t_session_key_normalized);
+  SESSION_TEST(suite, t_session_key_fields);
+  SESSION_TEST(suite, t_session_key_hash_distribution);
+
+  return suite;
+}
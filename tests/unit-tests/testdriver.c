@@ -3,9 +3,20 @@
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 
+#include "test_alloc.h"
 #include "test_ccm.h"
+#include "test_cid.h"
+#include "test_crypto_job.h"
 #include "test_ecc.h"
+#include "test_false_start.h"
+#include "test_flight.h"
+#include "test_fragment.h"
+#include "test_limits.h"
+#include "test_netq.h"
+#include "test_peer_table.h"
 #include "test_prf.h"
+#include "test_resumption.h"
+#include "test_session.h"
 #include "tinydtls.h"
 
 int main(void) {
@@ -20,6 +31,17 @@ int main(void) {
   t_init_ccm_tests();
   t_init_ecc_tests();
   t_init_prf_tests();
+  t_init_crypto_job_tests();
+  t_init_session_tests();
+  t_init_peer_table_tests();
+  t_init_alloc_tests();
+  t_init_limits_tests();
+  t_init_netq_tests();
+  t_init_resumption_tests();
+  t_init_cid_tests();
+  t_init_flight_tests();
+  t_init_fragment_tests();
+  t_init_false_start_tests();
 
   CU_basic_set_mode(run_mode);
   result = CU_basic_run_tests();